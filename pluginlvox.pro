@@ -2,6 +2,7 @@ TEMPLATE = subdirs
 
 SUBDIRS += pluginlvox/plugin_lvox.pro
 SUBDIRS += pluginlvox_test
+SUBDIRS += pluginlvox_bench
 
 # pluginlvox_test.depends = pluginlvox
 CONFIG += ordered
@@ -19,10 +19,17 @@
 #include "mk/tools/worker/lvox3_computebefore.h"
 #include "mk/tools/worker/lvox3_computetheoriticals.h"
 #include "mk/tools/worker/lvox3_computeall.h"
+#include "mk/tools/worker/lvox3_computetiledgrids.h"
+#include "mk/tools/worker/lvox3_workersreport.h"
 #include "mk/tools/lvox3_computelvoxgridspreparator.h"
+#include "mk/tools/lvox3_gridcache.h"
+#include "mk/tools/lvox3_gridtiling.h"
+#include "mk/tools/lvox3_pointstaging.h"
 #include "mk/tools/lvox3_gridtype.h"
 #include "mk/tools/lvox3_errorcode.h"
 
+#include <QDir>
+
 #define DEF_SearchInResult      "r"
 #define DEF_SearchInGroup       "gr"
 #define DEF_SearchInScene       "sc"
@@ -31,10 +38,40 @@
 #define DEF_SearchInMNT         "mnt"
 #define DEF_SearchInSky         "sky"
 
+// name of grids in the cache
+#define DEF_CacheHits           "hits"
+#define DEF_CacheTheoretical    "theoretical"
+#define DEF_CacheBefore         "before"
+#define DEF_CacheDeltaIn        "deltain"
+#define DEF_CacheDeltaOut       "deltaout"
+#define DEF_CacheDeltaTheo      "deltatheoretical"
+#define DEF_CacheDeltaBefore    "deltabefore"
+
+namespace {
+    /**
+     * @brief Set all values of a grid back to 0, the value of the grids before the workers (NULL is ignored)
+     */
+    template<typename T>
+    void resetGrid(CT_Grid3D<T>* grid)
+    {
+        if(grid == NULL)
+            return;
+
+        const size_t nCells = grid->nCells();
+
+        for(size_t i=0; i<nCells; ++i)
+            grid->setValueAtIndex(i, 0);
+    }
+}
+
 LVOX3_StepComputeLvoxGrids::LVOX3_StepComputeLvoxGrids(CT_StepInitializeData &dataInit) : CT_AbstractStep(dataInit)
 {
     m_resolution = 0.5;
     m_computeDistances = false;
+    m_multiThreadedRays = false;
+    m_stagePoints = false;
+    m_mortonOrder = false;
+    m_quantizeDistances = false;
 
     m_gridMode = lvox::BoundingBoxOfTheScene;
     m_coordinates.x() = -20.0;
@@ -44,6 +81,15 @@ LVOX3_StepComputeLvoxGrids::LVOX3_StepComputeLvoxGrids(CT_StepInitializeData &da
     m_dimensions.x() = 80;
     m_dimensions.y() = 80;
     m_dimensions.z() = 80;
+
+    m_useCache = false;
+    m_cacheMaxSize = 4096;
+    m_clearCache = false;
+
+    m_tiled = false;
+    m_memoryBudget = 8192;
+
+    m_writeReport = false;
 }
 
 QString LVOX3_StepComputeLvoxGrids::getStepDescription() const
@@ -86,6 +132,10 @@ void LVOX3_StepComputeLvoxGrids::createPostConfigurationDialog()
     //********************************************//
     configDialog->addDouble(tr("Resolution of the grids"),tr("meters"),0.0001,10000,2, m_resolution );
     configDialog->addBool("", "", tr("Compute Distances"), m_computeDistances);
+    configDialog->addBool("", "", tr("Cut the rays of a scan between threads (grids do not depend on the number of threads)"), m_multiThreadedRays);
+    configDialog->addBool("", "", tr("Copy the points of a scan in contiguous arrays before computing (faster, 24 bytes per point)"), m_stagePoints);
+    configDialog->addBool("", "", tr("Process points and shots in Morton order of their voxels (better use of the cache for big grids)"), m_mortonOrder);
+    configDialog->addBool("", "", tr("Write distances in 16 bits in the cache and the tiles (half size on disk, error lower than resolution / 75000)"), m_quantizeDistances);
     configDialog->addEmpty();
 
     configDialog->addText(tr("Reference for (minX, minY, minZ) corner of the grid :"),"", "");
@@ -111,6 +161,21 @@ void LVOX3_StepComputeLvoxGrids::createPostConfigurationDialog()
     configDialog->addInt(tr("X dimension:"), "", 1, 1000, m_dimensions.x());
     configDialog->addInt(tr("Y dimension:"), "", 1, 1000, m_dimensions.y());
     configDialog->addInt(tr("Z dimension:"), "", 1, 1000, m_dimensions.z());
+
+    configDialog->addEmpty();
+    configDialog->addBool("", "", tr("Use a cache of computed grids"), m_useCache);
+    configDialog->addFileChoice(tr("Cache folder"), CT_FileChoiceButton::OneExistingFolder, "", m_cacheDirectory);
+    configDialog->addInt(tr("Maximum size of the cache"), tr("Mo"), 1, std::numeric_limits<int>::max(), m_cacheMaxSize);
+    configDialog->addBool("", "", tr("Empty the cache before computing"), m_clearCache);
+
+    configDialog->addEmpty();
+    configDialog->addBool("", "", tr("Compute tile by tile and write grids on the disk only, no grid is added to the result (for plots bigger than the memory)"), m_tiled);
+    configDialog->addFileChoice(tr("Tiles folder"), CT_FileChoiceButton::OneExistingFolder, "", m_tilesDirectory);
+    configDialog->addInt(tr("Memory used by the grids of a tile and the rays of a scan"), tr("Mo"), 1, std::numeric_limits<int>::max(), m_memoryBudget);
+
+    configDialog->addEmpty();
+    configDialog->addBool("", "", tr("Write the timing report of the compute in a JSON file"), m_writeReport);
+    configDialog->addFileChoice(tr("Report folder"), CT_FileChoiceButton::OneExistingFolder, "", m_reportDirectory);
 }
 
 void LVOX3_StepComputeLvoxGrids::createOutResultModelListProtected()
@@ -165,10 +230,133 @@ void LVOX3_StepComputeLvoxGrids::compute()
                                                               m_gridFilePath.isEmpty() ? "" : m_gridFilePath.first());
 
 
+    if(pRes.valid && m_tiled) {
+        // Grids are too big to be in memory : compute them tile by tile and write them on the disk. Scans
+        // are computed one after the other so only the grids of one tile are in memory at the same time.
+        if(m_tilesDirectory.isEmpty() || !QDir().mkpath(m_tilesDirectory.first())) {
+            PS_LOG->addMessage(LogInterface::warning, LogInterface::step, tr("Tiles folder can not be used"));
+            return;
+        }
+
+        // distances are quantized only on the disk, a tile computes them in float
+        const size_t bytesPerVoxel = (3*sizeof(lvox::Grid3DiType)) + (m_computeDistances ? 4*sizeof(lvox::Grid3DfType) : 0);
+        const size_t zdim = LVOX3_GridTiling::computeDim(pRes.minBBox.z(), pRes.maxBBox.z(), m_resolution);
+        const quint64 memoryBudget = ((quint64)m_memoryBudget)*1024*1024;
+        const bool stagePoints = (m_stagePoints || m_mortonOrder);
+
+        size_t tileSize = LVOX3_GridTiling::computeTileSize(memoryBudget, zdim, bytesPerVoxel);
+        quint64 tileBytes = 0;
+        quint64 scanBytes = 0;
+
+        // a scan also keeps the filter of the columns, its staged points and the indexes of its rays per
+        // tile (more indexes with smaller tiles) : shrink the tiles until the greatest scan fits with them
+        for(int pass = 0 ; pass < 8 ; ++pass) {
+            const LVOX3_GridTiling candidate(pRes.minBBox, pRes.maxBBox, m_resolution, tileSize, tileSize);
+
+            scanBytes = 0;
+
+            LVOX3_ComputeLVOXGridsPreparator::Result::ToComputeCollectionIterator itScans(pRes.elementsToCompute);
+
+            while (itScans.hasNext()) {
+                itScans.next();
+                const LVOX3_ComputeLVOXGridsPreparator::ToCompute& tc = itScans.value();
+
+                scanBytes = qMax(scanBytes, LVOX3_ComputeTiledGrids::scanMemoryBytes(candidate, tc.pattern, tc.scene->getPointCloudIndex(), stagePoints));
+            }
+
+            tileBytes = ((quint64)tileSize) * tileSize * zdim * bytesPerVoxel;
+
+            if(((tileBytes + scanBytes) <= memoryBudget) || (tileSize == 1) || (scanBytes >= memoryBudget))
+                break;
+
+            tileSize = qMin(tileSize - 1, LVOX3_GridTiling::computeTileSize(memoryBudget - scanBytes, zdim, bytesPerVoxel));
+        }
+
+        if((tileBytes + scanBytes) > memoryBudget)
+            PS_LOG->addMessage(LogInterface::warning, LogInterface::step, tr("The grids of a tile (%1 Mo) and the rays of a scan (%2 Mo) use more than the memory budget").arg(tileBytes/(1024*1024)).arg(scanBytes/(1024*1024)));
+
+        LVOX3_GridTiling tiling(pRes.minBBox, pRes.maxBBox, m_resolution, tileSize, tileSize);
+
+        PS_LOG->addMessage(LogInterface::info, LogInterface::step, tr("Grid of %1x%2x%3 voxels computed in %4 tiles of %5x%5 voxels").arg(tiling.xdim()).arg(tiling.ydim()).arg(tiling.zdim()).arg(tiling.tiles().size()).arg(tileSize));
+
+        LVOX3_ComputeAll workersManager;
+        QList<LVOX3_ComputeTiledGrids*> tiledWorkers;
+
+        LVOX3_ComputeLVOXGridsPreparator::Result::ToComputeCollectionIterator it(pRes.elementsToCompute);
+
+        while (it.hasNext())
+        {
+            it.next();
+            const LVOX3_ComputeLVOXGridsPreparator::ToCompute& tc = it.value();
+
+            LVOX3_ComputeTiledGrids* worker = new LVOX3_ComputeTiledGrids(tiling,
+                                                                          tc.pattern,
+                                                                          tc.scene->getPointCloudIndex(),
+                                                                          tc.mnt,
+                                                                          tc.sky,
+                                                                          m_computeDistances,
+                                                                          m_tilesDirectory.first(),
+                                                                          QString("scan%1").arg(it.key()->id()),
+                                                                          m_multiThreadedRays,
+                                                                          m_stagePoints,
+                                                                          m_mortonOrder,
+                                                                          m_quantizeDistances);
+
+            workersManager.addWorker(tiledWorkers.size(), worker);
+            tiledWorkers.append(worker);
+        }
+
+        connect(&workersManager, SIGNAL(progressChanged(int)), this, SLOT(progressChanged(int)), Qt::DirectConnection);
+        connect(this, SIGNAL(stopped()), &workersManager, SLOT(cancel()), Qt::DirectConnection);
+
+        workersManager.compute();
+
+        LVOX3_WorkersReport report;
+
+        foreach (LVOX3_ComputeTiledGrids* worker, tiledWorkers) {
+            if(worker->nTilesNotWritten() > 0)
+                PS_LOG->addMessage(LogInterface::warning, LogInterface::step, tr("%1 tiles could not be written").arg(worker->nTilesNotWritten()));
+
+            if(worker->nClampedDistances() > 0)
+                PS_LOG->addMessage(LogInterface::warning, LogInterface::step, tr("%1 distances were clamped in the quantized tiles").arg(worker->nClampedDistances()));
+
+            // scans are computed one after the other so the peak of the grids is the one of the greatest scan
+            report.merge(worker->getTilesReport());
+        }
+
+        if(!isStopped()) {
+            PS_LOG->addMessage(LogInterface::info, LogInterface::step, tr("Grids are written in the tiles folder %1, no grid is added to the result").arg(m_tilesDirectory.first()));
+            logReport(report, m_tilesDirectory.first());
+        }
+
+        return;
+    }
+
     if(pRes.valid) {
+        LVOX3_GridCache cache(m_cacheDirectory.isEmpty() ? "" : m_cacheDirectory.first(), ((qint64)m_cacheMaxSize)*1024*1024);
+        const bool useCache = m_useCache && cache.isValid();
+
+        if(m_useCache && !cache.isValid())
+            PS_LOG->addMessage(LogInterface::warning, LogInterface::step, tr("Cache folder can not be used, grids will not be cached"));
+
+        if(useCache && m_clearCache)
+            cache.clear();
+
+        QStringList cachedGridNames;
+        cachedGridNames << DEF_CacheHits << DEF_CacheTheoretical << DEF_CacheBefore;
+
+        if(m_computeDistances)
+            cachedGridNames << DEF_CacheDeltaIn << DEF_CacheDeltaOut << DEF_CacheDeltaTheo << DEF_CacheDeltaBefore;
+
+        // grids computed by workers that must be saved in the cache at the end
+        QList< QPair<QByteArray, QList<CT_AbstractGrid3D*> > > gridsToCache;
+
         LVOX3_ComputeAll workersManager;
         LVOX3_ComputeLVOXGridsPreparator::Result::ToComputeCollectionIterator it(pRes.elementsToCompute);
 
+        // points of scans shared by the hits and before workers of the scan
+        QList<LVOX3_PointStaging*> stagings;
+
         while (it.hasNext()
                && !isStopped())
         {
@@ -221,6 +409,61 @@ void LVOX3_StepComputeLvoxGrids::compute()
                 group->addItemDrawable(deltaBefore);
             }
 
+            if(useCache) {
+                LVOX3_GridCache::Inputs inputs;
+                inputs.scene = tc.scene;
+                inputs.pattern = tc.pattern;
+                inputs.mnt = tc.mnt;
+                inputs.sky = tc.sky;
+                inputs.grid = hitGrid;
+                inputs.parameters = QString("distances=%1").arg(m_computeDistances);
+
+                // distances summed on several threads are rounded differently
+                if(m_computeDistances && m_multiThreadedRays)
+                    inputs.parameters += ";multithreaded=1";
+                else if(m_computeDistances && m_mortonOrder)
+                    inputs.parameters += ";morton=1";
+
+                // quantized distances are not the computed ones
+                if(m_computeDistances && m_quantizeDistances)
+                    inputs.parameters += ";quantized=1";
+
+                const QByteArray key = LVOX3_GridCache::computeKey(inputs);
+
+                if(cache.contains(key, cachedGridNames)) {
+                    if(cache.load(key, DEF_CacheHits, hitGrid)
+                            && cache.load(key, DEF_CacheTheoretical, theoriticalGrid)
+                            && cache.load(key, DEF_CacheBefore, beforeGrid)
+                            && (!m_computeDistances
+                                || (cache.loadDistances(key, DEF_CacheDeltaIn, deltaInGrid)
+                                    && cache.loadDistances(key, DEF_CacheDeltaOut, deltaOutGrid)
+                                    && cache.loadDistances(key, DEF_CacheDeltaTheo, deltaTheoritical)
+                                    && cache.loadDistances(key, DEF_CacheDeltaBefore, deltaBefore)))) {
+                        PS_LOG->addMessage(LogInterface::info, LogInterface::step, tr("Grids loaded from the cache (%1)").arg(QString(key)));
+                        continue;
+                    }
+
+                    // grids loaded before the one that failed must not be added to the counts of the workers
+                    PS_LOG->addMessage(LogInterface::warning, LogInterface::step, tr("Unable to load the grids from the cache (%1), they are computed").arg(QString(key)));
+
+                    resetGrid(hitGrid);
+                    resetGrid(theoriticalGrid);
+                    resetGrid(beforeGrid);
+                    resetGrid(deltaInGrid);
+                    resetGrid(deltaOutGrid);
+                    resetGrid(deltaTheoritical);
+                    resetGrid(deltaBefore);
+                }
+
+                QList<CT_AbstractGrid3D*> grids;
+                grids << hitGrid << theoriticalGrid << beforeGrid;
+
+                if(m_computeDistances)
+                    grids << deltaInGrid << deltaOutGrid << deltaTheoritical << deltaBefore;
+
+                gridsToCache.append(qMakePair(key, grids));
+            }
+
             LVOX3_FilterVoxelsByZValuesOfRaster* filterVoxelsBelowMNTWorker = NULL;
             LVOX3_FilterVoxelsByZValuesOfRaster* filterVoxelsInSkyWorker = NULL;
 
@@ -230,9 +473,19 @@ void LVOX3_StepComputeLvoxGrids::compute()
             if(tc.sky != NULL)
                 filterVoxelsInSkyWorker = new LVOX3_FilterVoxelsByZValuesOfRaster(allGrids, tc.sky, LVOX3_FilterVoxelsByZValuesOfRaster::Above, lvox::Sky);
 
-            LVOX3_ComputeHits* hitsWorker = new LVOX3_ComputeHits(tc.pattern, tc.scene->getPointCloudIndex(), hitGrid, deltaInGrid, deltaOutGrid);
-            LVOX3_ComputeTheoriticals* theoriticalWorker = new LVOX3_ComputeTheoriticals(tc.pattern, theoriticalGrid, deltaTheoritical);
-            LVOX3_ComputeBefore* beforeWorker = new LVOX3_ComputeBefore(tc.pattern, tc.scene->getPointCloudIndex(), beforeGrid, deltaBefore);
+            LVOX3_PointStaging* staging = NULL;
+
+            if(m_stagePoints || m_mortonOrder) {
+                staging = new LVOX3_PointStaging(tc.scene->getPointCloudIndex());
+                stagings.append(staging);
+
+                if(m_mortonOrder)
+                    staging->sortByMorton(pRes.minBBox, m_resolution);
+            }
+
+            LVOX3_ComputeHits* hitsWorker = new LVOX3_ComputeHits(tc.pattern, tc.scene->getPointCloudIndex(), hitGrid, deltaInGrid, deltaOutGrid, staging);
+            LVOX3_ComputeTheoriticals* theoriticalWorker = new LVOX3_ComputeTheoriticals(tc.pattern, theoriticalGrid, deltaTheoritical, NULL, m_multiThreadedRays, m_mortonOrder);
+            LVOX3_ComputeBefore* beforeWorker = new LVOX3_ComputeBefore(tc.pattern, tc.scene->getPointCloudIndex(), beforeGrid, deltaBefore, NULL, m_multiThreadedRays, staging);
 
             if(filterVoxelsBelowMNTWorker != NULL)
                 workersManager.addWorker(0, filterVoxelsBelowMNTWorker);
@@ -249,9 +502,52 @@ void LVOX3_StepComputeLvoxGrids::compute()
         connect(this, SIGNAL(stopped()), &workersManager, SLOT(cancel()), Qt::DirectConnection);
 
         workersManager.compute();
+
+        qDeleteAll(stagings);
+
+        if(!isStopped())
+            logReport(workersManager.getReport(), "");
+
+        if(useCache && !isStopped()) {
+            size_t nClamped = 0;
+
+            for(int i=0; i<gridsToCache.size(); ++i) {
+                const QByteArray& key = gridsToCache[i].first;
+                const QList<CT_AbstractGrid3D*>& grids = gridsToCache[i].second;
+
+                for(int j=0; j<grids.size(); ++j) {
+                    // the float grids are the distance grids
+                    const lvox::Grid3Df* distances = dynamic_cast<const lvox::Grid3Df*>(grids.at(j));
+                    const bool ok = (m_quantizeDistances && (distances != NULL)) ? cache.saveQuantizedDistances(key, cachedGridNames.at(j), distances, &nClamped)
+                                                                                 : cache.save(key, cachedGridNames.at(j), grids.at(j));
+
+                    if(!ok)
+                        PS_LOG->addMessage(LogInterface::warning, LogInterface::step, tr("Unable to save the grid %1 in the cache").arg(cachedGridNames.at(j)));
+                }
+            }
+
+            if(nClamped > 0)
+                PS_LOG->addMessage(LogInterface::warning, LogInterface::step, tr("%1 distances were clamped in the quantized grids of the cache").arg(nClamped));
+
+            cache.trim();
+        }
     }
 }
 
+void LVOX3_StepComputeLvoxGrids::logReport(const LVOX3_WorkersReport& report, const QString& defaultDirectory)
+{
+    foreach (const QString& line, report.toText())
+        PS_LOG->addMessage(LogInterface::info, LogInterface::step, line);
+
+    if(!m_writeReport)
+        return;
+
+    const QString directory = m_reportDirectory.isEmpty() ? defaultDirectory : m_reportDirectory.first();
+
+    if(directory.isEmpty() || !report.writeJSON(QDir(directory).filePath("lvox_grids_report.json")))
+        PS_LOG->addMessage(LogInterface::warning, LogInterface::step, tr("Unable to write the report of the compute"));
+}
+
 void LVOX3_StepComputeLvoxGrids::progressChanged(int p)
 {
     setProgress(p);
@@ -9,6 +9,8 @@
 #include "ct_step/abstract/ct_abstractstep.h"
 #include "ct_tools/model/ct_autorenamemodels.h"
 
+class LVOX3_WorkersReport;
+
 /**
  * @brief Compute the LVOX Ni, Nb, Nt grids
  */
@@ -71,11 +73,33 @@ private:
 
     double          m_resolution;               /*!< size of a voxel */
     bool            m_computeDistances;         /*!< true if must compute distance */
+    bool            m_multiThreadedRays;        /*!< true if the rays of a scan must be cut between threads */
+    bool            m_stagePoints;              /*!< true if the points of a scan must be copied in contiguous arrays before computing */
+    bool            m_mortonOrder;              /*!< true if points and shots must be processed in Morton order of their voxels */
+    bool            m_quantizeDistances;        /*!< true if distance grids must be written in 16 bits per voxel in the cache and the tiles (they stay in float in memory) */
     int             m_gridMode;                 /*!< grid mode */
     Eigen::Vector3d m_coordinates;              /*!< coordinates if gridMode == ...Coordinates... */
     Eigen::Vector3i m_dimensions;               /*!< dimensions if gridMode == ...CustomDimensions */
     QStringList     m_gridFilePath;             /*!< Name of .grid L-Architect reference 3D grid */
 
+    bool            m_useCache;                 /*!< true if grids must be saved in/loaded from the cache */
+    QStringList     m_cacheDirectory;           /*!< folder of the cache */
+    int             m_cacheMaxSize;             /*!< maximum size of the cache in Mo */
+    bool            m_clearCache;               /*!< true if the cache must be emptied before the compute */
+
+    bool            m_tiled;                    /*!< true if grids must be computed tile by tile and written on the disk */
+    QStringList     m_tilesDirectory;           /*!< folder where to write tiles */
+    int             m_memoryBudget;             /*!< maximum memory used by the grids of a tile and the rays of a scan in Mo */
+
+    bool            m_writeReport;              /*!< true if the timing report of the workers must be written in a JSON file */
+    QStringList     m_reportDirectory;          /*!< folder of the JSON report */
+
+    /**
+     * @brief Log the timing report of the workers and write it in a JSON file if asked
+     * @param defaultDirectory : folder used if no folder was chosen for the report
+     */
+    void logReport(const LVOX3_WorkersReport& report, const QString& defaultDirectory);
+
 private slots:
     /**
      * @brief Called from worker manager when progress changed
@@ -0,0 +1,174 @@
+#include "lvox3_columnfilter.h"
+
+#include "mk/tools/lvox3_gridtiling.h"
+#include "mk/tools/lvox3_rayboxintersectionmath.h"
+
+#include "ct_itemdrawable/abstract/ct_abstractimage2d.h"
+
+#include <limits>
+
+LVOX3_ColumnFilter::LVOX3_ColumnFilter(const LVOX3_GridTiling& tiling,
+                                       const CT_AbstractImage2D* mnt,
+                                       const CT_AbstractImage2D* sky)
+{
+    m_min = tiling.minBBox();
+    m_resolution = tiling.resolution();
+    m_xdim = tiling.xdim();
+    m_ydim = tiling.ydim();
+    m_zdim = tiling.zdim();
+    m_max = m_min + Eigen::Vector3d(m_xdim, m_ydim, m_zdim)*m_resolution;
+
+    const size_t nColumns = m_xdim*m_ydim;
+
+    m_lowLevel.resize(nColumns, 0);
+    m_highLevel.resize(nColumns, m_zdim-1);
+
+    CT_AbstractImage2D* rasters[2] = {(CT_AbstractImage2D*)mnt, (CT_AbstractImage2D*)sky};
+
+    for(int r=0; r<2; ++r) {
+        CT_AbstractImage2D* raster = rasters[r];
+
+        if(raster == NULL)
+            continue;
+
+        const double NAValue = raster->NAAsDouble();
+        size_t rasterIndex;
+
+        for(qint64 lin=0; lin<m_ydim; ++lin) {
+            for(qint64 col=0; col<m_xdim; ++col) {
+                // same coordinates than LVOX3_FilterVoxelsByZValuesOfRaster (top middle of the cell)
+                const double x = m_min.x() + (col*m_resolution) + (m_resolution/2.0);
+                const double y = m_min.y() + (lin*m_resolution) + (m_resolution/2.0);
+
+                raster->indexAtCoords(x, y, rasterIndex);
+                const double zValue = raster->valueAtIndexAsDouble(rasterIndex);
+
+                if(zValue == NAValue)
+                    continue;
+
+                const size_t column = lin*m_xdim + col;
+
+                // estimate the level and adjust it to have exactly the same comparison than the filter worker
+                qint64 level = (qint64)std::floor((zValue - m_min.z()) / m_resolution) - 1;
+
+                if(r == 0) {
+                    // filtered if the top of the cell is below the mnt
+                    level = qMax((qint64)0, qMin(level, m_zdim));
+
+                    while((level < m_zdim) && ((m_min.z() + (level+1)*m_resolution) < zValue))
+                        ++level;
+
+                    while((level > 0) && !((m_min.z() + level*m_resolution) < zValue))
+                        --level;
+
+                    m_lowLevel[column] = qMax(m_lowLevel[column], (qint32)level);
+                } else {
+                    // filtered if the top of the cell is above the sky
+                    level = qMax((qint64)-1, qMin(level, m_zdim-1));
+
+                    while((level >= 0) && ((m_min.z() + (level+1)*m_resolution) > zValue))
+                        --level;
+
+                    while((level < (m_zdim-1)) && !((m_min.z() + (level+2)*m_resolution) > zValue))
+                        ++level;
+
+                    m_highLevel[column] = qMin(m_highLevel[column], (qint32)level);
+                }
+            }
+        }
+    }
+}
+
+bool LVOX3_ColumnFilter::isFirstVoxelTouched(const Eigen::Vector3d& origin, const Eigen::Vector3d& direction, const Eigen::Vector3d& point) const
+{
+    Eigen::Vector3d start, end;
+
+    if(!LVOX3_RayBoxIntersectionMath::getIntersectionOfRay(m_min, m_max, origin, direction, start, end))
+        return false;
+
+    return (indexOf(start.x(), m_min.x(), m_xdim) == indexOf(point.x(), m_min.x(), m_xdim))
+            && (indexOf(start.y(), m_min.y(), m_ydim) == indexOf(point.y(), m_min.y(), m_ydim))
+            && (indexOf(start.z(), m_min.z(), m_zdim) == indexOf(point.z(), m_min.z(), m_zdim));
+}
+
+quint64 LVOX3_ColumnFilter::memoryBytes(const LVOX3_GridTiling& tiling)
+{
+    return 2 * ((quint64)tiling.xdim()) * tiling.ydim() * sizeof(qint32);
+}
+
+bool LVOX3_ColumnFilter::isSegmentFiltered(const Eigen::Vector3d& from, const Eigen::Vector3d& to) const
+{
+    const Eigen::Vector3d direction = to - from;
+    const double squaredLength = direction.squaredNorm();
+
+    if(squaredLength == 0)
+        return false;
+
+    Eigen::Vector3d start, end;
+
+    if(!LVOX3_RayBoxIntersectionMath::getIntersectionOfRay(m_min, m_max, from, direction, start, end))
+        return false;
+
+    // parameters of the part of the segment inside the grid
+    double t = (start - from).dot(direction) / squaredLength;
+    const double tEnd = qMin(1.0, (end - from).dot(direction) / squaredLength);
+
+    if(t >= tEnd)
+        return false;
+
+    // 2D traversal of the columns touched by the segment
+    const Eigen::Vector3d first = from + direction*t;
+
+    qint64 cl[2];
+    qint64 step[2];
+    double tMax[2];
+    double tDelta[2];
+    const qint64 dims[2] = {m_xdim, m_ydim};
+
+    for(int i=0; i<2; ++i) {
+        cl[i] = qMax((qint64)0, qMin((qint64)std::floor((first(i) - m_min(i)) / m_resolution), dims[i]-1));
+
+        if(direction(i) > 0) {
+            step[i] = 1;
+            tMax[i] = ((m_min(i) + (cl[i]+1)*m_resolution) - from(i)) / direction(i);
+            tDelta[i] = m_resolution / direction(i);
+        } else if(direction(i) < 0) {
+            step[i] = -1;
+            tMax[i] = ((m_min(i) + cl[i]*m_resolution) - from(i)) / direction(i);
+            tDelta[i] = -m_resolution / direction(i);
+        } else {
+            step[i] = 0;
+            tMax[i] = std::numeric_limits<double>::max();
+            tDelta[i] = std::numeric_limits<double>::max();
+        }
+    }
+
+    while(1) {
+        const int axis = (tMax[0] < tMax[1]) ? 0 : 1;
+        const double tExit = qMin(tMax[axis], tEnd);
+
+        // levels touched by the segment in this column
+        const double z0 = from.z() + direction.z()*t;
+        const double z1 = from.z() + direction.z()*tExit;
+        const qint64 lowLevel = levelOf(qMin(z0, z1));
+        const qint64 highLevel = levelOf(qMax(z0, z1));
+
+        const size_t column = cl[1]*m_xdim + cl[0];
+
+        if((lowLevel < m_lowLevel[column]) || (highLevel > m_highLevel[column]))
+            return true;
+
+        if(tExit >= tEnd)
+            return false;
+
+        cl[axis] += step[axis];
+
+        if((cl[axis] < 0) || (cl[axis] >= dims[axis]))
+            return false;
+
+        t = tMax[axis];
+        tMax[axis] += tDelta[axis];
+    }
+
+    return false;
+}
@@ -0,0 +1,75 @@
+#ifndef LVOX3_COLUMNFILTER_H
+#define LVOX3_COLUMNFILTER_H
+
+#include "Eigen/Core"
+
+#include <QtGlobal>
+
+#include <vector>
+#include <cmath>
+
+class CT_AbstractImage2D;
+class LVOX3_GridTiling;
+
+/**
+ * @brief Keep for each column of a grid the range of levels that are not filtered by
+ *        the MNT and the sky. It is the same filter than LVOX3_FilterVoxelsByZValuesOfRaster
+ *        but it use only two values per column so it can be used for a whole grid that
+ *        don't fit in memory.
+ */
+class LVOX3_ColumnFilter
+{
+public:
+    /**
+     * @brief Compute the filter for the grid defined by the tiling
+     * @param mnt : voxels below the mnt are filtered (optionnal)
+     * @param sky : voxels above the sky are filtered (optionnal)
+     */
+    LVOX3_ColumnFilter(const LVOX3_GridTiling& tiling,
+                       const CT_AbstractImage2D* mnt,
+                       const CT_AbstractImage2D* sky);
+
+    /**
+     * @brief Returns true if the segment [from;to] touch a filtered voxel of the grid. Use it to know
+     *        if a ray was stopped before entering a tile, the part of the segment outside the grid is ignored.
+     */
+    bool isSegmentFiltered(const Eigen::Vector3d& from, const Eigen::Vector3d& to) const;
+
+    /**
+     * @brief Returns true if the voxel of the grid that contains "point" is the first voxel touched by
+     *        the ray. Use it to know if the voxel where a ray enters a tile is where it enters the grid.
+     */
+    bool isFirstVoxelTouched(const Eigen::Vector3d& origin, const Eigen::Vector3d& direction, const Eigen::Vector3d& point) const;
+
+    /**
+     * @brief Returns the memory used by the filter of the grid defined by the tiling
+     */
+    static quint64 memoryBytes(const LVOX3_GridTiling& tiling);
+
+private:
+    Eigen::Vector3d         m_min;
+    Eigen::Vector3d         m_max;
+    double                  m_resolution;
+    qint64                  m_xdim;
+    qint64                  m_ydim;
+    qint64                  m_zdim;
+    std::vector<qint32>     m_lowLevel;     /*! first level not filtered of each column */
+    std::vector<qint32>     m_highLevel;    /*! last level not filtered of each column */
+
+    /**
+     * @brief Returns the level of the coordinate z clamped to the grid
+     */
+    inline qint64 levelOf(double z) const {
+        return indexOf(z, m_min.z(), m_zdim);
+    }
+
+    /**
+     * @brief Returns the column, line or level of the coordinate clamped to the grid
+     */
+    inline qint64 indexOf(double c, double min, qint64 dim) const {
+        const qint64 index = (qint64)std::floor((c - min) / m_resolution);
+        return qMax((qint64)0, qMin(index, dim-1));
+    }
+};
+
+#endif // LVOX3_COLUMNFILTER_H
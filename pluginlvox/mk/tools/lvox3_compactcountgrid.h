@@ -0,0 +1,121 @@
+#ifndef LVOX3_COMPACTCOUNTGRID_H
+#define LVOX3_COMPACTCOUNTGRID_H
+
+#include "mk/tools/lvox3_gridtype.h"
+#include "mk/tools/lvox3_errorcode.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <vector>
+
+/*!
+ * @brief Values of a count grid (ni, nt, nb) stored in 16 bits per voxel.
+ *
+ * Almost all counts are small : a voxel stores its value shifted by the lowest error code, so the
+ * error codes (lvox::ErrorOrWarningCode) and the counts up to 65525 use 2 bytes. A greater value is
+ * promoted in a sparse overflow map and the voxel keeps a marker. The value of a voxel is the same
+ * as in a lvox::Grid3Di, only the memory is halved.
+ *
+ * Like a CT_Grid3D two threads must not modify the same voxel at the same time (use a mutex per
+ * voxel), modifications of different voxels can be done by several threads.
+ */
+class LVOX3_CompactCountGrid
+{
+public:
+    LVOX3_CompactCountGrid(size_t nCells, lvox::Grid3DiType initValue = 0) : m_values(nCells)
+    {
+        for(size_t i = 0 ; i < nCells ; ++i)
+            setValueAtIndex(i, initValue);
+    }
+
+    /**
+     * @brief Create a compact grid with the values of a grid
+     */
+    static LVOX3_CompactCountGrid* fromGrid(const lvox::Grid3Di* grid)
+    {
+        const size_t nCells = grid->nCells();
+        LVOX3_CompactCountGrid* compact = new LVOX3_CompactCountGrid(nCells);
+
+        for(size_t i = 0 ; i < nCells ; ++i)
+            compact->setValueAtIndex(i, grid->valueAtIndex(i));
+
+        return compact;
+    }
+
+    size_t nCells() const { return m_values.size(); }
+
+    lvox::Grid3DiType valueAtIndex(size_t index) const
+    {
+        const quint16 stored = m_values[index];
+
+        if(stored != OVERFLOW_MARKER)
+            return ((lvox::Grid3DiType)stored) + lvox::Max_Error_Code;
+
+        QMutexLocker locker(&m_overflowMutex);
+        return m_overflow.value(index);
+    }
+
+    void setValueAtIndex(size_t index, lvox::Grid3DiType value)
+    {
+        const qint64 stored = ((qint64)value) - lvox::Max_Error_Code;
+
+        if((stored >= 0) && (stored < OVERFLOW_MARKER)) {
+            // a voxel that goes back under the limit leaves the overflow map
+            if(m_values[index] == OVERFLOW_MARKER) {
+                QMutexLocker locker(&m_overflowMutex);
+                m_overflow.remove(index);
+            }
+
+            m_values[index] = (quint16)stored;
+            return;
+        }
+
+        QMutexLocker locker(&m_overflowMutex);
+        m_overflow.insert(index, value);
+        m_values[index] = OVERFLOW_MARKER;
+    }
+
+    void addValueAtIndex(size_t index, lvox::Grid3DiType value)
+    {
+        setValueAtIndex(index, valueAtIndex(index) + value);
+    }
+
+    /**
+     * @brief Copy the values in a grid of same dimensions
+     */
+    void copyTo(lvox::Grid3Di* grid) const
+    {
+        const size_t n = nCells();
+
+        for(size_t i = 0 ; i < n ; ++i)
+            grid->setValueAtIndex(i, valueAtIndex(i));
+    }
+
+    /**
+     * @brief Returns the number of voxels promoted in the overflow map
+     */
+    size_t nOverflows() const
+    {
+        QMutexLocker locker(&m_overflowMutex);
+        return m_overflow.size();
+    }
+
+    /**
+     * @brief Returns the memory used by the values (the overflow map is estimated)
+     */
+    quint64 memoryBytes() const
+    {
+        return (m_values.size() * sizeof(quint16)) + (nOverflows() * (sizeof(size_t) + sizeof(lvox::Grid3DiType) + 2*sizeof(void*)));
+    }
+
+private:
+    static const quint16 OVERFLOW_MARKER = 0xFFFF;
+
+    std::vector<quint16>                    m_values;
+    QHash<size_t, lvox::Grid3DiType>        m_overflow;
+    mutable QMutex                          m_overflowMutex;
+};
+
+#endif // LVOX3_COMPACTCOUNTGRID_H
@@ -0,0 +1,61 @@
+#ifndef LVOX3_FIXEDPOINTSUMGRID_H
+#define LVOX3_FIXEDPOINTSUMGRID_H
+
+#include "mk/tools/lvox3_gridtype.h"
+
+#include <QAtomicInteger>
+
+#include <cmath>
+#include <vector>
+
+/*!
+ * @brief Sums of values per voxel that can be added from several threads and that do not
+ *        depend on the order of the additions.
+ *
+ * Values are rounded to a multiple of 1/scale() and added in 64 bits integers, so the sum is the same
+ * whatever the number of threads. With a scale of 2^28 a sum can reach 3e10 (meters of rays in a voxel)
+ * and the rounding (4e-9) is far below the precision of the float grids.
+ */
+class LVOX3_FixedPointSumGrid
+{
+public:
+    LVOX3_FixedPointSumGrid(size_t nCells) : m_sums(nCells) {}
+
+    /**
+     * @brief Add a value to the sum of a voxel (thread safe)
+     */
+    void addValueAtIndex(size_t index, double value)
+    {
+        m_sums[index].fetchAndAddRelaxed((qint64)std::llround(value * scale()));
+    }
+
+    double valueAtIndex(size_t index) const
+    {
+        return m_sums[index].load() / scale();
+    }
+
+    /**
+     * @brief Add the sums to the values of a grid of same dimensions (a single rounding to float per voxel)
+     */
+    void addTo(lvox::Grid3Df* grid) const
+    {
+        const size_t nCells = m_sums.size();
+
+        for(size_t i = 0 ; i < nCells ; ++i) {
+            const qint64 sum = m_sums[i].load();
+
+            if(sum != 0)
+                grid->setValueAtIndex(i, grid->valueAtIndex(i) + (lvox::Grid3DfType)(sum / scale()));
+        }
+    }
+
+private:
+    std::vector< QAtomicInteger<qint64> >   m_sums;
+
+    /**
+     * @brief Number of units per 1.0 (2^28)
+     */
+    static double scale() { return 268435456.0; }
+};
+
+#endif // LVOX3_FIXEDPOINTSUMGRID_H
@@ -0,0 +1,336 @@
+#include "lvox3_gridcache.h"
+
+#include "mk/tools/lvox3_quantizeddistancegrid.h"
+
+#include "ct_itemdrawable/ct_scene.h"
+#include "ct_itemdrawable/abstract/ct_abstractimage2d.h"
+#include "ct_itemdrawable/tools/scanner/ct_shootingpattern.h"
+#include "ct_iterator/ct_pointiterator.h"
+
+#include <QCryptographicHash>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QVector>
+#include <QRegExp>
+
+#include <algorithm>
+
+// change it if the algorithm that compute the grids change, all old entries will be ignored
+#define LVOX3_GRIDCACHE_VERSION "LVOX3_GRIDCACHE_1"
+#define LVOX3_GRIDCACHE_TIMESTAMP "last_use"
+
+const double LVOX3_GridCache::EPSILON = 0.000001;
+
+namespace {
+    /**
+     * @brief Hash values by blocks to limit the number of calls to addData
+     */
+    class BlockHasher {
+    public:
+        BlockHasher(QCryptographicHash& hash) : m_hash(hash) { m_block.reserve(BLOCK_SIZE); }
+        ~BlockHasher() { flush(); }
+
+        void add(double v)
+        {
+            m_block.append(v);
+
+            if(m_block.size() == BLOCK_SIZE)
+                flush();
+        }
+
+        void add(const Eigen::Vector3d& v)
+        {
+            add(v.x());
+            add(v.y());
+            add(v.z());
+        }
+
+        void flush()
+        {
+            m_hash.addData((const char*)m_block.constData(), m_block.size()*sizeof(double));
+            m_block.resize(0);
+        }
+
+    private:
+        static const int BLOCK_SIZE = 3*4096;
+
+        QCryptographicHash& m_hash;
+        QVector<double>     m_block;
+    };
+
+    void addRaster(BlockHasher& hasher, const CT_AbstractImage2D* raster)
+    {
+        if(raster == NULL) {
+            hasher.add(0.0);
+            return;
+        }
+
+        Eigen::Vector3d min, max;
+        ((CT_AbstractImage2D*)raster)->getBoundingBox(min, max);
+
+        const size_t nCells = raster->nCells();
+
+        hasher.add(nCells);
+        hasher.add(min);
+        hasher.add(max);
+
+        for(size_t i=0; i<nCells; ++i)
+            hasher.add(raster->valueAtIndexAsDouble(i));
+    }
+
+    struct EntryInfo {
+        QString     path;
+        QDateTime   lastUse;
+        qint64      size;
+
+        bool operator<(const EntryInfo& other) const { return lastUse < other.lastUse; }
+    };
+
+    /**
+     * @brief Returns true if the folder is an entry of the cache : its name is a key (SHA-1 in hexadecimal)
+     *        and it contains the timestamp file. Other folders are never modified by the cache.
+     */
+    bool isCacheEntry(const QFileInfo& entryInfo)
+    {
+        const QRegExp keyFormat("[0-9a-f]{40}");
+
+        return keyFormat.exactMatch(entryInfo.fileName())
+                && QDir(entryInfo.absoluteFilePath()).exists(LVOX3_GRIDCACHE_TIMESTAMP);
+    }
+
+    /**
+     * @brief Remove the files written by the cache in the entry, then the folder if it is empty
+     */
+    void removeEntry(const QString& path)
+    {
+        QDir entryDir(path);
+        const QString suffix = LVOX_BinaryGrid3DFile::suffix();
+
+        foreach (const QString& fileName, entryDir.entryList(QStringList() << ("*." + suffix) << ("*." + suffix + ".tmp"), QDir::Files))
+            entryDir.remove(fileName);
+
+        entryDir.remove(LVOX3_GRIDCACHE_TIMESTAMP);
+
+        QDir().rmdir(path);
+    }
+}
+
+LVOX3_GridCache::LVOX3_GridCache(const QString& directory, qint64 maxSizeInBytes)
+{
+    m_directory = QDir(directory);
+    m_maxSize = maxSizeInBytes;
+    m_valid = !directory.isEmpty() && m_directory.mkpath(".");
+}
+
+bool LVOX3_GridCache::isValid() const
+{
+    return m_valid;
+}
+
+QByteArray LVOX3_GridCache::computeKey(const Inputs& inputs)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(LVOX3_GRIDCACHE_VERSION);
+    hash.addData(inputs.parameters.toUtf8());
+
+    {
+        BlockHasher hasher(hash);
+
+        // geometry of the grid
+        const CT_AbstractGrid3D* grid = inputs.grid;
+        hasher.add(grid->minX());
+        hasher.add(grid->minY());
+        hasher.add(grid->minZ());
+        hasher.add(grid->xdim());
+        hasher.add(grid->ydim());
+        hasher.add(grid->zdim());
+        hasher.add(grid->resolution());
+
+        // shooting pattern
+        const CT_ShootingPattern* pattern = inputs.pattern;
+        const size_t nShots = pattern->getNumberOfShots();
+        Eigen::Vector3d direction;
+
+        hasher.add(pattern->getOrigin());
+        hasher.add(nShots);
+
+        for(size_t i=0; i<nShots; ++i) {
+            pattern->getShotDirectionAt(i, direction);
+            hasher.add(direction);
+        }
+
+        // points of the scene
+        const CT_AbstractPointCloudIndex* pointCloudIndex = inputs.scene->getPointCloudIndex();
+        CT_PointIterator itP(pointCloudIndex);
+
+        hasher.add(pointCloudIndex->size());
+
+        while(itP.hasNext()) {
+            const CT_Point &point = itP.next().currentPoint();
+            hasher.add(point.x());
+            hasher.add(point.y());
+            hasher.add(point.z());
+        }
+
+        // rasters used to filter voxels
+        addRaster(hasher, inputs.mnt);
+        addRaster(hasher, inputs.sky);
+    }
+
+    return hash.result().toHex();
+}
+
+bool LVOX3_GridCache::contains(const QByteArray& key, const QStringList& gridNames) const
+{
+    if(!m_valid)
+        return false;
+
+    foreach (const QString& name, gridNames) {
+        if(!LVOX_BinaryGrid3DFile::isBinaryGridFile(gridFilePath(key, name)))
+            return false;
+    }
+
+    return true;
+}
+
+bool LVOX3_GridCache::save(const QByteArray& key, const QString& gridName, const CT_AbstractGrid3D* grid) const
+{
+    return saveFile(key, gridName, [grid](const QString& filePath) {
+        return LVOX_BinaryGrid3DFile::write(grid, filePath);
+    });
+}
+
+bool LVOX3_GridCache::saveQuantizedDistances(const QByteArray& key, const QString& gridName, const lvox::Grid3Df* grid, size_t* nClamped) const
+{
+    return saveFile(key, gridName, [grid, nClamped](const QString& filePath) {
+        return LVOX3_QuantizedDistanceGrid::write(grid, filePath, nClamped);
+    });
+}
+
+bool LVOX3_GridCache::loadDistances(const QByteArray& key, const QString& gridName, lvox::Grid3Df* grid) const
+{
+    LVOX_MappedGrid3D<quint16> mapped;
+
+    // not quantized
+    if(!LVOX3_QuantizedDistanceGrid::open(mapped, gridFilePath(key, gridName)))
+        return load(key, gridName, grid);
+
+    if(!isSameGeometry(mapped.header(), grid))
+        return false;
+
+    LVOX3_QuantizedDistanceGrid::copyTo(mapped, grid);
+    grid->computeMinMax();
+
+    touch(key);
+
+    return true;
+}
+
+bool LVOX3_GridCache::saveFile(const QByteArray& key, const QString& gridName, const std::function<bool (const QString&)>& writer) const
+{
+    if(!m_valid || !m_directory.mkpath(QString(key)))
+        return false;
+
+    const QString filePath = gridFilePath(key, gridName);
+
+    // write in a temporary file first so a partially written grid is never used
+    const QString tmpFilePath = filePath + ".tmp";
+
+    if(!writer(tmpFilePath)) {
+        QFile::remove(tmpFilePath);
+        return false;
+    }
+
+    QFile::remove(filePath);
+
+    if(!QFile::rename(tmpFilePath, filePath)) {
+        QFile::remove(tmpFilePath);
+        return false;
+    }
+
+    touch(key);
+
+    return true;
+}
+
+void LVOX3_GridCache::trim() const
+{
+    if(!m_valid || (m_maxSize <= 0))
+        return;
+
+    QList<EntryInfo> entries;
+    qint64 totalSize = 0;
+
+    foreach (const QFileInfo& entryInfo, m_directory.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        if(!isCacheEntry(entryInfo))
+            continue;
+
+        EntryInfo entry;
+        entry.path = entryInfo.absoluteFilePath();
+        entry.size = 0;
+
+        QDir entryDir(entry.path);
+
+        foreach (const QFileInfo& fileInfo, entryDir.entryInfoList(QDir::Files))
+            entry.size += fileInfo.size();
+
+        entry.lastUse = QFileInfo(entryDir.filePath(LVOX3_GRIDCACHE_TIMESTAMP)).lastModified();
+
+        totalSize += entry.size;
+        entries.append(entry);
+    }
+
+    std::sort(entries.begin(), entries.end());
+
+    QListIterator<EntryInfo> it(entries);
+
+    while(it.hasNext()
+          && (totalSize > m_maxSize)) {
+        const EntryInfo& entry = it.next();
+
+        removeEntry(entry.path);
+        totalSize -= entry.size;
+    }
+}
+
+void LVOX3_GridCache::clear() const
+{
+    if(!m_valid)
+        return;
+
+    foreach (const QFileInfo& entryInfo, m_directory.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        if(isCacheEntry(entryInfo))
+            removeEntry(entryInfo.absoluteFilePath());
+    }
+}
+
+bool LVOX3_GridCache::isSameGeometry(const LVOX_BinaryGrid3DFile::Header& header, const CT_AbstractGrid3D* grid)
+{
+    return (header.xdim == grid->xdim())
+            && (header.ydim == grid->ydim())
+            && (header.zdim == grid->zdim())
+            && (std::fabs(header.minX - grid->minX()) <= EPSILON)
+            && (std::fabs(header.minY - grid->minY()) <= EPSILON)
+            && (std::fabs(header.minZ - grid->minZ()) <= EPSILON)
+            && (std::fabs(header.resolution - grid->resolution()) <= EPSILON);
+}
+
+QString LVOX3_GridCache::entryPath(const QByteArray& key) const
+{
+    return m_directory.filePath(QString(key));
+}
+
+QString LVOX3_GridCache::gridFilePath(const QByteArray& key, const QString& gridName) const
+{
+    return QDir(entryPath(key)).filePath(gridName + "." + LVOX_BinaryGrid3DFile::suffix());
+}
+
+void LVOX3_GridCache::touch(const QByteArray& key) const
+{
+    QFile f(QDir(entryPath(key)).filePath(LVOX3_GRIDCACHE_TIMESTAMP));
+
+    if(f.open(QFile::WriteOnly | QFile::Truncate)) {
+        f.write(QDateTime::currentDateTime().toString(Qt::ISODate).toUtf8());
+        f.close();
+    }
+}
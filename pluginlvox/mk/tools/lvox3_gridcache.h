@@ -0,0 +1,147 @@
+#ifndef LVOX3_GRIDCACHE_H
+#define LVOX3_GRIDCACHE_H
+
+#include "ct_itemdrawable/ct_grid3d.h"
+
+#include "mk/tools/lvox3_gridtype.h"
+#include "tools/lvox_binarygrid3d.h"
+
+#include <QString>
+#include <QByteArray>
+#include <QDir>
+
+#include <cmath>
+#include <functional>
+
+class CT_Scene;
+class CT_ShootingPattern;
+class CT_AbstractImage2D;
+
+/**
+ * @brief On-disk cache of the grids computed for one scan. Each entry is a folder named
+ *        by the fingerprint of the inputs of the computation and contains one binary grid
+ *        (LVG3D) per output. When the total size of the cache exceed the limit, the entries
+ *        that were not used for the longest time are removed.
+ */
+class LVOX3_GridCache
+{
+public:
+    /**
+     * @brief Inputs that define the content of the grids of one scan
+     */
+    struct Inputs {
+        Inputs() : scene(NULL), pattern(NULL), mnt(NULL), sky(NULL), grid(NULL) {}
+
+        const CT_Scene*             scene;
+        const CT_ShootingPattern*   pattern;
+        const CT_AbstractImage2D*   mnt;        /*!< optionnal */
+        const CT_AbstractImage2D*   sky;        /*!< optionnal */
+        const CT_AbstractGrid3D*    grid;       /*!< used for the geometry (bounding box, dimensions and resolution) */
+        QString                     parameters; /*!< other parameters that change the output (per example if distances are computed) */
+    };
+
+    /**
+     * @brief Create a cache in the folder "directory"
+     * @param maxSizeInBytes : maximum size of the cache on the disk (0 means no limit)
+     */
+    LVOX3_GridCache(const QString& directory, qint64 maxSizeInBytes);
+
+    /**
+     * @brief Returns false if the folder of the cache can not be created
+     */
+    bool isValid() const;
+
+    /**
+     * @brief Returns the fingerprint of the inputs. Point coordinates, shots, rasters and the
+     *        geometry of the grid are hashed so any change in the inputs gives a new key.
+     */
+    static QByteArray computeKey(const Inputs& inputs);
+
+    /**
+     * @brief Returns true if all grids named "gridNames" are in the cache for this key
+     */
+    bool contains(const QByteArray& key, const QStringList& gridNames) const;
+
+    /**
+     * @brief Copy the cached values in the grid. The grid must have the same geometry and
+     *        the same type than the saved one.
+     * @return false if the grid is not in the cache or if it is not compatible
+     */
+    template<typename T>
+    bool load(const QByteArray& key, const QString& gridName, CT_Grid3D<T>* grid) const
+    {
+        LVOX_MappedGrid3D<T> mapped;
+
+        if(!mapped.open(gridFilePath(key, gridName)))
+            return false;
+
+        if(!isSameGeometry(mapped.header(), grid))
+            return false;
+
+        const size_t nCells = mapped.nCells();
+        const T* values = mapped.values();
+
+        for(size_t i=0; i<nCells; ++i)
+            grid->setValueAtIndex(i, values[i]);
+
+        grid->computeMinMax();
+
+        touch(key);
+
+        return true;
+    }
+
+    /**
+     * @brief Save the grid in the cache
+     */
+    bool save(const QByteArray& key, const QString& gridName, const CT_AbstractGrid3D* grid) const;
+
+    /**
+     * @brief Save a grid of mean distances in 16 bits per voxel (see LVOX3_QuantizedDistanceGrid)
+     * @param nClamped : if not NULL, the number of values that could not be stored exactly is added to it
+     */
+    bool saveQuantizedDistances(const QByteArray& key, const QString& gridName, const lvox::Grid3Df* grid, size_t* nClamped = NULL) const;
+
+    /**
+     * @brief Copy the cached distances in the grid, they can be saved with save or with saveQuantizedDistances
+     * @return false if the grid is not in the cache or if it is not compatible
+     */
+    bool loadDistances(const QByteArray& key, const QString& gridName, lvox::Grid3Df* grid) const;
+
+    /**
+     * @brief Remove the least recently used entries until the size of the cache is under the limit
+     */
+    void trim() const;
+
+    /**
+     * @brief Remove all entries of the cache
+     */
+    void clear() const;
+
+private:
+    static const double EPSILON;
+
+    QDir    m_directory;
+    qint64  m_maxSize;
+    bool    m_valid;
+
+    QString entryPath(const QByteArray& key) const;
+    QString gridFilePath(const QByteArray& key, const QString& gridName) const;
+
+    /**
+     * @brief Write a grid file of the entry with the function "writer" (called with the path of a temporary file)
+     */
+    bool saveFile(const QByteArray& key, const QString& gridName, const std::function<bool (const QString&)>& writer) const;
+
+    /**
+     * @brief Returns true if the file has the geometry of the grid
+     */
+    static bool isSameGeometry(const LVOX_BinaryGrid3DFile::Header& header, const CT_AbstractGrid3D* grid);
+
+    /**
+     * @brief Mark the entry as used now
+     */
+    void touch(const QByteArray& key) const;
+};
+
+#endif // LVOX3_GRIDCACHE_H
@@ -0,0 +1,140 @@
+#ifndef LVOX3_GRIDTILING_H
+#define LVOX3_GRIDTILING_H
+
+#include "Eigen/Core"
+
+#include <QVector>
+
+#include <cmath>
+
+/**
+ * @brief Split the geometry of a grid in tiles in the xy plane. Each tile contains
+ *        all levels of the grid so the voxels of a tile are in the same order than in a grid.
+ */
+class LVOX3_GridTiling
+{
+public:
+    struct Tile {
+        size_t  col;    /*! first column of the tile in the global grid */
+        size_t  lin;    /*! first line of the tile in the global grid */
+        size_t  xdim;
+        size_t  ydim;
+    };
+
+    /**
+     * @brief Create the tiling of a grid that bounds the box [minBBox;maxBBox]
+     */
+    LVOX3_GridTiling(const Eigen::Vector3d& minBBox,
+                     const Eigen::Vector3d& maxBBox,
+                     double resolution,
+                     size_t tileXDim,
+                     size_t tileYDim) {
+        m_min = minBBox;
+        m_resolution = resolution;
+
+        m_xdim = computeDim(minBBox.x(), maxBBox.x(), resolution);
+        m_ydim = computeDim(minBBox.y(), maxBBox.y(), resolution);
+        m_zdim = computeDim(minBBox.z(), maxBBox.z(), resolution);
+
+        tileXDim = qMax((size_t)1, qMin(tileXDim, m_xdim));
+        tileYDim = qMax((size_t)1, qMin(tileYDim, m_ydim));
+
+        m_tileXDim = tileXDim;
+        m_tileYDim = tileYDim;
+        m_nTileColumns = (m_xdim + tileXDim - 1) / tileXDim;
+
+        for(size_t lin=0; lin<m_ydim; lin += tileYDim) {
+            for(size_t col=0; col<m_xdim; col += tileXDim) {
+                Tile tile;
+                tile.col = col;
+                tile.lin = lin;
+                tile.xdim = qMin(tileXDim, m_xdim - col);
+                tile.ydim = qMin(tileYDim, m_ydim - lin);
+                m_tiles.append(tile);
+            }
+        }
+    }
+
+    /**
+     * @brief Returns the number of voxels between min and max. Like a grid created with
+     *        "extends" the maximum coordinate is always inside the grid.
+     */
+    static size_t computeDim(double min, double max, double resolution) {
+        size_t dim = (size_t)std::ceil((max - min)/resolution);
+
+        while((min + dim*resolution) <= max)
+            ++dim;
+
+        return dim;
+    }
+
+    /**
+     * @brief Returns the size (in number of voxels in x and y) of square tiles
+     *        that use at most "memoryBudget" bytes
+     * @param bytesPerVoxel : size of all values stored for one voxel
+     */
+    static size_t computeTileSize(quint64 memoryBudget, size_t zdim, size_t bytesPerVoxel) {
+        const double nColumns = ((double)memoryBudget) / (qMax((size_t)1, zdim) * qMax((size_t)1, bytesPerVoxel));
+
+        return qMax((size_t)1, (size_t)std::floor(std::sqrt(nColumns)));
+    }
+
+    const Eigen::Vector3d& minBBox() const { return m_min; }
+    double resolution() const { return m_resolution; }
+    size_t xdim() const { return m_xdim; }
+    size_t ydim() const { return m_ydim; }
+    size_t zdim() const { return m_zdim; }
+
+    const QVector<Tile>& tiles() const { return m_tiles; }
+
+    /**
+     * @brief Call f(index) for each tile (index in tiles()) that intersects the box [min;max] in the xy plane. A
+     *        margin of half a voxel is added to the box so a tile that only touches it is also used.
+     */
+    template<typename Function>
+    void forEachTileInBox(const Eigen::Vector3d& min, const Eigen::Vector3d& max, const Function& f) const {
+        const size_t firstCol = columnOf(min.x() - m_min.x() - m_resolution/2.0, m_xdim) / m_tileXDim;
+        const size_t lastCol = columnOf(max.x() - m_min.x() + m_resolution/2.0, m_xdim) / m_tileXDim;
+        const size_t firstLin = columnOf(min.y() - m_min.y() - m_resolution/2.0, m_ydim) / m_tileYDim;
+        const size_t lastLin = columnOf(max.y() - m_min.y() + m_resolution/2.0, m_ydim) / m_tileYDim;
+
+        for(size_t lin=firstLin; lin<=lastLin; ++lin) {
+            for(size_t col=firstCol; col<=lastCol; ++col)
+                f((int)(lin*m_nTileColumns + col));
+        }
+    }
+
+    /**
+     * @brief Returns the min coordinates of the tile
+     */
+    Eigen::Vector3d tileMinBBox(const Tile& tile) const {
+        return Eigen::Vector3d(m_min.x() + tile.col*m_resolution,
+                               m_min.y() + tile.lin*m_resolution,
+                               m_min.z());
+    }
+
+private:
+    Eigen::Vector3d m_min;
+    double          m_resolution;
+    size_t          m_xdim;
+    size_t          m_ydim;
+    size_t          m_zdim;
+    size_t          m_tileXDim;
+    size_t          m_tileYDim;
+    size_t          m_nTileColumns;
+    QVector<Tile>   m_tiles;
+
+    /**
+     * @brief Returns the column (or line) at the distance "d" of the minimum, clamped to [0;dim-1]
+     */
+    size_t columnOf(double d, size_t dim) const {
+        const double c = std::floor(d / m_resolution);
+
+        if(c <= 0)
+            return 0;
+
+        return qMin((size_t)c, dim-1);
+    }
+};
+
+#endif // LVOX3_GRIDTILING_H
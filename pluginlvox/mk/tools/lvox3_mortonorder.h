@@ -0,0 +1,111 @@
+#ifndef LVOX3_MORTONORDER_H
+#define LVOX3_MORTONORDER_H
+
+#include "Eigen/Core"
+
+#include <QtGlobal>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/**
+ * @brief Morton (Z-order) codes to process points and rays in an order where consecutive
+ *        elements touch close voxels, so the grids stay in the cache between two rays
+ */
+class LVOX3_MortonOrder
+{
+public:
+    /**
+     * @brief Interleave the bits of x, y and z (21 bits each)
+     */
+    static quint64 encode3D(quint32 x, quint32 y, quint32 z)
+    {
+        return spread3(x) | (spread3(y) << 1) | (spread3(z) << 2);
+    }
+
+    /**
+     * @brief Interleave the bits of a and b (16 bits each, upper bits are ignored)
+     */
+    static quint64 encode2D(quint32 a, quint32 b)
+    {
+        return spread2(a) | (spread2(b) << 1);
+    }
+
+    /**
+     * @brief Code of the voxel that contains the point, in a grid starting at "min". Points
+     *        outside the grid are clamped to its border.
+     */
+    static quint64 voxelCode(const Eigen::Vector3d& point, const Eigen::Vector3d& min, double resolution)
+    {
+        return encode3D(clampedCell(point.x() - min.x(), resolution),
+                        clampedCell(point.y() - min.y(), resolution),
+                        clampedCell(point.z() - min.z(), resolution));
+    }
+
+    /**
+     * @brief Code of a direction (azimuth and zenith angles quantized on 16 bits). Rays with the
+     *        same origin and close codes go through close voxels.
+     */
+    static quint64 directionCode(const Eigen::Vector3d& direction)
+    {
+        const double norm = direction.norm();
+
+        if(norm <= 0)
+            return 0;
+
+        const double pi = 3.14159265358979323846;
+        const double azimuth = std::atan2(direction.y(), direction.x()) + pi;          // [0;2pi]
+        const double zenith = std::acos(qBound(-1.0, direction.z() / norm, 1.0));      // [0;pi]
+
+        const quint32 a = (quint32)qMin(65535.0, (azimuth / (2*pi)) * 65536.0);
+        const quint32 z = (quint32)qMin(65535.0, (zenith / pi) * 65536.0);
+
+        return encode2D(a, z);
+    }
+
+    /**
+     * @brief Returns the indices of the elements sorted by code (elements with the same code keep their order)
+     */
+    static std::vector<size_t> sortedOrder(const std::vector<quint64>& codes)
+    {
+        std::vector<size_t> order(codes.size());
+
+        for(size_t i = 0 ; i < order.size() ; ++i)
+            order[i] = i;
+
+        std::stable_sort(order.begin(), order.end(), [&codes](size_t a, size_t b) { return codes[a] < codes[b]; });
+
+        return order;
+    }
+
+private:
+    static quint64 spread3(quint32 v)
+    {
+        quint64 x = v & 0x1fffff;
+        x = (x | (x << 32)) & 0x1f00000000ffffULL;
+        x = (x | (x << 16)) & 0x1f0000ff0000ffULL;
+        x = (x | (x << 8))  & 0x100f00f00f00f00fULL;
+        x = (x | (x << 4))  & 0x10c30c30c30c30c3ULL;
+        x = (x | (x << 2))  & 0x1249249249249249ULL;
+        return x;
+    }
+
+    static quint64 spread2(quint32 v)
+    {
+        quint64 x = v & 0xffff;
+        x = (x | (x << 8))  & 0x00ff00ff00ff00ffULL;
+        x = (x | (x << 4))  & 0x0f0f0f0f0f0f0f0fULL;
+        x = (x | (x << 2))  & 0x3333333333333333ULL;
+        x = (x | (x << 1))  & 0x5555555555555555ULL;
+        return x;
+    }
+
+    static quint32 clampedCell(double offset, double resolution)
+    {
+        const double cell = std::floor(offset / resolution);
+        return (quint32)qBound(0.0, cell, 2097151.0);
+    }
+};
+
+#endif // LVOX3_MORTONORDER_H
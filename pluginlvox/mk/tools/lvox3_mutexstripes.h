@@ -0,0 +1,41 @@
+#ifndef LVOX3_MUTEXSTRIPES_H
+#define LVOX3_MUTEXSTRIPES_H
+
+#include "mk/tools/lvox3_gridtype.h"
+
+/*!
+ * @brief Mutexes for the voxels of a grid, to use with visitors that write in a grid from several
+ *        threads. A mutex (or a pointer to a mutex) per voxel would be too big for large grids so a
+ *        voxel uses the mutex of its index modulo the number of mutexes.
+ */
+class LVOX3_MutexStripes
+{
+public:
+    LVOX3_MutexStripes(int nMutex = 4096)
+    {
+        m_mutexes.resize(nMutex);
+
+        for(int i = 0 ; i < nMutex ; ++i)
+            m_mutexes[i] = new lvox::MutexType();
+    }
+
+    ~LVOX3_MutexStripes()
+    {
+        qDeleteAll(m_mutexes.begin(), m_mutexes.end());
+    }
+
+    /**
+     * @brief Returns the mutex of a voxel
+     */
+    lvox::MutexType* mutexAt(size_t index) const
+    {
+        return m_mutexes[index % m_mutexes.size()];
+    }
+
+private:
+    std::vector<lvox::MutexType*>   m_mutexes;
+
+    Q_DISABLE_COPY(LVOX3_MutexStripes)
+};
+
+#endif // LVOX3_MUTEXSTRIPES_H
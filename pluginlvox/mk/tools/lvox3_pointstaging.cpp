@@ -0,0 +1,73 @@
+#include "lvox3_pointstaging.h"
+
+#include "mk/tools/lvox3_mortonorder.h"
+
+#include "ct_iterator/ct_pointiterator.h"
+
+LVOX3_PointStaging::LVOX3_PointStaging(const CT_AbstractPointCloudIndex* pointCloudIndex)
+{
+    const size_t n = pointCloudIndex->size();
+
+    m_x.resize(n);
+    m_y.resize(n);
+    m_z.resize(n);
+
+    CT_PointIterator itP(pointCloudIndex);
+    size_t i = 0;
+
+    while(itP.hasNext()) {
+        const CT_Point &point = itP.next().currentPoint();
+
+        m_x[i] = point.x();
+        m_y[i] = point.y();
+        m_z[i] = point.z();
+        ++i;
+    }
+}
+
+void LVOX3_PointStaging::markInside(const Eigen::Vector3d& min, const Eigen::Vector3d& max, std::vector<quint8>& inside) const
+{
+    const size_t n = m_x.size();
+    const double* x = m_x.data();
+    const double* y = m_y.data();
+    const double* z = m_z.data();
+
+    const double minX = min.x(), minY = min.y(), minZ = min.z();
+    const double maxX = max.x(), maxY = max.y(), maxZ = max.z();
+
+    inside.resize(n);
+    quint8* out = inside.data();
+
+    for(size_t i = 0 ; i < n ; ++i) {
+        out[i] = (quint8)((x[i] >= minX) & (y[i] >= minY) & (z[i] >= minZ)
+                          & (x[i] < maxX) & (y[i] < maxY) & (z[i] < maxZ));
+    }
+}
+
+void LVOX3_PointStaging::reorder(const std::vector<size_t>& order)
+{
+    const size_t n = order.size();
+    std::vector<double> tmp(n);
+
+    std::vector<double>* arrays[3] = {&m_x, &m_y, &m_z};
+
+    for(int a = 0 ; a < 3 ; ++a) {
+        std::vector<double>& values = *arrays[a];
+
+        for(size_t i = 0 ; i < n ; ++i)
+            tmp[i] = values[order[i]];
+
+        values.swap(tmp);
+    }
+}
+
+void LVOX3_PointStaging::sortByMorton(const Eigen::Vector3d& min, double resolution)
+{
+    const size_t n = m_x.size();
+    std::vector<quint64> codes(n);
+
+    for(size_t i = 0 ; i < n ; ++i)
+        codes[i] = LVOX3_MortonOrder::voxelCode(pointAt(i), min, resolution);
+
+    reorder(LVOX3_MortonOrder::sortedOrder(codes));
+}
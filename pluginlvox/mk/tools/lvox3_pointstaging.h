@@ -0,0 +1,65 @@
+#ifndef LVOX3_POINTSTAGING_H
+#define LVOX3_POINTSTAGING_H
+
+#include "ct_itemdrawable/ct_scene.h"
+
+#include "Eigen/Core"
+
+#include <vector>
+
+/**
+ * @brief Copy of the coordinates of the points of a scan in three contiguous arrays (structure of arrays)
+ *
+ * The workers of a scan (hits, before) share it to read the points linearly instead of walking the
+ * global point cloud through the index of the scene, once per worker and per tile.
+ */
+class LVOX3_PointStaging
+{
+public:
+    /**
+     * @brief Copy the points of the index (24 bytes per point)
+     */
+    LVOX3_PointStaging(const CT_AbstractPointCloudIndex* pointCloudIndex);
+
+    size_t size() const { return m_x.size(); }
+
+    const double* x() const { return m_x.data(); }
+    const double* y() const { return m_y.data(); }
+    const double* z() const { return m_z.data(); }
+
+    Eigen::Vector3d pointAt(size_t i) const { return Eigen::Vector3d(m_x[i], m_y[i], m_z[i]); }
+
+    /**
+     * @brief Set "inside[i]" to 1 if the point i is in [min;max[ and to 0 otherwise. It is a loop without
+     *        branch over the arrays so the compiler can vectorize it.
+     */
+    void markInside(const Eigen::Vector3d& min, const Eigen::Vector3d& max, std::vector<quint8>& inside) const;
+
+    /**
+     * @brief Reorder the points : the new point i is the old point order[i]
+     */
+    void reorder(const std::vector<size_t>& order);
+
+    /**
+     * @brief Sort the points in Morton order of their voxel in a grid starting at "min" (see LVOX3_MortonOrder)
+     *        so that consecutive points touch close voxels
+     */
+    void sortByMorton(const Eigen::Vector3d& min, double resolution);
+
+    /**
+     * @brief Returns the memory used by the arrays
+     */
+    quint64 memoryBytes() const { return memoryBytes(m_x.size()); }
+
+    /**
+     * @brief Returns the memory used by the arrays of "nPoints" points
+     */
+    static quint64 memoryBytes(size_t nPoints) { return 3 * ((quint64)nPoints) * sizeof(double); }
+
+private:
+    std::vector<double> m_x;
+    std::vector<double> m_y;
+    std::vector<double> m_z;
+};
+
+#endif // LVOX3_POINTSTAGING_H
@@ -0,0 +1,137 @@
+#ifndef LVOX3_QUANTIZEDDISTANCEGRID_H
+#define LVOX3_QUANTIZEDDISTANCEGRID_H
+
+#include "mk/tools/lvox3_gridtype.h"
+
+#include "tools/lvox_binarygrid3d.h"
+
+#include <cmath>
+#include <vector>
+
+/*!
+ * @brief Values of a grid of mean distances (DeltaIn, DeltaOut, Deltatheoretical, DeltaBefore) stored
+ *        in 16 bits per voxel.
+ *
+ * A mean distance in a voxel is between 0 and the diagonal of the voxel (resolution * sqrt(3)) so it is
+ * stored as a fixed point number : the diagonal is cut in 65519 steps, the error is lower than
+ * resolution / 75000. The last 16 codes are the integer values -1 to -16 (NA and error codes written
+ * by the workers). Other values are clamped to the nearest value that can be stored.
+ *
+ * The binary file of a quantized grid is a LVG3D file of unsigned short values with the data type
+ * LVOX_BinaryGrid3DFile::QUANTIZED_DISTANCES, the step is computed from the resolution of its header.
+ *
+ * Only the files are quantized : the distance grids of the steps stay CT_Grid3D<float> in memory.
+ */
+class LVOX3_QuantizedDistanceGrid
+{
+public:
+    /**
+     * @brief Quantize the values of a grid
+     */
+    LVOX3_QuantizedDistanceGrid(const lvox::Grid3Df* grid) : m_codes(grid->nCells())
+    {
+        const double s = step(grid->resolution());
+        const size_t nCells = m_codes.size();
+
+        m_nClamped = 0;
+
+        for(size_t i = 0 ; i < nCells ; ++i) {
+            bool clamped;
+            m_codes[i] = encode(grid->valueAtIndex(i), s, clamped);
+
+            if(clamped)
+                ++m_nClamped;
+        }
+    }
+
+    /**
+     * @brief Returns the distance between two consecutive values for this resolution
+     */
+    static double step(double resolution) { return (resolution * std::sqrt(3.0)) / MAX_DISTANCE_CODE; }
+
+    static quint16 encode(lvox::Grid3DfType value, double step, bool& clamped)
+    {
+        clamped = false;
+
+        if(value >= 0) {
+            const double n = std::floor((value / step) + 0.5);
+
+            if(n > MAX_DISTANCE_CODE) {
+                clamped = true;
+                return MAX_DISTANCE_CODE;
+            }
+
+            return (quint16)n;
+        }
+
+        const double n = -value;
+        const double bounded = qBound(1.0, std::floor(n + 0.5), (double)N_INTEGER_CODES);
+
+        clamped = (bounded != n);
+
+        return (quint16)(MAX_DISTANCE_CODE + bounded);
+    }
+
+    static lvox::Grid3DfType decode(quint16 code, double step)
+    {
+        if(code <= MAX_DISTANCE_CODE)
+            return (lvox::Grid3DfType)(code * step);
+
+        return -(lvox::Grid3DfType)(code - MAX_DISTANCE_CODE);
+    }
+
+    /**
+     * @brief Returns the codes in the CT_Grid3D index order
+     */
+    const std::vector<quint16>& codes() const { return m_codes; }
+
+    /**
+     * @brief Returns the number of values that could not be stored exactly (out of the range of distances
+     *        or negative values that are not an integer code)
+     */
+    size_t nClamped() const { return m_nClamped; }
+
+    /**
+     * @brief Quantize the grid and write it in a binary file
+     * @param nClamped : if not NULL, the number of values that could not be stored exactly is added to it
+     */
+    static bool write(const lvox::Grid3Df* grid, const QString& filePath, size_t* nClamped = NULL)
+    {
+        LVOX3_QuantizedDistanceGrid quantized(grid);
+
+        if(nClamped != NULL)
+            *nClamped += quantized.nClamped();
+
+        return LVOX_BinaryGrid3DFile::writeValues(grid, grid->NA(), quantized.codes().data(), filePath, LVOX_BinaryGrid3DFile::QUANTIZED_DISTANCES);
+    }
+
+    /**
+     * @brief Map a file written by write. Returns false if it is not a quantized grid.
+     */
+    static bool open(LVOX_MappedGrid3D<quint16>& mapped, const QString& filePath)
+    {
+        return mapped.open(filePath, LVOX_BinaryGrid3DFile::QUANTIZED_DISTANCES);
+    }
+
+    /**
+     * @brief Copy the values of a mapped quantized file (see open) in a grid of same dimensions
+     */
+    static void copyTo(const LVOX_MappedGrid3D<quint16>& mapped, lvox::Grid3Df* grid)
+    {
+        const double s = step(mapped.header().resolution);
+        const size_t nCells = mapped.nCells();
+        const quint16* codes = mapped.values();
+
+        for(size_t i = 0 ; i < nCells ; ++i)
+            grid->setValueAtIndex(i, decode(codes[i], s));
+    }
+
+private:
+    static const int MAX_DISTANCE_CODE = 65519;
+    static const int N_INTEGER_CODES = 16;
+
+    std::vector<quint16>    m_codes;
+    size_t                  m_nClamped;
+};
+
+#endif // LVOX3_QUANTIZEDDISTANCEGRID_H
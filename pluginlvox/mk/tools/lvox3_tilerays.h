@@ -0,0 +1,78 @@
+#ifndef LVOX3_TILERAYS_H
+#define LVOX3_TILERAYS_H
+
+#include "mk/tools/lvox3_gridtiling.h"
+#include "mk/tools/lvox3_rayboxintersectionmath.h"
+
+#include <vector>
+
+/**
+ * @brief Indexes of the rays that can touch each tile of a tiling. A ray is added to the tiles that
+ *        intersect the bounding box (in the xy plane) of its part inside the whole grid, so the grids
+ *        of a tile are computed with these rays only instead of all the rays of the scan.
+ *
+ * One index is stored for each ray and each tile of its bounding box, so smaller tiles use more
+ * memory (see memoryBytes).
+ */
+class LVOX3_TileRays
+{
+public:
+    /**
+     * @param rayAt : rayAt(i, origin, direction) gives the ray "i"
+     */
+    template<typename RayAt>
+    LVOX3_TileRays(const LVOX3_GridTiling& tiling, size_t nRays, const RayAt& rayAt) : m_rays(tiling.tiles().size())
+    {
+        forEachRayTile(tiling, nRays, rayAt, [this](size_t ray, int tile) {
+            m_rays[tile].push_back(ray);
+        });
+    }
+
+    /**
+     * @brief Returns the memory used by the indexes of the rays for this tiling, without storing them
+     */
+    template<typename RayAt>
+    static quint64 memoryBytes(const LVOX3_GridTiling& tiling, size_t nRays, const RayAt& rayAt)
+    {
+        quint64 nIndexes = 0;
+
+        forEachRayTile(tiling, nRays, rayAt, [&nIndexes](size_t, int) {
+            ++nIndexes;
+        });
+
+        return nIndexes * sizeof(size_t);
+    }
+
+    /**
+     * @brief Returns the indexes of the rays that can touch the tile (in increasing order)
+     */
+    const std::vector<size_t>& raysOfTile(int tile) const { return m_rays[tile]; }
+
+private:
+    std::vector< std::vector<size_t> > m_rays;
+
+    /**
+     * @brief Call f(ray, tile) for each ray and each tile that it can touch
+     */
+    template<typename RayAt, typename Function>
+    static void forEachRayTile(const LVOX3_GridTiling& tiling, size_t nRays, const RayAt& rayAt, const Function& f)
+    {
+        const Eigen::Vector3d& min = tiling.minBBox();
+        const Eigen::Vector3d max = min + Eigen::Vector3d(tiling.xdim(), tiling.ydim(), tiling.zdim())*tiling.resolution();
+
+        Eigen::Vector3d origin, direction, start, end;
+
+        for(size_t i=0; i<nRays; ++i) {
+            rayAt(i, origin, direction);
+
+            if(!LVOX3_RayBoxIntersectionMath::getIntersectionOfRay(min, max, origin, direction, start, end))
+                continue;
+
+            tiling.forEachTileInBox(start.cwiseMin(end), start.cwiseMax(end), [&f, i](int tile) {
+                f(i, tile);
+            });
+        }
+    }
+};
+
+#endif // LVOX3_TILERAYS_H
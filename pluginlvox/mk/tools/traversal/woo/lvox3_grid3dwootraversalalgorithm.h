@@ -13,19 +13,34 @@
 #include "mk/tools/lvox3_errorcode.h"
 #include "mk/tools/lvox3_gridtools.h"
 #include "mk/tools/lvox3_rayboxintersectionmath.h"
+#include "mk/tools/lvox3_columnfilter.h"
 #include "mk/tools/traversal/woo/visitor/lvox3_grid3dvoxelwoovisitor.h"
+#include "mk/tools/traversal/woo/lvox3_traversalstats.h"
 
 /**
  * @brief Use this class to propagate a shot in cells of 3D grid and do
  *        anything for each cell touch by the shot
+ *
+ * If "Instrumented" is true statistics of the rays are collected (see stats()), otherwise
+ * the counting is removed by the compiler.
  */
-template<typename T>
+template<typename T, bool Instrumented = false>
 class LVOX3_Grid3DWooTraversalAlgorithm
 {
 public:
+    /**
+     * @param grid : grid to traverse
+     * @param visitFirstVoxelTouched : false to not visit the first voxel touched by the ray
+     * @param list : visitors
+     * @param outsideFilter : if the grid is a tile of a bigger grid, filter of the bigger grid used to know if the
+     *                        ray was stopped before entering the tile (optionnal). With a tile "visitFirstVoxelTouched"
+     *                        applies to the first voxel touched in the bigger grid, so the voxel where a ray enters the
+     *                        tile from a neighbour tile is visited like in the bigger grid.
+     */
     LVOX3_Grid3DWooTraversalAlgorithm(const CT_Grid3D<T>* grid,
                                       bool visitFirstVoxelTouched,
-                                      QVector<LVOX3_Grid3DVoxelWooVisitor*>& list)
+                                      QVector<LVOX3_Grid3DVoxelWooVisitor*>& list,
+                                      const LVOX3_ColumnFilter* outsideFilter = NULL)
     {
         m_visitorList = list;
         m_numberOfVisitors = list.size();
@@ -35,6 +50,7 @@ public:
 
         m_gridResolution = grid->resolution();
         m_visitFirstVoxelTouched = visitFirstVoxelTouched;
+        m_outsideFilter = outsideFilter;
 
         m_chooseAxis[0] = 2;
         m_chooseAxis[1] = 1;
@@ -54,6 +70,43 @@ public:
     }
 
     void compute(const Eigen::Vector3d& origin, const Eigen::Vector3d& direction) const
+    {
+        quint64 nVisited = 0;
+        const LVOX3_TraversalStats::RayEnd rayEnd = traverse(origin, direction, nVisited);
+
+        if(Instrumented)
+            m_stats.addRay(rayEnd, nVisited);
+    }
+
+    /**
+     * @brief Returns the statistics of the rays computed (always empty if not instrumented)
+     */
+    const LVOX3_TraversalStats& stats() const
+    {
+        return m_stats;
+    }
+
+private:
+    LVOX3_GridTools*                            m_gridTools;
+    const CT_Grid3D<T>*                         m_grid;
+    Eigen::Vector3d                             m_gridBottom;
+    Eigen::Vector3d                             m_gridTop;
+    double                                      m_gridResolution;
+    bool                                        m_visitFirstVoxelTouched;
+    const LVOX3_ColumnFilter*                   m_outsideFilter;
+    QVector<LVOX3_Grid3DVoxelWooVisitor* >         m_visitorList;
+    int                                         m_numberOfVisitors;
+    quint8                                      m_chooseAxis[8];
+    mutable LVOX3_TraversalStats                m_stats;
+
+    static const double MAX_DOUBLE_VALUE;
+
+    /**
+     * @brief Propagate the ray in the grid
+     * @param nVisited : incremented for each voxel visited if instrumented
+     * @return how the ray ended
+     */
+    LVOX3_TraversalStats::RayEnd traverse(const Eigen::Vector3d& origin, const Eigen::Vector3d& direction, quint64& nVisited) const
     {
         Eigen::Vector3d start, end;
 
@@ -61,13 +114,34 @@ public:
         {
             int i;
 
+            // the start is the origin only if the origin is inside the grid
+            const bool originIsOutside = (start != origin);
+
+            if(originIsOutside
+                    && (m_outsideFilter != NULL)
+                    && m_outsideFilter->isSegmentFiltered(origin, start))
+                return LVOX3_TraversalStats::StoppedBeforeGrid;
+
             LVOX3_Grid3DVoxelWooVisitorContext context(origin, direction);
             context.nearImpactPointWithGrid = start;
             context.farImpactPointWithGrid = end;
 
             Eigen::Vector3d stepAxis, boundary, tMax, tDel;
 
-            m_gridTools->computeGridIndexForPoint(context.nearImpactPointWithGrid, context.colLinLevel.x(), context.colLinLevel.y(), context.colLinLevel.z(), context.currentVoxelIndex);
+            if(m_outsideFilter != NULL) {
+                // the ray can enter the tile from a neighbour tile, its start is on a face of the tile and can be
+                // rounded in the voxel of the neighbour tile
+                const size_t dims[3] = {m_grid->xdim(), m_grid->ydim(), m_grid->zdim()};
+
+                for (i = 0 ; i < 3 ; ++i) {
+                    const double c = std::floor((context.nearImpactPointWithGrid(i) - m_gridBottom(i)) / m_gridResolution);
+                    context.colLinLevel(i) = (c <= 0) ? 0 : qMin((size_t)c, dims[i]-1);
+                }
+
+                m_gridTools->computeGridIndexForColLinLevel(context.colLinLevel.x(), context.colLinLevel.y(), context.colLinLevel.z(), context.currentVoxelIndex);
+            } else {
+                m_gridTools->computeGridIndexForPoint(context.nearImpactPointWithGrid, context.colLinLevel.x(), context.colLinLevel.y(), context.colLinLevel.z(), context.currentVoxelIndex);
+            }
 
             for (i = 0 ; i < 3 ; ++i) {
                 if(context.farImpactPointWithGrid(i) > context.nearImpactPointWithGrid(i)) {
@@ -87,13 +161,28 @@ public:
                 }
             }
 
-            if (m_visitFirstVoxelTouched)
+            bool visitFirst = m_visitFirstVoxelTouched;
+
+            if(!visitFirst
+                    && originIsOutside
+                    && (m_outsideFilter != NULL)) {
+                const Eigen::Vector3d center = m_gridBottom + Eigen::Vector3d(context.colLinLevel.x() + 0.5,
+                                                                              context.colLinLevel.y() + 0.5,
+                                                                              context.colLinLevel.z() + 0.5)*m_gridResolution;
+
+                visitFirst = !m_outsideFilter->isFirstVoxelTouched(origin, direction, center);
+            }
+
+            if (visitFirst)
             {
                 if(!lvox::FilterCode::isFiltered(m_grid->valueAtIndex(context.currentVoxelIndex))) {
                     for (int i = 0 ; i < m_numberOfVisitors ; ++i)
                         m_visitorList.at(i)->visit(context);
+
+                    if(Instrumented)
+                        ++nVisited;
                 } else {
-                    return;
+                    return LVOX3_TraversalStats::StoppedOnFilteredVoxel;
                 }
             }
 
@@ -109,9 +198,9 @@ public:
                 context.colLinLevel(nextStepAxis) += stepAxis(nextStepAxis);
 
                 // Checks if the currentvoxel is outside the grid, the algorithm has finished
-                if (context.colLinLevel.x() >= m_grid->xdim()) { return; }
-                if (context.colLinLevel.y() >= m_grid->ydim()) { return; }
-                if (context.colLinLevel.z() >= m_grid->zdim()) { return; }
+                if (context.colLinLevel.x() >= m_grid->xdim()) { return LVOX3_TraversalStats::LeftGrid; }
+                if (context.colLinLevel.y() >= m_grid->ydim()) { return LVOX3_TraversalStats::LeftGrid; }
+                if (context.colLinLevel.z() >= m_grid->zdim()) { return LVOX3_TraversalStats::LeftGrid; }
 
                 // Add the index of the voxel to the list
                 m_gridTools->computeGridIndexForColLinLevel(context.colLinLevel.x(), context.colLinLevel.y(), context.colLinLevel.z(), context.currentVoxelIndex);
@@ -119,31 +208,23 @@ public:
                 if(!lvox::FilterCode::isFiltered(m_grid->valueAtIndex(context.currentVoxelIndex))) {
                     for (int i = 0 ; i < m_numberOfVisitors ; ++i)
                         m_visitorList.at(i)->visit(context);
+
+                    if(Instrumented)
+                        ++nVisited;
                 } else {
-                    return;
+                    return LVOX3_TraversalStats::StoppedOnFilteredVoxel;
                 }
 
                 // Updating tmax of this axis (increasing by deltaT)
                 tMax(nextStepAxis) = tMax(nextStepAxis) + tDel(nextStepAxis);
             }
         }
-    }
 
-private:
-    LVOX3_GridTools*                            m_gridTools;
-    const CT_Grid3D<T>*                         m_grid;
-    Eigen::Vector3d                             m_gridBottom;
-    Eigen::Vector3d                             m_gridTop;
-    double                                      m_gridResolution;
-    bool                                        m_visitFirstVoxelTouched;
-    QVector<LVOX3_Grid3DVoxelWooVisitor* >         m_visitorList;
-    int                                         m_numberOfVisitors;
-    quint8                                      m_chooseAxis[8];
-
-    static const double MAX_DOUBLE_VALUE;
+        return LVOX3_TraversalStats::MissedGrid;
+    }
 };
 
-template<typename T>
-const double LVOX3_Grid3DWooTraversalAlgorithm<T>::MAX_DOUBLE_VALUE = std::numeric_limits<double>::max();
+template<typename T, bool Instrumented>
+const double LVOX3_Grid3DWooTraversalAlgorithm<T, Instrumented>::MAX_DOUBLE_VALUE = std::numeric_limits<double>::max();
 
 #endif // LVOX3_GRID3DWOOTRAVERSALALGORITHM_H
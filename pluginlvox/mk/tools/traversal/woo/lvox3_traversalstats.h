@@ -0,0 +1,138 @@
+#ifndef LVOX3_TRAVERSALSTATS_H
+#define LVOX3_TRAVERSALSTATS_H
+
+#include <QString>
+#include <QStringList>
+
+namespace lvox {
+    /**
+     * @brief True if the workers must collect statistics of the rays of their traversal algorithm. Run qmake
+     *        with "CONFIG+=lvox_traversal_stats" to enable it, otherwise the code is not compiled.
+     */
+#ifdef LVOX3_TRAVERSAL_STATS
+    static const bool TraversalStatsEnabled = true;
+#else
+    static const bool TraversalStatsEnabled = false;
+#endif
+}
+
+/*!
+ * @brief Statistics of the rays computed by a traversal algorithm : how the rays ended and
+ *        histogram of the number of voxels visited per ray
+ */
+struct LVOX3_TraversalStats
+{
+    enum RayEnd {
+        MissedGrid = 0,             /*!< the ray does not touch the grid */
+        StoppedBeforeGrid,          /*!< the ray was stopped by the ground or the sky before entering the grid (tile) */
+        StoppedOnFilteredVoxel,     /*!< the ray was stopped by a filtered voxel in the grid */
+        LeftGrid                    /*!< the ray went through the grid */
+    };
+
+    /**
+     * @brief Bucket 0 counts rays without visit, bucket b > 0 counts rays with [2^(b-1) ; 2^b - 1] visits
+     */
+    static const int N_BUCKETS = 32;
+
+    LVOX3_TraversalStats() { clear(); }
+
+    void clear() {
+        nRays = 0;
+        nMissedGrid = 0;
+        nStoppedBeforeGrid = 0;
+        nStoppedOnFilteredVoxel = 0;
+        nVoxelVisits = 0;
+
+        for(int i=0; i<N_BUCKETS; ++i)
+            voxelsPerRay[i] = 0;
+    }
+
+    /**
+     * @brief Add a ray
+     * @param end : how the ray ended
+     * @param nVoxels : number of voxels visited
+     */
+    void addRay(RayEnd end, quint64 nVoxels) {
+        ++nRays;
+
+        if(end == MissedGrid) {
+            ++nMissedGrid;
+            return;
+        }
+
+        if(end == StoppedBeforeGrid)
+            ++nStoppedBeforeGrid;
+        else if(end == StoppedOnFilteredVoxel)
+            ++nStoppedOnFilteredVoxel;
+
+        nVoxelVisits += nVoxels;
+        ++voxelsPerRay[bucketOf(nVoxels)];
+    }
+
+    void merge(const LVOX3_TraversalStats& other) {
+        nRays += other.nRays;
+        nMissedGrid += other.nMissedGrid;
+        nStoppedBeforeGrid += other.nStoppedBeforeGrid;
+        nStoppedOnFilteredVoxel += other.nStoppedOnFilteredVoxel;
+        nVoxelVisits += other.nVoxelVisits;
+
+        for(int i=0; i<N_BUCKETS; ++i)
+            voxelsPerRay[i] += other.voxelsPerRay[i];
+    }
+
+    static int bucketOf(quint64 nVoxels) {
+        int b = 0;
+
+        while((nVoxels > 0) && (b < (N_BUCKETS-1))) {
+            nVoxels >>= 1;
+            ++b;
+        }
+
+        return b;
+    }
+
+    /**
+     * @brief Returns the statistics as lines of text
+     */
+    QStringList toText() const {
+        QStringList lines;
+
+        if(nRays == 0)
+            return lines;
+
+        const quint64 nInGrid = nRays - nMissedGrid;
+
+        lines.append(QString("%1 rays : %2 % missed the grid, %3 % stopped before the grid, %4 % stopped on a filtered voxel, %5 voxels per ray in the grid")
+                     .arg(nRays)
+                     .arg((100.0 * nMissedGrid) / nRays, 0, 'f', 1)
+                     .arg((100.0 * nStoppedBeforeGrid) / nRays, 0, 'f', 1)
+                     .arg((100.0 * nStoppedOnFilteredVoxel) / nRays, 0, 'f', 1)
+                     .arg((nInGrid > 0) ? (((double)nVoxelVisits) / nInGrid) : 0.0, 0, 'f', 1));
+
+        QStringList buckets;
+
+        for(int b=0; b<N_BUCKETS; ++b) {
+            if(voxelsPerRay[b] == 0)
+                continue;
+
+            if(b <= 1)
+                buckets.append(QString("%1 : %2").arg(b).arg(voxelsPerRay[b]));
+            else
+                buckets.append(QString("%1-%2 : %3").arg(1ull << (b-1)).arg((1ull << b) - 1).arg(voxelsPerRay[b]));
+        }
+
+        if(!buckets.isEmpty())
+            lines.append(QString("voxels per ray (number of rays) : %1").arg(buckets.join(", ")));
+
+        return lines;
+    }
+
+    quint64 nRays;
+    quint64 nMissedGrid;
+    quint64 nStoppedBeforeGrid;
+    quint64 nStoppedOnFilteredVoxel;
+    quint64 nVoxelVisits;
+    quint64 voxelsPerRay[N_BUCKETS];
+};
+
+#endif // LVOX3_TRAVERSALSTATS_H
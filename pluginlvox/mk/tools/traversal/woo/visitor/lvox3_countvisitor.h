@@ -8,25 +8,56 @@
 
 #include "lvox3_grid3dvoxelwoovisitor.h"
 #include "mk/tools/lvox3_gridtype.h"
+#include "mk/tools/lvox3_mutexstripes.h"
 
 #include "ct_itemdrawable/ct_grid3d.h"
 
-template<typename T>
+/**
+ * @brief Add one to the voxels visited. The grid can be a CT_Grid3D or any grid with the same
+ *        addValueAtIndex method (LVOX3_CompactCountGrid for example).
+ */
+template<typename T, typename GridT = CT_Grid3D<T> >
 class LVOX3_CountVisitor : public LVOX3_Grid3DVoxelWooVisitor
 {
 public:
-    LVOX3_CountVisitor(const CT_Grid3D<T>* grid,
+    LVOX3_CountVisitor(const GridT* grid,
                        const lvox::MutexCollection* collection = NULL) {
-        m_grid = (CT_Grid3D<T>*)grid;
+        m_grid = (GridT*)grid;
         m_multithreadCollection = (lvox::MutexCollection*)collection;
+        m_stripes = NULL;
+        m_nVisits = 0;
+    }
+
+    /**
+     * @brief Visitor that shares the grid with other threads, a voxel is locked with its mutex in the stripes
+     */
+    LVOX3_CountVisitor(const GridT* grid,
+                       const LVOX3_MutexStripes* stripes) {
+        m_grid = (GridT*)grid;
+        m_multithreadCollection = NULL;
+        m_stripes = stripes;
+        m_nVisits = 0;
     }
 
+    /**
+     * @brief Returns the number of voxels visited by this visitor
+     */
+    quint64 nVisits() const { return m_nVisits; }
+
     /**
      * @brief Called when a voxel must be visited
      */
     void visit(const LVOX3_Grid3DVoxelWooVisitorContext& context) {
-        if(m_multithreadCollection != NULL) {
-            QMutex* mutex = (*m_multithreadCollection)[context.currentVoxelIndex];
+        ++m_nVisits;
+
+        QMutex* mutex = NULL;
+
+        if(m_multithreadCollection != NULL)
+            mutex = (*m_multithreadCollection)[context.currentVoxelIndex];
+        else if(m_stripes != NULL)
+            mutex = m_stripes->mutexAt(context.currentVoxelIndex);
+
+        if(mutex != NULL) {
             mutex->lock();
             m_grid->addValueAtIndex(context.currentVoxelIndex, 1);
             mutex->unlock();
@@ -36,8 +67,10 @@ public:
     }
 
 private:
-    CT_Grid3D<T>*           m_grid;
+    GridT*                  m_grid;
     lvox::MutexCollection*  m_multithreadCollection;
+    const LVOX3_MutexStripes*  m_stripes;
+    quint64                 m_nVisits;
 };
 
 #endif // LVOX3_COUNTVISITOR_H
@@ -0,0 +1,83 @@
+#ifndef LVOX3_COUNTWITHLENGTHTHRESHOLDVISITOR_H
+#define LVOX3_COUNTWITHLENGTHTHRESHOLDVISITOR_H
+
+#include "lvox3_grid3dvoxelwoovisitor.h"
+#include "mk/tools/lvox3_rayboxintersectionmath.h"
+#include "mk/tools/lvox3_gridtools.h"
+#include "mk/tools/lvox3_gridtype.h"
+#include "mk/tools/lvox3_mutexstripes.h"
+
+#include "ct_itemdrawable/ct_grid3d.h"
+
+/**
+ * @brief Count the rays that go through a voxel at a distance of the origin of the ray lower than a
+ *        threshold (distance of the middle of the segment of the ray inside the voxel)
+ */
+template<typename T>
+class LVOX3_CountWithLengthThresholdVisitor : public LVOX3_Grid3DVoxelWooVisitor
+{
+public:
+    /**
+     * @param stripes : if the grid is shared with other threads, a voxel is locked with its mutex in the stripes (optionnal)
+     */
+    LVOX3_CountWithLengthThresholdVisitor(const CT_Grid3D<T>* grid,
+                                          double threshold,
+                                          const LVOX3_MutexStripes* stripes = NULL) {
+        m_grid = (CT_Grid3D<T>*)grid;
+        m_threshold = threshold;
+        m_gridTools = new LVOX3_GridTools(grid);
+        m_stripes = stripes;
+        m_nVisits = 0;
+    }
+
+    ~LVOX3_CountWithLengthThresholdVisitor() {
+        delete m_gridTools;
+    }
+
+    /**
+     * @brief Returns the number of voxels visited by this visitor (counted or not)
+     */
+    quint64 nVisits() const { return m_nVisits; }
+
+    /**
+     * @brief Called when a voxel must be visited
+     */
+    void visit(const LVOX3_Grid3DVoxelWooVisitorContext& context) {
+        ++m_nVisits;
+
+        Eigen::Vector3d bot, top, nearInter, farInter;
+        m_gridTools->computeCellBottomLeftTopRightCornerAtColLinLevel(context.colLinLevel.x(),
+                                                                      context.colLinLevel.y(),
+                                                                      context.colLinLevel.z(),
+                                                                      bot,
+                                                                      top);
+
+        if (LVOX3_RayBoxIntersectionMath::getIntersectionOfRay(bot, top, context.rayOrigin, context.rayDirection, nearInter, farInter))
+        {
+            const double distNear = (nearInter - context.rayOrigin).norm();
+            const double distFar = (farInter - context.rayOrigin).norm();
+
+            if (((distNear + distFar) / 2.0) < m_threshold)
+            {
+                if (m_stripes != NULL)
+                {
+                    lvox::MutexType* mutex = m_stripes->mutexAt(context.currentVoxelIndex);
+                    mutex->lock();
+                    m_grid->addValueAtIndex(context.currentVoxelIndex, 1);
+                    mutex->unlock();
+                } else {
+                    m_grid->addValueAtIndex(context.currentVoxelIndex, 1);
+                }
+            }
+        }
+    }
+
+private:
+    CT_Grid3D<T>*           m_grid;
+    double                  m_threshold;
+    LVOX3_GridTools*        m_gridTools;
+    const LVOX3_MutexStripes*  m_stripes;
+    quint64                 m_nVisits;
+};
+
+#endif // LVOX3_COUNTWITHLENGTHTHRESHOLDVISITOR_H
@@ -0,0 +1,53 @@
+#ifndef LVOX3_FIXEDPOINTDISTANCEVISITOR_H
+#define LVOX3_FIXEDPOINTDISTANCEVISITOR_H
+
+#include "lvox3_grid3dvoxelwoovisitor.h"
+#include "mk/tools/lvox3_rayboxintersectionmath.h"
+#include "mk/tools/lvox3_gridtools.h"
+#include "mk/tools/lvox3_fixedpointsumgrid.h"
+
+#include "ct_itemdrawable/abstract/ct_abstractgrid3d.h"
+
+/**
+ * @brief Same as LVOX3_DistanceVisitor but the lengths of the rays in the voxels are added in a
+ *        LVOX3_FixedPointSumGrid, so visitors of several threads can share it and the sums do not
+ *        depend on the order of the rays
+ */
+class LVOX3_FixedPointDistanceVisitor : public LVOX3_Grid3DVoxelWooVisitor
+{
+public:
+    /**
+     * @param grid : grid that gives the geometry of the voxels
+     * @param sums : sums of the lengths, with the same number of cells than the grid
+     */
+    LVOX3_FixedPointDistanceVisitor(const CT_AbstractGrid3D* grid,
+                                    LVOX3_FixedPointSumGrid* sums) {
+        m_sums = sums;
+        m_gridTools = new LVOX3_GridTools(grid);
+    }
+
+    ~LVOX3_FixedPointDistanceVisitor() {
+        delete m_gridTools;
+    }
+
+    /**
+     * @brief Called when a voxel must be visited
+     */
+    void visit(const LVOX3_Grid3DVoxelWooVisitorContext& context) {
+        Eigen::Vector3d bot, top, nearInter, farInter;
+        m_gridTools->computeCellBottomLeftTopRightCornerAtColLinLevel(context.colLinLevel.x(),
+                                                                      context.colLinLevel.y(),
+                                                                      context.colLinLevel.z(),
+                                                                      bot,
+                                                                      top);
+
+        if (LVOX3_RayBoxIntersectionMath::getIntersectionOfRay(bot, top, context.rayOrigin, context.rayDirection, nearInter, farInter))
+            m_sums->addValueAtIndex(context.currentVoxelIndex, (nearInter - farInter).norm());
+    }
+
+private:
+    LVOX3_FixedPointSumGrid*    m_sums;
+    LVOX3_GridTools*            m_gridTools;
+};
+
+#endif // LVOX3_FIXEDPOINTDISTANCEVISITOR_H
@@ -3,6 +3,7 @@
 #include <QThread>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QElapsedTimer>
 
 LVOX3_ComputeAll::LVOX3_ComputeAll() : LVOX3_Worker()
 {
@@ -20,6 +21,11 @@ void LVOX3_ComputeAll::addWorker(int startIndex, LVOX3_Worker *worker)
     m_workers.insert(startIndex, worker);
 }
 
+const LVOX3_WorkersReport& LVOX3_ComputeAll::getReport() const
+{
+    return m_report;
+}
+
 void LVOX3_ComputeAll::doTheJob()
 {
     QList<int> keys = m_workers.uniqueKeys();
@@ -30,6 +36,10 @@ void LVOX3_ComputeAll::doTheJob()
 
     m_progressOffset = 0;
 
+    m_report.clear();
+
+    QElapsedTimer timer;
+
     foreach (int key, keys) {
 
         m_nCurrentThread = 0;
@@ -37,6 +47,8 @@ void LVOX3_ComputeAll::doTheJob()
 
         m_currentWorkers = m_workers.values(key);
 
+        timer.start();
+
         foreach (LVOX3_Worker* worker, m_currentWorkers) {
             prepareAWorker(worker);
             startAWorker(worker);
@@ -44,11 +56,19 @@ void LVOX3_ComputeAll::doTheJob()
 
         waitForFinished();
 
+        LVOX3_WorkersReport::Phase phase;
+        phase.startIndex = key;
+        phase.wallTimeMs = timer.nsecsElapsed() / 1000000.0;
+
         foreach (LVOX3_Worker* worker, m_currentWorkers) {
             disconnect(this, NULL, worker, NULL);
             disconnect(worker, NULL, this, NULL);
+
+            phase.workers.append(worker->getStats());
         }
 
+        m_report.addPhase(phase);
+
         if(mustCancel())
             return;
 
@@ -7,6 +7,7 @@
 #define LVOX3_COMPUTEALL_H
 
 #include "lvox3_worker.h"
+#include "lvox3_workersreport.h"
 
 #include <QMultiMap>
 
@@ -31,6 +32,11 @@ public:
      */
     void addWorker(int startIndex, LVOX3_Worker* worker);
 
+    /**
+     * @brief Returns the statistics of the workers of the last compute, phase by phase
+     */
+    const LVOX3_WorkersReport& getReport() const;
+
 protected:
     /**
      * @brief Do the job
@@ -45,6 +51,7 @@ private:
     int                             m_nMaxThread;
     int                             m_nCurrentThread;
     int                             m_nCurrentWorkerFinished;
+    LVOX3_WorkersReport             m_report;
 
     /**
      * @brief Called by QtConcurrent to start the worker
@@ -4,25 +4,109 @@
 #include "mk/tools/traversal/woo/visitor/lvox3_countvisitor.h"
 #include "mk/tools/traversal/woo/visitor/lvox3_distancevisitor.h"
 #include "mk/tools/lvox3_errorcode.h"
+#include "mk/tools/worker/lvox3_parallelraycounter.h"
+#include "mk/tools/lvox3_pointstaging.h"
 
 #include "ct_itemdrawable/tools/gridtools/ct_grid3dwootraversalalgorithm.h"
 #include "ct_iterator/ct_pointiterator.h"
+#include "ct_accessor/ct_pointaccessor.h"
+
+namespace {
+    /**
+     * @brief Gives the ray that goes from the scanner to a point (a copy is used per block of points)
+     */
+    class BeforeRayAt
+    {
+    public:
+        BeforeRayAt(const CT_AbstractPointCloudIndex* pointCloudIndex,
+                    const LVOX3_PointStaging* staging,
+                    const std::vector<size_t>* points,
+                    const Eigen::Vector3d& shotOrigin) :
+            m_pointCloudIndex(pointCloudIndex), m_staging(staging), m_points(points), m_shotOrigin(shotOrigin) {}
+
+        BeforeRayAt(const BeforeRayAt& other) :
+            m_pointCloudIndex(other.m_pointCloudIndex), m_staging(other.m_staging), m_points(other.m_points), m_shotOrigin(other.m_shotOrigin) {}
+
+        void operator()(size_t i, Eigen::Vector3d& origin, Eigen::Vector3d& direction) const
+        {
+            if(m_points != NULL)
+                i = (*m_points)[i];
+
+            if(m_staging != NULL)
+                origin = m_staging->pointAt(i);
+            else
+                origin = m_accessor.constPointAt(m_pointCloudIndex->indexAt(i));
+
+            direction = origin - m_shotOrigin;
+        }
+
+    private:
+        const CT_AbstractPointCloudIndex*   m_pointCloudIndex;
+        const LVOX3_PointStaging*           m_staging;
+        const std::vector<size_t>*          m_points;
+        Eigen::Vector3d                     m_shotOrigin;
+        mutable CT_PointAccessor            m_accessor;
+    };
+}
 
 LVOX3_ComputeBefore::LVOX3_ComputeBefore(const CT_ShootingPattern* pattern,
                                          const CT_AbstractPointCloudIndex* pointCloudIndex,
                                          lvox::Grid3Di* before,
-                                         lvox::Grid3Df* shotDeltaDistance)
+                                         lvox::Grid3Df* shotDeltaDistance,
+                                         const LVOX3_ColumnFilter* outsideFilter,
+                                         bool multiThreaded,
+                                         const LVOX3_PointStaging* staging,
+                                         const std::vector<size_t>* points)
 {
     m_pattern = pattern;
     m_pointCloudIndex = pointCloudIndex;
     m_before = before;
     m_shotDeltaDistance = shotDeltaDistance;
+    m_outsideFilter = outsideFilter;
+    m_multiThreaded = multiThreaded;
+    m_staging = staging;
+    m_points = points;
 }
 
 void LVOX3_ComputeBefore::doTheJob()
 {
-    size_t n_points = m_pointCloudIndex->size();
+    size_t n_points = (m_points != NULL) ? m_points->size() : m_pointCloudIndex->size();
+
+    setProgressRange(0, (m_shotDeltaDistance != NULL) ? n_points+1 : n_points);
+
+    const size_t i = m_multiThreaded ? traverseInParallel() : traverseSequentially();
+
+    // Don't forget to calculate min and max in order to visualize it as a colored map
+    m_before->computeMinMax();
+
+    setItemsProcessed(i, "points");
+    addGridBytes(m_before->nCells() * sizeof(lvox::Grid3DiType));
 
+    if(m_shotDeltaDistance != NULL)
+        addGridBytes(m_shotDeltaDistance->nCells() * sizeof(lvox::Grid3DfType));
+
+    if ((m_shotDeltaDistance != NULL)
+            && !mustCancel())
+    {
+        // To get the mean distance we have to divide in each voxel the sum of distances by the number of hits
+        for (int i = 0 ; i < m_before->nCells() && !mustCancel() ; i++ )
+        {
+            const float nHits = m_before->valueAtIndex(i);
+
+            if (nHits <= 0)
+                m_shotDeltaDistance->setValueAtIndex(i, nHits);  // TODO : check if must set an error code here
+            else
+                m_shotDeltaDistance->setValueAtIndex(i, m_shotDeltaDistance->valueAtIndex(i)/nHits);
+        }
+
+        m_shotDeltaDistance->computeMinMax();
+
+        setProgress(n_points+1);
+    }
+}
+
+size_t LVOX3_ComputeBefore::traverseSequentially()
+{
     // Creates visitors
     QVector<LVOX3_Grid3DVoxelWooVisitor*> list;
 
@@ -35,46 +119,73 @@ void LVOX3_ComputeBefore::doTheJob()
         list.append(&distVisitor);
 
     // Creates traversal algorithm
-    LVOX3_Grid3DWooTraversalAlgorithm<lvox::Grid3DiType> algo(m_before, false, list);
+    LVOX3_Grid3DWooTraversalAlgorithm<lvox::Grid3DiType, lvox::TraversalStatsEnabled> algo(m_before, false, list, m_outsideFilter);
 
-    setProgressRange(0, (m_shotDeltaDistance != NULL) ? n_points+1 : n_points);
     size_t i = 0;
 
     const Eigen::Vector3d& shotOrigin = m_pattern->getOrigin();
 
-    CT_PointIterator itP(m_pointCloudIndex);
+    if(m_points != NULL) {
+        const BeforeRayAt rayAt(m_pointCloudIndex, m_staging, m_points, shotOrigin);
+        const size_t n = m_points->size();
+        Eigen::Vector3d point, direction;
 
-    while (itP.hasNext()
-           && !mustCancel())
-    {
-        const CT_Point &point = itP.next().currentPoint();
+        while((i < n)
+              && !mustCancel())
+        {
+            rayAt(i, point, direction);
+            algo.compute(point, direction);
 
-        // algo already check if the beam touch the grid or not so we don't have to do twice !
-        algo.compute(point, point - shotOrigin);
+            ++i;
+            setProgress(i);
+        }
+    } else if(m_staging != NULL) {
+        const size_t n = m_staging->size();
 
-        ++i;
-        setProgress(i);
-    }
+        while((i < n)
+              && !mustCancel())
+        {
+            const Eigen::Vector3d point = m_staging->pointAt(i);
 
-    // Don't forget to calculate min and max in order to visualize it as a colored map
-    m_before->computeMinMax();
+            algo.compute(point, point - shotOrigin);
 
-    if ((m_shotDeltaDistance != NULL)
-            && !mustCancel())
-    {
-        // To get the mean distance we have to divide in each voxel the sum of distances by the number of hits
-        for (int i = 0 ; i < m_before->nCells() && !mustCancel() ; i++ )
+            ++i;
+            setProgress(i);
+        }
+    } else {
+        CT_PointIterator itP(m_pointCloudIndex);
+
+        while (itP.hasNext()
+               && !mustCancel())
         {
-            const float nHits = m_before->valueAtIndex(i);
+            const CT_Point &point = itP.next().currentPoint();
 
-            if (nHits <= 0)
-                m_shotDeltaDistance->setValueAtIndex(i, nHits);  // TODO : check if must set an error code here
-            else
-                m_shotDeltaDistance->setValueAtIndex(i, m_shotDeltaDistance->valueAtIndex(i)/nHits);
+            // algo already check if the beam touch the grid or not so we don't have to do twice !
+            algo.compute(point, point - shotOrigin);
+
+            ++i;
+            setProgress(i);
         }
+    }
 
-        m_shotDeltaDistance->computeMinMax();
+    addVoxelVisits(countVisitor.nVisits());
+    addTraversalStats(algo.stats());
 
-        setProgress(n_points+1);
-    }
+    return i;
+}
+
+size_t LVOX3_ComputeBefore::traverseInParallel()
+{
+    const size_t n_points = (m_points != NULL) ? m_points->size() : m_pointCloudIndex->size();
+
+    LVOX3_ParallelRayCounter counter(m_before, m_shotDeltaDistance, false, m_outsideFilter);
+    counter.run(n_points,
+                BeforeRayAt(m_pointCloudIndex, m_staging, m_points, m_pattern->getOrigin()),
+                [this](size_t nDone) { setProgress(nDone); },
+                [this]() { return mustCancel(); });
+
+    addVoxelVisits(counter.nVoxelVisits());
+    addTraversalStats(counter.stats());
+
+    return n_points;
 }
@@ -13,6 +13,9 @@
 #include "ct_itemdrawable/ct_grid3d.h"
 #include "ct_itemdrawable/tools/scanner/ct_shootingpattern.h"
 
+class LVOX3_ColumnFilter;
+class LVOX3_PointStaging;
+
 /*!
  * @brief Computes the "before" grid of a scene
  */
@@ -27,11 +30,21 @@ public:
      * @param pointCloudIndex : index of points
      * @param before : store it the number of hits that was not stopped
      * @param shotDeltaDistance  : store it the distance between the first intersection point (IN) AND the second intersection point (OUT)
+     * @param outsideFilter : if the grid is a tile, filter of the whole grid (optionnal)
+     * @param multiThreaded : true to cut the points between threads (see LVOX3_ParallelRayCounter), the
+     *                        grids do not depend on the number of threads
+     * @param staging : copy of the points of the index, used instead of the index if not NULL (optionnal)
+     * @param points : indexes (in the staging if used, otherwise in the index) of the points whose ray is
+     *                 traversed, all points if NULL (optionnal)
      */
     LVOX3_ComputeBefore(const CT_ShootingPattern* pattern,
                         const CT_AbstractPointCloudIndex* pointCloudIndex,
                         lvox::Grid3Di* before,
-                        lvox::Grid3Df* shotDeltaDistance = NULL);
+                        lvox::Grid3Df* shotDeltaDistance = NULL,
+                        const LVOX3_ColumnFilter* outsideFilter = NULL,
+                        bool multiThreaded = false,
+                        const LVOX3_PointStaging* staging = NULL,
+                        const std::vector<size_t>* points = NULL);
 
 protected:
     /**
@@ -44,6 +57,22 @@ private:
     const CT_AbstractPointCloudIndex*   m_pointCloudIndex;
     lvox::Grid3Di*                      m_before;
     lvox::Grid3Df*                      m_shotDeltaDistance;
+    const LVOX3_ColumnFilter*           m_outsideFilter;
+    bool                                m_multiThreaded;
+    const LVOX3_PointStaging*           m_staging;
+    const std::vector<size_t>*          m_points;
+
+    /**
+     * @brief Traverse the rays of the points in this thread
+     * @return the number of points done
+     */
+    size_t traverseSequentially();
+
+    /**
+     * @brief Traverse the rays of the points on several threads
+     * @return the number of points done
+     */
+    size_t traverseInParallel();
 };
 
 #endif // LVOX3_COMPUTEBEFORE_H
@@ -45,4 +45,7 @@ void LVOX3_ComputeDensity::doTheJob()
     }
 
     m_density->computeMinMax();
+
+    setItemsProcessed(nbVoxels, "cells");
+    addGridBytes(nbVoxels * sizeof(lvox::Grid3DfType));
 }
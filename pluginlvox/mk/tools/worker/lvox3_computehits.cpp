@@ -2,22 +2,28 @@
 
 #include "ct_itemdrawable/ct_beam.h"
 #include "ct_iterator/ct_pointiterator.h"
+#include "ct_accessor/ct_pointaccessor.h"
 
 #include "mk/tools/lvox3_gridtools.h"
 #include "mk/tools/lvox3_rayboxintersectionmath.h"
 #include "mk/tools/lvox3_errorcode.h"
+#include "mk/tools/lvox3_pointstaging.h"
 
 LVOX3_ComputeHits::LVOX3_ComputeHits(const CT_ShootingPattern* pattern,
                                      const CT_AbstractPointCloudIndex* pointCloudIndex,
                                      lvox::Grid3Di* hits,
                                      lvox::Grid3Df* shotInDistance,
-                                     lvox::Grid3Df* shotOutDistance) : LVOX3_Worker()
+                                     lvox::Grid3Df* shotOutDistance,
+                                     const LVOX3_PointStaging* staging,
+                                     const std::vector<size_t>* points) : LVOX3_Worker()
 {
     m_pattern = pattern;
     m_pointCloudIndex = pointCloudIndex;
     m_hits = hits;
     m_shotInDistance = shotInDistance;
     m_shotOutDistance = shotOutDistance;
+    m_staging = staging;
+    m_points = points;
 }
 
 void LVOX3_ComputeHits::doTheJob()
@@ -25,7 +31,7 @@ void LVOX3_ComputeHits::doTheJob()
     size_t i = 0, indice, pointCol, pointLin, pointLevel;
     Eigen::Vector3d bottom, top, in, out;
 
-    const size_t n_points = m_pointCloudIndex->size();
+    const size_t n_points = (m_points != NULL) ? m_points->size() : m_pointCloudIndex->size();
     Eigen::Vector3d scanPos;
 
     bool computeDistance = (m_shotInDistance != NULL) || (m_shotOutDistance != NULL);
@@ -37,15 +43,13 @@ void LVOX3_ComputeHits::doTheJob()
 
     LVOX3_GridTools gridTool(m_hits);
 
-    CT_PointIterator itP(m_pointCloudIndex);
+    // the grid can be a tile of a bigger grid so points outside must be ignored
+    Eigen::Vector3d gridMin, gridMax;
+    m_hits->getBoundingBox(gridMin, gridMax);
 
-    while (itP.hasNext()
-           && !mustCancel())
-    {
-        ++i;
-        const CT_Point &point = itP.next().currentPoint();
-
-        // we now that the grid is perfectly bounding the scene so we can use this tools that don't do
+    // add a point that is inside the grid
+    const auto addHit = [&](const Eigen::Vector3d& point) {
+        // the point is inside the grid so we can use this tools that don't do
         // many check to reduce the compute time !
         gridTool.computeGridIndexForPoint(point, pointCol, pointLin, pointLevel, indice);
 
@@ -66,12 +70,68 @@ void LVOX3_ComputeHits::doTheJob()
                 }
             }
         }
+    };
+
+    if(m_points != NULL) {
+        CT_PointAccessor accessor;
+
+        while((i < n_points)
+              && !mustCancel())
+        {
+            const size_t index = (*m_points)[i];
+            const Eigen::Vector3d point = (m_staging != NULL) ? m_staging->pointAt(index) : Eigen::Vector3d(accessor.constPointAt(m_pointCloudIndex->indexAt(index)));
+
+            if((point.x() >= gridMin.x()) && (point.y() >= gridMin.y()) && (point.z() >= gridMin.z())
+                    && (point.x() < gridMax.x()) && (point.y() < gridMax.y()) && (point.z() < gridMax.z()))
+                addHit(point);
+
+            ++i;
+            setProgress(i);
+        }
+    } else if(m_staging != NULL) {
+        // points are tested in a linear pass over the arrays, then only points inside are added
+        std::vector<quint8> inside;
+        m_staging->markInside(gridMin, gridMax, inside);
+
+        const size_t n = m_staging->size();
+
+        while((i < n)
+              && !mustCancel())
+        {
+            if(inside[i])
+                addHit(m_staging->pointAt(i));
+
+            ++i;
+            setProgress(i);
+        }
+    } else {
+        CT_PointIterator itP(m_pointCloudIndex);
+
+        while (itP.hasNext()
+               && !mustCancel())
+        {
+            ++i;
+            const CT_Point &point = itP.next().currentPoint();
 
-        setProgress(i);
+            if((point.x() >= gridMin.x()) && (point.y() >= gridMin.y()) && (point.z() >= gridMin.z())
+                    && (point.x() < gridMax.x()) && (point.y() < gridMax.y()) && (point.z() < gridMax.z()))
+                addHit(point);
+
+            setProgress(i);
+        }
     }
 
     m_hits->computeMinMax(); // Calcul des limites hautes et basses des valeurs de la grille => Nécessaire à la visualisation
 
+    setItemsProcessed(i, "points");
+    addGridBytes(m_hits->nCells() * sizeof(lvox::Grid3DiType));
+
+    if(m_shotInDistance != NULL)
+        addGridBytes(m_shotInDistance->nCells() * sizeof(lvox::Grid3DfType));
+
+    if(m_shotOutDistance != NULL)
+        addGridBytes(m_shotOutDistance->nCells() * sizeof(lvox::Grid3DfType));
+
     if (computeDistance
             && !mustCancel())
     {
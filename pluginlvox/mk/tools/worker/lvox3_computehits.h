@@ -14,6 +14,8 @@
 #include "ct_itemdrawable/abstract/ct_abstractimage2d.h"
 #include "ct_itemdrawable/tools/scanner/ct_shootingpattern.h"
 
+class LVOX3_PointStaging;
+
 /*!
  * @brief Computes the "hit" grid of a scene
  */
@@ -29,12 +31,17 @@ public:
      * @param hitsGrid : store it the number of hits
      * @param shotInDistance  : store it the distance between the first intersection point of the shot and the voxel AND the hitted point
      * @param shotOutDistance  : store it the distance between the second intersection point of the shot and the voxel AND the hitted point
+     * @param staging : copy of the points of the index, used instead of the index if not NULL (optionnal)
+     * @param points : indexes (in the staging if used, otherwise in the index) of the points to add if they are
+     *                 inside the grid, all points if NULL (optionnal)
      */
     LVOX3_ComputeHits(const CT_ShootingPattern* pattern,
                       const CT_AbstractPointCloudIndex* pointCloudIndex,
                       lvox::Grid3Di* hits,
                       lvox::Grid3Df* shotInDistance = NULL,
-                      lvox::Grid3Df* shotOutDistance = NULL);
+                      lvox::Grid3Df* shotOutDistance = NULL,
+                      const LVOX3_PointStaging* staging = NULL,
+                      const std::vector<size_t>* points = NULL);
 
 protected:
     /**
@@ -48,6 +55,8 @@ private:
     lvox::Grid3Di*                  m_hits;
     lvox::Grid3Df*                   m_shotInDistance;
     lvox::Grid3Df*                   m_shotOutDistance;
+    const LVOX3_PointStaging*        m_staging;
+    const std::vector<size_t>*       m_points;
 };
 
 #endif // LVOX3_COMPUTEHITS_H
@@ -0,0 +1,68 @@
+#include "lvox3_computeocclusionspace.h"
+
+#include "mk/tools/worker/lvox3_parallelraycounter.h"
+
+#include "ct_accessor/ct_pointaccessor.h"
+
+namespace {
+    /**
+     * @brief Gives the ray that starts at a point and goes away from the scanner (a copy is used per block of points)
+     */
+    class OcclusionRayAt
+    {
+    public:
+        OcclusionRayAt(const CT_AbstractPointCloudIndex* pointCloudIndex,
+                       const Eigen::Vector3d& shotOrigin) :
+            m_pointCloudIndex(pointCloudIndex), m_shotOrigin(shotOrigin) {}
+
+        OcclusionRayAt(const OcclusionRayAt& other) :
+            m_pointCloudIndex(other.m_pointCloudIndex), m_shotOrigin(other.m_shotOrigin) {}
+
+        void operator()(size_t i, Eigen::Vector3d& origin, Eigen::Vector3d& direction) const
+        {
+            origin = m_accessor.constPointAt(m_pointCloudIndex->indexAt(i));
+
+            // normalized like the direction of a CT_Beam
+            direction = (origin - m_shotOrigin).normalized();
+        }
+
+    private:
+        const CT_AbstractPointCloudIndex*   m_pointCloudIndex;
+        Eigen::Vector3d                     m_shotOrigin;
+        mutable CT_PointAccessor            m_accessor;
+    };
+}
+
+LVOX3_ComputeOcclusionSpace::LVOX3_ComputeOcclusionSpace(const CT_ShootingPattern* pattern,
+                                                         const CT_AbstractPointCloudIndex* pointCloudIndex,
+                                                         lvox::Grid3Di* occlusion,
+                                                         double threshold) : LVOX3_Worker()
+{
+    m_pattern = pattern;
+    m_pointCloudIndex = pointCloudIndex;
+    m_occlusion = occlusion;
+    m_threshold = threshold;
+}
+
+void LVOX3_ComputeOcclusionSpace::doTheJob()
+{
+    const size_t n_points = m_pointCloudIndex->size();
+    const Eigen::Vector3d& shotOrigin = m_pattern->getOrigin();
+
+    setProgressRange(0, n_points);
+
+    LVOX3_ParallelRayCounter counter(m_occlusion, NULL, false);
+    counter.setLengthThreshold(m_threshold);
+    counter.run(n_points,
+                OcclusionRayAt(m_pointCloudIndex, shotOrigin),
+                [this](size_t nDone) { setProgress(nDone); },
+                [this]() { return mustCancel(); });
+
+    // Don't forget to calculate min and max in order to visualize it as a colored map
+    m_occlusion->computeMinMax();
+
+    setItemsProcessed(n_points, "points");
+    addGridBytes(m_occlusion->nCells() * sizeof(lvox::Grid3DiType));
+    addVoxelVisits(counter.nVoxelVisits());
+    addTraversalStats(counter.stats());
+}
@@ -0,0 +1,50 @@
+#ifndef LVOX3_COMPUTEOCCLUSIONSPACE_H
+#define LVOX3_COMPUTEOCCLUSIONSPACE_H
+
+#include "lvox3_worker.h"
+#include "mk/tools/lvox3_gridtype.h"
+
+#include "ct_itemdrawable/ct_scene.h"
+#include "ct_itemdrawable/ct_grid3d.h"
+#include "ct_itemdrawable/tools/scanner/ct_shootingpattern.h"
+
+/*!
+ * @brief Computes the occlusion space of a scene : for each voxel the number of rays that go through
+ *        the voxel behind the point (the ray goes from the point in the direction opposite to the scanner)
+ *        at a distance of the point lower than a threshold
+ *
+ * Each scan has its own grid and its own worker, the scans are computed in parallel by LVOX3_ComputeAll.
+ * The points of a scan are cut between threads by LVOX3_ParallelRayCounter, the counts are added under
+ * mutexes so the grid does not depend on the number of threads.
+ */
+class LVOX3_ComputeOcclusionSpace : public LVOX3_Worker
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Create an object that will do the job.
+     * @param pattern : shooting pattern
+     * @param pointCloudIndex : index of points
+     * @param occlusion : store it the number of rays behind the points that go through the voxel
+     * @param threshold : maximum distance between the point and the voxel
+     */
+    LVOX3_ComputeOcclusionSpace(const CT_ShootingPattern* pattern,
+                                const CT_AbstractPointCloudIndex* pointCloudIndex,
+                                lvox::Grid3Di* occlusion,
+                                double threshold);
+
+protected:
+    /**
+     * @brief Do the job
+     */
+    void doTheJob();
+
+private:
+    const CT_ShootingPattern*           m_pattern;
+    const CT_AbstractPointCloudIndex*   m_pointCloudIndex;
+    lvox::Grid3Di*                      m_occlusion;
+    double                              m_threshold;
+};
+
+#endif // LVOX3_COMPUTEOCCLUSIONSPACE_H
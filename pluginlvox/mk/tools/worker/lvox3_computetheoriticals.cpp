@@ -4,14 +4,47 @@
 #include "mk/tools/traversal/woo/visitor/lvox3_countvisitor.h"
 #include "mk/tools/traversal/woo/visitor/lvox3_distancevisitor.h"
 #include "mk/tools/lvox3_errorcode.h"
+#include "mk/tools/worker/lvox3_parallelraycounter.h"
+#include "mk/tools/lvox3_mortonorder.h"
+
+namespace {
+    /**
+     * @brief Gives the shot of a shooting pattern (the shot order[i] if an order is used)
+     */
+    class TheoriticalRayAt
+    {
+    public:
+        TheoriticalRayAt(const CT_ShootingPattern* pattern, const std::vector<size_t>& order) :
+            m_pattern(pattern), m_order(order), m_origin(pattern->getOrigin()) {}
+
+        void operator()(size_t i, Eigen::Vector3d& origin, Eigen::Vector3d& direction) const
+        {
+            origin = m_origin;
+            m_pattern->getShotDirectionAt(m_order.empty() ? i : m_order[i], direction);
+        }
+
+    private:
+        const CT_ShootingPattern*   m_pattern;
+        const std::vector<size_t>&  m_order;
+        Eigen::Vector3d             m_origin;
+    };
+}
 
 LVOX3_ComputeTheoriticals::LVOX3_ComputeTheoriticals(const CT_ShootingPattern* pattern,
                                                      lvox::Grid3Di* theoricals,
-                                                     lvox::Grid3Df* shotDeltaDistance) : LVOX3_Worker()
+                                                     lvox::Grid3Df* shotDeltaDistance,
+                                                     const LVOX3_ColumnFilter* outsideFilter,
+                                                     bool multiThreaded,
+                                                     bool mortonOrder,
+                                                     const std::vector<size_t>* shots) : LVOX3_Worker()
 {
     m_pattern = pattern;
     m_outputTheoriticalGrid = theoricals;
     m_outputDeltaTheoriticalGrid = shotDeltaDistance;
+    m_outsideFilter = outsideFilter;
+    m_multiThreaded = multiThreaded;
+    m_mortonOrder = mortonOrder;
+    m_shots = shots;
 }
 
 LVOX3_ComputeTheoriticals::~LVOX3_ComputeTheoriticals()
@@ -20,39 +53,48 @@ LVOX3_ComputeTheoriticals::~LVOX3_ComputeTheoriticals()
 
 void LVOX3_ComputeTheoriticals::doTheJob()
 {
-    // Creates visitors
-    QVector<LVOX3_Grid3DVoxelWooVisitor*> list;
+    const size_t nShot = nShots();
 
-    LVOX3_CountVisitor<lvox::Grid3DiType> countVisitor(m_outputTheoriticalGrid);
-    LVOX3_DistanceVisitor<lvox::Grid3DfType> distVisitor(m_outputDeltaTheoriticalGrid);
-
-    list.append(&countVisitor);
-
-    if (m_outputDeltaTheoriticalGrid != NULL)
-        list.append(&distVisitor);
+    setProgressRange(0, (m_outputDeltaTheoriticalGrid != NULL) ? nShot+1 : nShot);
 
-    // Creates traversal algorithm
-    LVOX3_Grid3DWooTraversalAlgorithm<lvox::Grid3DiType> algo(m_outputTheoriticalGrid, true, list);
+    m_shotOrder.clear();
 
-    const Eigen::Vector3d& origin = m_pattern->getOrigin();
-    Eigen::Vector3d direction;
+    if(m_mortonOrder) {
+        // shots with close directions go through close voxels
+        std::vector<quint64> codes(nShot);
+        Eigen::Vector3d direction;
 
-    const size_t nShot = m_pattern->getNumberOfShots();
+        for(size_t i=0; i<nShot; ++i) {
+            m_pattern->getShotDirectionAt((m_shots != NULL) ? (*m_shots)[i] : i, direction);
+            codes[i] = LVOX3_MortonOrder::directionCode(direction);
+        }
 
-    setProgressRange(0, (m_outputDeltaTheoriticalGrid != NULL) ? nShot+1 : nShot);
+        m_shotOrder = LVOX3_MortonOrder::sortedOrder(codes);
 
-    for(size_t i=0; (i<nShot) && !mustCancel(); ++i) {
-        m_pattern->getShotDirectionAt(i, direction);
+        if(m_shots != NULL) {
+            for(size_t i=0; i<nShot; ++i)
+                m_shotOrder[i] = (*m_shots)[m_shotOrder[i]];
+        }
+    } else if(m_shots != NULL) {
+        m_shotOrder = *m_shots;
+    }
 
-        // algo already check if the ray touch the grid or not so we don't have to do twice !
-        algo.compute(origin, direction);
+    if(m_multiThreaded)
+        traverseInParallel();
+    else
+        traverseSequentially();
 
-        setProgress(i);
-    }
+    m_shotOrder = std::vector<size_t>();
 
     // Don't forget to calculate min and max in order to visualize it as a colored map
     m_outputTheoriticalGrid->computeMinMax();
 
+    setItemsProcessed(nShot, "rays");
+    addGridBytes(m_outputTheoriticalGrid->nCells() * sizeof(lvox::Grid3DiType));
+
+    if(m_outputDeltaTheoriticalGrid != NULL)
+        addGridBytes(m_outputDeltaTheoriticalGrid->nCells() * sizeof(lvox::Grid3DfType));
+
     if ((m_outputDeltaTheoriticalGrid != NULL)
             && !mustCancel())
     {
@@ -75,3 +117,54 @@ void LVOX3_ComputeTheoriticals::doTheJob()
     }
 
 }
+
+size_t LVOX3_ComputeTheoriticals::nShots() const
+{
+    return (m_shots != NULL) ? m_shots->size() : m_pattern->getNumberOfShots();
+}
+
+void LVOX3_ComputeTheoriticals::traverseSequentially()
+{
+    // Creates visitors
+    QVector<LVOX3_Grid3DVoxelWooVisitor*> list;
+
+    LVOX3_CountVisitor<lvox::Grid3DiType> countVisitor(m_outputTheoriticalGrid);
+    LVOX3_DistanceVisitor<lvox::Grid3DfType> distVisitor(m_outputDeltaTheoriticalGrid);
+
+    list.append(&countVisitor);
+
+    if (m_outputDeltaTheoriticalGrid != NULL)
+        list.append(&distVisitor);
+
+    // Creates traversal algorithm
+    LVOX3_Grid3DWooTraversalAlgorithm<lvox::Grid3DiType, lvox::TraversalStatsEnabled> algo(m_outputTheoriticalGrid, true, list, m_outsideFilter);
+
+    const Eigen::Vector3d& origin = m_pattern->getOrigin();
+    Eigen::Vector3d direction;
+
+    const size_t nShot = nShots();
+
+    for(size_t i=0; (i<nShot) && !mustCancel(); ++i) {
+        m_pattern->getShotDirectionAt(m_shotOrder.empty() ? i : m_shotOrder[i], direction);
+
+        // algo already check if the ray touch the grid or not so we don't have to do twice !
+        algo.compute(origin, direction);
+
+        setProgress(i);
+    }
+
+    addVoxelVisits(countVisitor.nVisits());
+    addTraversalStats(algo.stats());
+}
+
+void LVOX3_ComputeTheoriticals::traverseInParallel()
+{
+    LVOX3_ParallelRayCounter counter(m_outputTheoriticalGrid, m_outputDeltaTheoriticalGrid, true, m_outsideFilter);
+    counter.run(nShots(),
+                TheoriticalRayAt(m_pattern, m_shotOrder),
+                [this](size_t nDone) { setProgress(nDone); },
+                [this]() { return mustCancel(); });
+
+    addVoxelVisits(counter.nVoxelVisits());
+    addTraversalStats(counter.stats());
+}
@@ -13,6 +13,8 @@
 #include "ct_itemdrawable/ct_grid3d.h"
 #include "ct_itemdrawable/tools/scanner/ct_shootingpattern.h"
 
+class LVOX3_ColumnFilter;
+
 /*!
  * @brief Computes the "theoricals" grid of a scene
  */
@@ -21,9 +23,20 @@ class LVOX3_ComputeTheoriticals : public LVOX3_Worker
     Q_OBJECT
 
 public:
+    /**
+     * @param outsideFilter : if the grid is a tile, filter of the whole grid (optionnal)
+     * @param multiThreaded : true to cut the shots between threads (see LVOX3_ParallelRayCounter), the
+     *                        grids do not depend on the number of threads
+     * @param mortonOrder : true to traverse the shots in Morton order of their direction (see LVOX3_MortonOrder)
+     * @param shots : indexes of the shots to traverse, all shots of the pattern if NULL (optionnal)
+     */
     LVOX3_ComputeTheoriticals(const CT_ShootingPattern* pattern,
                               lvox::Grid3Di* theoricals,
-                              lvox::Grid3Df* shotDeltaDistance = NULL);
+                              lvox::Grid3Df* shotDeltaDistance = NULL,
+                              const LVOX3_ColumnFilter* outsideFilter = NULL,
+                              bool multiThreaded = false,
+                              bool mortonOrder = false,
+                              const std::vector<size_t>* shots = NULL);
 
     ~LVOX3_ComputeTheoriticals();
 
@@ -37,6 +50,26 @@ private:
     const CT_ShootingPattern*   m_pattern;
     lvox::Grid3Di*              m_outputTheoriticalGrid;
     lvox::Grid3Df*              m_outputDeltaTheoriticalGrid;
+    const LVOX3_ColumnFilter*   m_outsideFilter;
+    bool                        m_multiThreaded;
+    bool                        m_mortonOrder;
+    const std::vector<size_t>*  m_shots;
+    std::vector<size_t>         m_shotOrder;    /*!< order of the shots while computing (empty if all shots in the pattern order) */
+
+    /**
+     * @brief Returns the number of shots to traverse
+     */
+    size_t nShots() const;
+
+    /**
+     * @brief Traverse the shots in this thread
+     */
+    void traverseSequentially();
+
+    /**
+     * @brief Traverse the shots on several threads
+     */
+    void traverseInParallel();
 
     friend class Temp;
 };
@@ -0,0 +1,241 @@
+#include "lvox3_computetiledgrids.h"
+
+#include "mk/tools/worker/lvox3_filtervoxelsbyzvaluesofraster.h"
+#include "mk/tools/worker/lvox3_computehits.h"
+#include "mk/tools/worker/lvox3_computebefore.h"
+#include "mk/tools/worker/lvox3_computetheoriticals.h"
+#include "mk/tools/worker/lvox3_computeall.h"
+#include "mk/tools/lvox3_columnfilter.h"
+#include "mk/tools/lvox3_errorcode.h"
+#include "mk/tools/lvox3_pointstaging.h"
+#include "mk/tools/lvox3_tilerays.h"
+#include "mk/tools/lvox3_quantizeddistancegrid.h"
+
+#include "tools/lvox_binarygrid3d.h"
+
+#include "ct_accessor/ct_pointaccessor.h"
+
+#include <QDir>
+#include <QScopedPointer>
+
+LVOX3_ComputeTiledGrids::LVOX3_ComputeTiledGrids(const LVOX3_GridTiling& tiling,
+                                                 const CT_ShootingPattern* pattern,
+                                                 const CT_AbstractPointCloudIndex* pointCloudIndex,
+                                                 const CT_AbstractImage2D* mnt,
+                                                 const CT_AbstractImage2D* sky,
+                                                 bool computeDistances,
+                                                 const QString& directory,
+                                                 const QString& prefix,
+                                                 bool multiThreaded,
+                                                 bool stagePoints,
+                                                 bool mortonOrder,
+                                                 bool quantizeDistances) : LVOX3_Worker(),
+    m_tiling(tiling)
+{
+    m_pattern = pattern;
+    m_pointCloudIndex = pointCloudIndex;
+    m_mnt = mnt;
+    m_sky = sky;
+    m_computeDistances = computeDistances;
+    m_directory = directory;
+    m_prefix = prefix;
+    m_multiThreaded = multiThreaded;
+    m_stagePoints = stagePoints;
+    m_mortonOrder = mortonOrder;
+    m_quantizeDistances = quantizeDistances;
+    m_nTilesNotWritten = 0;
+    m_nClampedDistances = 0;
+}
+
+int LVOX3_ComputeTiledGrids::nTilesNotWritten() const
+{
+    return m_nTilesNotWritten;
+}
+
+size_t LVOX3_ComputeTiledGrids::nClampedDistances() const
+{
+    return m_nClampedDistances;
+}
+
+quint64 LVOX3_ComputeTiledGrids::scanMemoryBytes(const LVOX3_GridTiling& tiling,
+                                                 const CT_ShootingPattern* pattern,
+                                                 const CT_AbstractPointCloudIndex* pointCloudIndex,
+                                                 bool stagePoints)
+{
+    quint64 bytes = LVOX3_ColumnFilter::memoryBytes(tiling);
+
+    if(stagePoints)
+        bytes += LVOX3_PointStaging::memoryBytes(pointCloudIndex->size());
+
+    // same rays than in doTheJob (the order of the points does not change the number of indexes)
+    const Eigen::Vector3d shotOrigin = pattern->getOrigin();
+    CT_PointAccessor accessor;
+
+    bytes += LVOX3_TileRays::memoryBytes(tiling, pattern->getNumberOfShots(), [pattern, &shotOrigin](size_t i, Eigen::Vector3d& origin, Eigen::Vector3d& direction) {
+        origin = shotOrigin;
+        pattern->getShotDirectionAt(i, direction);
+    });
+
+    bytes += LVOX3_TileRays::memoryBytes(tiling, pointCloudIndex->size(), [pointCloudIndex, &accessor, &shotOrigin](size_t i, Eigen::Vector3d& origin, Eigen::Vector3d& direction) {
+        origin = accessor.constPointAt(pointCloudIndex->indexAt(i));
+        direction = origin - shotOrigin;
+    });
+
+    return bytes;
+}
+
+const LVOX3_WorkersReport& LVOX3_ComputeTiledGrids::getTilesReport() const
+{
+    return m_tilesReport;
+}
+
+void LVOX3_ComputeTiledGrids::doTheJob()
+{
+    const QVector<LVOX3_GridTiling::Tile>& tiles = m_tiling.tiles();
+    const int nTiles = tiles.size();
+
+    setProgressRange(0, nTiles);
+
+    // filter of the whole grid to know if a ray was stopped by the ground or the sky before entering a tile and
+    // where it enters the whole grid
+    LVOX3_ColumnFilter* outsideFilter = new LVOX3_ColumnFilter(m_tiling, m_mnt, m_sky);
+
+    const double resolution = m_tiling.resolution();
+    const size_t zdim = m_tiling.zdim();
+
+    // every tile reads all points of the scan
+    QScopedPointer<LVOX3_PointStaging> staging;
+
+    if(m_stagePoints || m_mortonOrder)
+        staging.reset(new LVOX3_PointStaging(m_pointCloudIndex));
+
+    if(m_mortonOrder)
+        staging->sortByMorton(m_tiling.minBBox(), m_tiling.resolution());
+
+    // a tile only traverses the rays that can touch it
+    const Eigen::Vector3d shotOrigin = m_pattern->getOrigin();
+    CT_PointAccessor accessor;
+
+    const LVOX3_TileRays shots(m_tiling, m_pattern->getNumberOfShots(), [this, &shotOrigin](size_t i, Eigen::Vector3d& origin, Eigen::Vector3d& direction) {
+        origin = shotOrigin;
+        m_pattern->getShotDirectionAt(i, direction);
+    });
+
+    const LVOX3_TileRays points(m_tiling, m_pointCloudIndex->size(), [this, &staging, &accessor, &shotOrigin](size_t i, Eigen::Vector3d& origin, Eigen::Vector3d& direction) {
+        if(!staging.isNull())
+            origin = staging->pointAt(i);
+        else
+            origin = accessor.constPointAt(m_pointCloudIndex->indexAt(i));
+
+        direction = origin - shotOrigin;
+    });
+
+    m_tilesReport.clear();
+    quint64 nVoxelVisits = 0;
+    int nTilesDone = 0;
+
+    for(int t=0; (t<nTiles) && !mustCancel(); ++t) {
+        const LVOX3_GridTiling::Tile& tile = tiles.at(t);
+        const Eigen::Vector3d min = m_tiling.tileMinBBox(tile);
+
+        lvox::Grid3Di* hitGrid = new lvox::Grid3Di(NULL, NULL, min.x(), min.y(), min.z(), tile.xdim, tile.ydim, zdim, resolution, lvox::Max_Error_Code, 0);
+        lvox::Grid3Di* theoriticalGrid = new lvox::Grid3Di(NULL, NULL, min.x(), min.y(), min.z(), tile.xdim, tile.ydim, zdim, resolution, lvox::Max_Error_Code, 0);
+        lvox::Grid3Di* beforeGrid = new lvox::Grid3Di(NULL, NULL, min.x(), min.y(), min.z(), tile.xdim, tile.ydim, zdim, resolution, lvox::Max_Error_Code, 0);
+
+        lvox::Grid3Df* deltaInGrid = NULL;
+        lvox::Grid3Df* deltaOutGrid = NULL;
+        lvox::Grid3Df* deltaTheoritical = NULL;
+        lvox::Grid3Df* deltaBefore = NULL;
+
+        QList<CT_AbstractGrid3D*> allGrids;
+        allGrids.append(hitGrid);
+        allGrids.append(theoriticalGrid);
+        allGrids.append(beforeGrid);
+
+        QList< QPair<QString, CT_AbstractGrid3D*> > gridsToWrite;
+        gridsToWrite.append(qMakePair(QString("hits"), (CT_AbstractGrid3D*)hitGrid));
+        gridsToWrite.append(qMakePair(QString("theoretical"), (CT_AbstractGrid3D*)theoriticalGrid));
+        gridsToWrite.append(qMakePair(QString("before"), (CT_AbstractGrid3D*)beforeGrid));
+
+        if(m_computeDistances) {
+            deltaInGrid = new lvox::Grid3Df(NULL, NULL, min.x(), min.y(), min.z(), tile.xdim, tile.ydim, zdim, resolution, -1, 0);
+            deltaOutGrid = new lvox::Grid3Df(NULL, NULL, min.x(), min.y(), min.z(), tile.xdim, tile.ydim, zdim, resolution, -1, 0);
+            deltaTheoritical = new lvox::Grid3Df(NULL, NULL, min.x(), min.y(), min.z(), tile.xdim, tile.ydim, zdim, resolution, -1, 0);
+            deltaBefore = new lvox::Grid3Df(NULL, NULL, min.x(), min.y(), min.z(), tile.xdim, tile.ydim, zdim, resolution, -1, 0);
+
+            gridsToWrite.append(qMakePair(QString("deltain"), (CT_AbstractGrid3D*)deltaInGrid));
+            gridsToWrite.append(qMakePair(QString("deltaout"), (CT_AbstractGrid3D*)deltaOutGrid));
+            gridsToWrite.append(qMakePair(QString("deltatheoretical"), (CT_AbstractGrid3D*)deltaTheoritical));
+            gridsToWrite.append(qMakePair(QString("deltabefore"), (CT_AbstractGrid3D*)deltaBefore));
+        }
+
+        // same workers than for a whole grid with the rays of the tile, the traversal clip rays to the box of the tile
+        LVOX3_ComputeAll workersManager;
+
+        if(m_mnt != NULL)
+            workersManager.addWorker(0, new LVOX3_FilterVoxelsByZValuesOfRaster(allGrids, m_mnt, LVOX3_FilterVoxelsByZValuesOfRaster::Below, lvox::MNT));
+
+        if(m_sky != NULL)
+            workersManager.addWorker(0, new LVOX3_FilterVoxelsByZValuesOfRaster(allGrids, m_sky, LVOX3_FilterVoxelsByZValuesOfRaster::Above, lvox::Sky));
+
+        // the ray of a point starts at the point so the tile of a point is one of the tiles of its ray
+        workersManager.addWorker(1, new LVOX3_ComputeHits(m_pattern, m_pointCloudIndex, hitGrid, deltaInGrid, deltaOutGrid, staging.data(), &points.raysOfTile(t)));
+        workersManager.addWorker(1, new LVOX3_ComputeTheoriticals(m_pattern, theoriticalGrid, deltaTheoritical, outsideFilter, m_multiThreaded, m_mortonOrder, &shots.raysOfTile(t)));
+        workersManager.addWorker(1, new LVOX3_ComputeBefore(m_pattern, m_pointCloudIndex, beforeGrid, deltaBefore, outsideFilter, m_multiThreaded, staging.data(), &points.raysOfTile(t)));
+
+        connect(this, SIGNAL(cancelRequested()), &workersManager, SLOT(cancel()), Qt::DirectConnection);
+
+        workersManager.compute();
+
+        m_tilesReport.merge(workersManager.getReport());
+
+        foreach (const LVOX3_WorkersReport::Phase& phase, workersManager.getReport().phases()) {
+            foreach (const LVOX3_WorkerStats& s, phase.workers)
+                nVoxelVisits += s.nVoxelVisits;
+        }
+
+        ++nTilesDone;
+
+        // flush the tile on the disk and free the memory before the next one
+        if(!mustCancel()) {
+            bool ok = true;
+
+            for(int i=0; i<gridsToWrite.size(); ++i) {
+                const QString filePath = tileFilePath(gridsToWrite[i].first, tile);
+                CT_AbstractGrid3D* grid = gridsToWrite[i].second;
+
+                // the float grids of a tile are the distance grids
+                lvox::Grid3Df* distances = dynamic_cast<lvox::Grid3Df*>(grid);
+
+                if(m_quantizeDistances && (distances != NULL))
+                    ok = LVOX3_QuantizedDistanceGrid::write(distances, filePath, &m_nClampedDistances) && ok;
+                else
+                    ok = LVOX_BinaryGrid3DFile::write(grid, filePath) && ok;
+            }
+
+            if(!ok)
+                ++m_nTilesNotWritten;
+        }
+
+        for(int i=0; i<gridsToWrite.size(); ++i)
+            delete gridsToWrite[i].second;
+
+        setProgress(t+1);
+    }
+
+    delete outsideFilter;
+
+    // only the grids of one tile are in memory at the same time so the worker uses the grids of the greatest tile
+    setItemsProcessed(nTilesDone, "tiles");
+    addVoxelVisits(nVoxelVisits);
+    addGridBytes(m_tilesReport.peakGridBytes());
+}
+
+QString LVOX3_ComputeTiledGrids::tileFilePath(const QString& gridName, const LVOX3_GridTiling::Tile& tile) const
+{
+    return QDir(m_directory).filePath(QString("%1_%2_%3_%4.%5").arg(m_prefix)
+                                                               .arg(gridName)
+                                                               .arg(tile.col)
+                                                               .arg(tile.lin)
+                                                               .arg(LVOX_BinaryGrid3DFile::suffix()));
+}
@@ -0,0 +1,106 @@
+#ifndef LVOX3_COMPUTETILEDGRIDS_H
+#define LVOX3_COMPUTETILEDGRIDS_H
+
+#include "lvox3_worker.h"
+#include "lvox3_workersreport.h"
+#include "mk/tools/lvox3_gridtype.h"
+#include "mk/tools/lvox3_gridtiling.h"
+
+#include "ct_itemdrawable/ct_scene.h"
+#include "ct_itemdrawable/abstract/ct_abstractimage2d.h"
+#include "ct_itemdrawable/tools/scanner/ct_shootingpattern.h"
+
+/*!
+ * @brief Computes the hits, theoretical and before grids (and distances) of a scene tile by tile. Only
+ *        the grids of one tile are in memory at the same time, when a tile is finished its grids are
+ *        written in binary files (LVG3D) named "prefix_gridname_col_lin" in the output directory.
+ */
+class LVOX3_ComputeTiledGrids : public LVOX3_Worker
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Create an object that will do the job.
+     * @param tiling : geometry of the whole grid and tiles
+     * @param pattern : shooting pattern
+     * @param pointCloudIndex : index of points
+     * @param mnt : voxels below the mnt are filtered (optionnal)
+     * @param sky : voxels above the sky are filtered (optionnal)
+     * @param computeDistances : true to compute distance grids
+     * @param directory : folder where to write grids
+     * @param prefix : prefix of the name of files
+     * @param multiThreaded : true to cut the rays of the theoretical and before grids between threads
+     * @param stagePoints : true to copy the points in contiguous arrays once for all tiles (see LVOX3_PointStaging)
+     * @param mortonOrder : true to process points and shots in Morton order of their voxels (points are staged)
+     * @param quantizeDistances : true to write the distance grids in 16 bits per voxel (see LVOX3_QuantizedDistanceGrid)
+     */
+    LVOX3_ComputeTiledGrids(const LVOX3_GridTiling& tiling,
+                            const CT_ShootingPattern* pattern,
+                            const CT_AbstractPointCloudIndex* pointCloudIndex,
+                            const CT_AbstractImage2D* mnt,
+                            const CT_AbstractImage2D* sky,
+                            bool computeDistances,
+                            const QString& directory,
+                            const QString& prefix,
+                            bool multiThreaded = false,
+                            bool stagePoints = false,
+                            bool mortonOrder = false,
+                            bool quantizeDistances = false);
+
+    /**
+     * @brief Returns the number of tiles that could not be written
+     */
+    int nTilesNotWritten() const;
+
+    /**
+     * @brief Returns the memory used by a scan besides the grids of a tile : filter of the columns of the
+     *        whole grid, copy of the points (optionnal) and indexes of the rays of each tile. Rays are read
+     *        to count their tiles, nothing is stored.
+     * @param stagePoints : true if the points are staged (stagePoints or mortonOrder of the constructor)
+     */
+    static quint64 scanMemoryBytes(const LVOX3_GridTiling& tiling,
+                                   const CT_ShootingPattern* pattern,
+                                   const CT_AbstractPointCloudIndex* pointCloudIndex,
+                                   bool stagePoints);
+
+    /**
+     * @brief Returns the number of distances that could not be stored exactly in the quantized tiles
+     */
+    size_t nClampedDistances() const;
+
+    /**
+     * @brief Returns the statistics of the workers of all tiles (phases of the tiles are merged)
+     */
+    const LVOX3_WorkersReport& getTilesReport() const;
+
+protected:
+    /**
+     * @brief Do the job
+     */
+    void doTheJob();
+
+private:
+    LVOX3_GridTiling                    m_tiling;
+    const CT_ShootingPattern*           m_pattern;
+    const CT_AbstractPointCloudIndex*   m_pointCloudIndex;
+    const CT_AbstractImage2D*           m_mnt;
+    const CT_AbstractImage2D*           m_sky;
+    bool                                m_computeDistances;
+    bool                                m_multiThreaded;
+    bool                                m_stagePoints;
+    bool                                m_mortonOrder;
+    bool                                m_quantizeDistances;
+    QString                             m_directory;
+    QString                             m_prefix;
+    int                                 m_nTilesNotWritten;
+    size_t                              m_nClampedDistances;
+    LVOX3_WorkersReport                 m_tilesReport;
+
+    /**
+     * @brief Returns the path of the file of a tile
+     */
+    QString tileFilePath(const QString& gridName, const LVOX3_GridTiling::Tile& tile) const;
+};
+
+#endif // LVOX3_COMPUTETILEDGRIDS_H
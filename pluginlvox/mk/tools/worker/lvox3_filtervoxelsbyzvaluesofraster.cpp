@@ -55,4 +55,6 @@ void LVOX3_FilterVoxelsByZValuesOfRaster::doTheJob()
             }
         }
     }
+
+    setItemsProcessed(nCells, "cells");
 }
@@ -96,6 +96,8 @@ void LVOX3_GenericCompute::doTheJob()
     }
 
     m_output->computeMinMax();
+
+    setItemsProcessed(nCells, "cells");
 }
 
 void LVOX3_GenericCompute::initParser(mu::Parser &parser, const std::string& formula)
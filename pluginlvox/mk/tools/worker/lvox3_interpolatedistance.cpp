@@ -34,4 +34,7 @@ void LVOX3_InterpolateDistance::doTheJob()
             algo.startFromCell(i);
         }
     }
+
+    setItemsProcessed(nCells, "cells");
+    addGridBytes(m_outDensityGrid->nCells() * sizeof(lvox::Grid3DfType));
 }
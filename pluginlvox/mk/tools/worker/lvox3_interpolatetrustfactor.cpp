@@ -47,4 +47,7 @@ void LVOX3_InterpolateTrustFactor::doTheJob()
             algo.startFromCell(i);
         }
     }
+
+    setItemsProcessed(nCells, "cells");
+    addGridBytes(m_outDensityGrid->nCells() * sizeof(lvox::Grid3DfType));
 }
@@ -0,0 +1,157 @@
+#ifndef LVOX3_PARALLELRAYCOUNTER_H
+#define LVOX3_PARALLELRAYCOUNTER_H
+
+#include "mk/tools/lvox3_gridtype.h"
+#include "mk/tools/lvox3_mutexstripes.h"
+#include "mk/tools/lvox3_fixedpointsumgrid.h"
+#include "mk/tools/traversal/woo/lvox3_grid3dwootraversalalgorithm.h"
+#include "mk/tools/traversal/woo/visitor/lvox3_countvisitor.h"
+#include "mk/tools/traversal/woo/visitor/lvox3_countwithlengththresholdvisitor.h"
+#include "mk/tools/traversal/woo/visitor/lvox3_distancevisitor.h"
+#include "mk/tools/traversal/woo/visitor/lvox3_fixedpointdistancevisitor.h"
+
+#include "tools/lvox_parallelfor.h"
+
+#include <QAtomicInt>
+#include <QMutexLocker>
+#include <QScopedPointer>
+
+/*!
+ * @brief Traverse rays on several threads, count them in the voxels they go through (or only in the
+ *        voxels near their origin, see setLengthThreshold) and sum their lengths in the voxels
+ *
+ * The result does not depend on the number of threads : counts are integers added under mutexes
+ * (LVOX3_MutexStripes) and lengths are summed in fixed point (LVOX3_FixedPointSumGrid) then
+ * rounded once to the float grid. The fixed point sums use 8 bytes per voxel while the rays are
+ * traversed, they are only created when the rays are cut in several blocks (the number of blocks
+ * depends on the number of rays, not on the number of threads).
+ */
+class LVOX3_ParallelRayCounter
+{
+public:
+    /**
+     * @param counts : grid where to count the rays
+     * @param distances : grid where to add the lengths of the rays in the voxels (optionnal)
+     * @param visitFirstVoxelTouched : see LVOX3_Grid3DWooTraversalAlgorithm
+     * @param outsideFilter : if the grid is a tile, filter of the whole grid (optionnal)
+     */
+    LVOX3_ParallelRayCounter(lvox::Grid3Di* counts,
+                             lvox::Grid3Df* distances,
+                             bool visitFirstVoxelTouched,
+                             const LVOX3_ColumnFilter* outsideFilter = NULL)
+    {
+        m_counts = counts;
+        m_distances = distances;
+        m_visitFirstVoxelTouched = visitFirstVoxelTouched;
+        m_outsideFilter = outsideFilter;
+        m_lengthThreshold = 0;
+        m_nVoxelVisits = 0;
+    }
+
+    /**
+     * @brief Count a ray in a voxel only if the voxel is at a distance of the origin of the ray lower than
+     *        the threshold (see LVOX3_CountWithLengthThresholdVisitor), 0 to count the ray in all voxels
+     */
+    void setLengthThreshold(double threshold) { m_lengthThreshold = threshold; }
+
+    /**
+     * @brief Traverse the rays [0;nRays[
+     * @param rayAt : "rayAt(i, origin, direction)" gives the ray i, it is copied for each block of rays
+     * @param progress : "progress(nRaysDone)" is called from time to time (never at the same time)
+     * @param mustCancel : "mustCancel()" returns true if the traversal must stop
+     */
+    template<typename RayAt, typename Progress, typename Cancel>
+    void run(size_t nRays, const RayAt& rayAt, const Progress& progress, const Cancel& mustCancel)
+    {
+        const bool severalBlocks = (LVOX_ParallelFor::cut(0, nRays, PROGRESS_STEP).size() > 1);
+
+        QScopedPointer<LVOX3_MutexStripes> mutexes;
+        QScopedPointer<LVOX3_FixedPointSumGrid> sums;
+
+        if(severalBlocks) {
+            mutexes.reset(new LVOX3_MutexStripes());
+
+            if(m_distances != NULL)
+                sums.reset(new LVOX3_FixedPointSumGrid(m_distances->nCells()));
+        }
+
+        const LVOX3_MutexStripes* sharedMutexes = mutexes.data();
+        LVOX3_FixedPointSumGrid* sharedSums = sums.data();
+
+        QAtomicInt nStepsDone(0);
+        QMutex mutex;
+
+        LVOX_ParallelFor::run(0, nRays, [&](size_t begin, size_t end) {
+            QVector<LVOX3_Grid3DVoxelWooVisitor*> list;
+
+            QScopedPointer<LVOX3_CountVisitor<lvox::Grid3DiType> > countVisitor;
+            QScopedPointer<LVOX3_CountWithLengthThresholdVisitor<lvox::Grid3DiType> > thresholdVisitor;
+
+            if(m_lengthThreshold > 0) {
+                thresholdVisitor.reset(new LVOX3_CountWithLengthThresholdVisitor<lvox::Grid3DiType>(m_counts, m_lengthThreshold, sharedMutexes));
+                list.append(thresholdVisitor.data());
+            } else {
+                countVisitor.reset(new LVOX3_CountVisitor<lvox::Grid3DiType>(m_counts, sharedMutexes));
+                list.append(countVisitor.data());
+            }
+
+            QScopedPointer<LVOX3_Grid3DVoxelWooVisitor> distVisitor;
+
+            if(sharedSums != NULL)
+                distVisitor.reset(new LVOX3_FixedPointDistanceVisitor(m_counts, sharedSums));
+            else if(m_distances != NULL)
+                distVisitor.reset(new LVOX3_DistanceVisitor<lvox::Grid3DfType>(m_distances));
+
+            if(!distVisitor.isNull())
+                list.append(distVisitor.data());
+
+            LVOX3_Grid3DWooTraversalAlgorithm<lvox::Grid3DiType, lvox::TraversalStatsEnabled> algo(m_counts, m_visitFirstVoxelTouched, list, m_outsideFilter);
+
+            RayAt blockRayAt(rayAt);
+            Eigen::Vector3d origin, direction;
+
+            for(size_t i = begin ; (i < end) && !mustCancel() ; ++i)
+            {
+                blockRayAt(i, origin, direction);
+                algo.compute(origin, direction);
+
+                if(((i - begin + 1) % PROGRESS_STEP) == 0) {
+                    const int nSteps = nStepsDone.fetchAndAddRelaxed(1) + 1;
+
+                    QMutexLocker locker(&mutex);
+                    progress(nSteps * (size_t)PROGRESS_STEP);
+                }
+            }
+
+            QMutexLocker locker(&mutex);
+            m_nVoxelVisits += countVisitor.isNull() ? thresholdVisitor->nVisits() : countVisitor->nVisits();
+            m_stats.merge(algo.stats());
+        }, PROGRESS_STEP);
+
+        if((sharedSums != NULL) && !mustCancel())
+            sharedSums->addTo(m_distances);
+    }
+
+    /**
+     * @brief Returns the number of voxels visited by the last run
+     */
+    quint64 nVoxelVisits() const { return m_nVoxelVisits; }
+
+    /**
+     * @brief Returns the statistics of the rays of the last run (empty if not lvox::TraversalStatsEnabled)
+     */
+    const LVOX3_TraversalStats& stats() const { return m_stats; }
+
+private:
+    lvox::Grid3Di*              m_counts;
+    lvox::Grid3Df*              m_distances;
+    bool                        m_visitFirstVoxelTouched;
+    const LVOX3_ColumnFilter*   m_outsideFilter;
+    double                      m_lengthThreshold;
+    quint64                     m_nVoxelVisits;
+    LVOX3_TraversalStats        m_stats;
+
+    static const size_t PROGRESS_STEP = 4096;
+};
+
+#endif // LVOX3_PARALLELRAYCOUNTER_H
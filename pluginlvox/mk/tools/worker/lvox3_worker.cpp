@@ -3,6 +3,36 @@
 #include <QElapsedTimer>
 #include <QDebug>
 
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#elif defined(Q_OS_UNIX)
+#include <time.h>
+#endif
+
+namespace {
+    /**
+     * @brief CPU time used by the current thread in ms (0 if not available)
+     */
+    double threadCPUTimeMs()
+    {
+#if defined(Q_OS_WIN)
+        FILETIME creation, exit, kernel, user;
+
+        if(GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+            const quint64 k = (((quint64)kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime;
+            const quint64 u = (((quint64)user.dwHighDateTime) << 32) | user.dwLowDateTime;
+            return (k + u) / 10000.0; // unit is 100 ns
+        }
+#elif defined(Q_OS_UNIX) && defined(CLOCK_THREAD_CPUTIME_ID)
+        struct timespec ts;
+
+        if(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+            return (ts.tv_sec * 1000.0) + (ts.tv_nsec / 1000000.0);
+#endif
+        return 0;
+    }
+}
+
 LVOX3_Worker::LVOX3_Worker()
 {
     m_progress = 0;
@@ -42,6 +72,32 @@ int LVOX3_Worker::getProgressRange() const
     return m_progressRange;
 }
 
+const LVOX3_WorkerStats& LVOX3_Worker::getStats() const
+{
+    return m_stats;
+}
+
+void LVOX3_Worker::setItemsProcessed(quint64 n, const QString& unit)
+{
+    m_stats.nItems = n;
+    m_stats.itemsUnit = unit;
+}
+
+void LVOX3_Worker::addVoxelVisits(quint64 n)
+{
+    m_stats.nVoxelVisits += n;
+}
+
+void LVOX3_Worker::addGridBytes(quint64 bytes)
+{
+    m_stats.gridBytes += bytes;
+}
+
+void LVOX3_Worker::addTraversalStats(const LVOX3_TraversalStats& stats)
+{
+    m_stats.traversal.merge(stats);
+}
+
 void LVOX3_Worker::compute()
 {
     m_cancel = false;
@@ -49,11 +105,19 @@ void LVOX3_Worker::compute()
 
     setProgress(0);
 
+    m_stats = LVOX3_WorkerStats();
+    m_stats.name = metaObject()->className();
+
+    const double cpuStart = threadCPUTimeMs();
+
     QElapsedTimer timer;
     timer.start();
 
     doTheJob();
 
+    m_stats.wallTimeMs = timer.nsecsElapsed() / 1000000.0;
+    m_stats.cpuTimeMs = threadCPUTimeMs() - cpuStart;
+
     qDebug() << metaObject()->className() << " elapsed : " << timer.elapsed();
 
     m_finished = true;
@@ -7,6 +7,26 @@
 #define LVOX3_WORKER_H
 
 #include <QObject>
+#include <QString>
+
+#include "mk/tools/traversal/woo/lvox3_traversalstats.h"
+
+/*!
+ * @brief Statistics of a job, filled by compute() (times) and by the worker (items, visits, grids)
+ */
+struct LVOX3_WorkerStats {
+    LVOX3_WorkerStats() : wallTimeMs(0), cpuTimeMs(0), nItems(0), nVoxelVisits(0), gridBytes(0) {}
+
+    QString name;           /*!< class name of the worker */
+    double  wallTimeMs;     /*!< elapsed time of the job */
+    double  cpuTimeMs;      /*!< CPU time of the thread that did the job (0 if not available) */
+    quint64 nItems;         /*!< number of items processed */
+    QString itemsUnit;      /*!< what is an item : "points", "rays", "cells", ... */
+    quint64 nVoxelVisits;   /*!< number of voxels visited by the traversal algorithms */
+    quint64 gridBytes;      /*!< memory of the grids written by the worker */
+
+    LVOX3_TraversalStats traversal;     /*!< statistics of the rays (only if lvox::TraversalStatsEnabled) */
+};
 
 /*!
  * @brief Do a job
@@ -34,6 +54,11 @@ public:
      */
     bool isFinished() const;
 
+    /**
+     * @brief Returns the statistics of the last job
+     */
+    const LVOX3_WorkerStats& getStats() const;
+
 public slots:
     /**
      * @brief Do the job
@@ -76,6 +101,26 @@ protected:
      */
     int getProgressRange() const;
 
+    /**
+     * @brief Set the number of items processed by the job and what is an item ("points", "rays", ...)
+     */
+    void setItemsProcessed(quint64 n, const QString& unit);
+
+    /**
+     * @brief Add voxels visited by a traversal algorithm
+     */
+    void addVoxelVisits(quint64 n);
+
+    /**
+     * @brief Add the memory of a grid written by the job
+     */
+    void addGridBytes(quint64 bytes);
+
+    /**
+     * @brief Add the statistics of the rays of a traversal algorithm
+     */
+    void addTraversalStats(const LVOX3_TraversalStats& stats);
+
 private:
     int     m_progress;
     int     m_progressMin;
@@ -84,6 +129,8 @@ private:
     bool    m_cancel;
     bool    m_finished;
 
+    LVOX3_WorkerStats   m_stats;
+
 signals:
     /**
      * @brief Emitted when the progression changed (always between [0;100])
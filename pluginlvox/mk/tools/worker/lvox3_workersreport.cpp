@@ -0,0 +1,223 @@
+#include "lvox3_workersreport.h"
+
+#include <QFile>
+#include <QMap>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+namespace {
+
+    /**
+     * @brief Statistics of all workers of the same type in a phase
+     */
+    QMap<QString, LVOX3_WorkerStats> statsByWorkerType(const QList<LVOX3_WorkerStats>& workers, QMap<QString, int>& counts)
+    {
+        QMap<QString, LVOX3_WorkerStats> byType;
+
+        foreach (const LVOX3_WorkerStats& s, workers) {
+            LVOX3_WorkerStats& t = byType[s.name];
+            t.name = s.name;
+            t.itemsUnit = s.itemsUnit;
+            t.wallTimeMs += s.wallTimeMs;
+            t.cpuTimeMs += s.cpuTimeMs;
+            t.nItems += s.nItems;
+            t.nVoxelVisits += s.nVoxelVisits;
+            t.gridBytes += s.gridBytes;
+            t.traversal.merge(s.traversal);
+            ++counts[s.name];
+        }
+
+        return byType;
+    }
+
+    double toMB(quint64 bytes)
+    {
+        return bytes / (1024.0 * 1024.0);
+    }
+}
+
+LVOX3_WorkersReport::LVOX3_WorkersReport()
+{
+    m_gridBytes = 0;
+    m_keptGridBytes = 0;
+    m_peakGridBytes = 0;
+}
+
+void LVOX3_WorkersReport::addPhase(const Phase& phase)
+{
+    m_phases.append(phase);
+
+    foreach (const LVOX3_WorkerStats& s, phase.workers) {
+        m_gridBytes += s.gridBytes;
+        m_keptGridBytes += s.gridBytes;
+    }
+
+    m_peakGridBytes = qMax(m_peakGridBytes, m_keptGridBytes);
+}
+
+void LVOX3_WorkersReport::merge(const LVOX3_WorkersReport& other)
+{
+    foreach (const Phase& p, other.m_phases) {
+        bool found = false;
+
+        for(int i=0; (i<m_phases.size()) && !found; ++i) {
+            Phase& mine = m_phases[i];
+
+            if(mine.startIndex == p.startIndex) {
+                mine.wallTimeMs += p.wallTimeMs;
+                mine.workers.append(p.workers);
+                found = true;
+            }
+        }
+
+        if(!found)
+            m_phases.append(p);
+    }
+
+    m_gridBytes += other.m_gridBytes;
+    m_peakGridBytes = qMax(m_peakGridBytes, other.m_peakGridBytes);
+}
+
+void LVOX3_WorkersReport::clear()
+{
+    m_phases.clear();
+    m_gridBytes = 0;
+    m_keptGridBytes = 0;
+    m_peakGridBytes = 0;
+}
+
+const QList<LVOX3_WorkersReport::Phase>& LVOX3_WorkersReport::phases() const
+{
+    return m_phases;
+}
+
+double LVOX3_WorkersReport::wallTimeMs() const
+{
+    double total = 0;
+
+    foreach (const Phase& p, m_phases)
+        total += p.wallTimeMs;
+
+    return total;
+}
+
+quint64 LVOX3_WorkersReport::totalGridBytes() const
+{
+    return m_gridBytes;
+}
+
+quint64 LVOX3_WorkersReport::peakGridBytes() const
+{
+    return m_peakGridBytes;
+}
+
+QStringList LVOX3_WorkersReport::toText() const
+{
+    QStringList lines;
+
+    foreach (const Phase& p, m_phases) {
+        lines.append(QString("Phase %1 : %2 ms").arg(p.startIndex).arg(p.wallTimeMs, 0, 'f', 1));
+
+        QMap<QString, int> counts;
+        const QMap<QString, LVOX3_WorkerStats> byType = statsByWorkerType(p.workers, counts);
+
+        QMapIterator<QString, LVOX3_WorkerStats> it(byType);
+
+        while(it.hasNext()) {
+            it.next();
+            const LVOX3_WorkerStats& s = it.value();
+
+            // the rate is per worker : items divided by the time spent by the workers
+            const double rate = (s.wallTimeMs > 0) ? (s.nItems / (s.wallTimeMs / 1000.0)) : 0;
+
+            QString line = QString("    %1 x%2 : %3 ms (CPU %4 ms)").arg(s.name)
+                                                                    .arg(counts.value(s.name))
+                                                                    .arg(s.wallTimeMs, 0, 'f', 1)
+                                                                    .arg(s.cpuTimeMs, 0, 'f', 1);
+
+            if(s.nItems > 0)
+                line += QString(", %1 %2 (%3 %2/s)").arg(s.nItems).arg(s.itemsUnit).arg(rate, 0, 'f', 0);
+
+            if(s.nVoxelVisits > 0)
+                line += QString(", %1 voxel visits").arg(s.nVoxelVisits);
+
+            if(s.gridBytes > 0)
+                line += QString(", %1 MB of grids").arg(toMB(s.gridBytes), 0, 'f', 1);
+
+            lines.append(line);
+
+            foreach (const QString& traversalLine, s.traversal.toText())
+                lines.append(QString("        %1").arg(traversalLine));
+        }
+    }
+
+    lines.append(QString("Total : %1 ms, %2 MB of grids (at most %3 MB at the same time)").arg(wallTimeMs(), 0, 'f', 1)
+                                                                                           .arg(toMB(m_gridBytes), 0, 'f', 1)
+                                                                                           .arg(toMB(m_peakGridBytes), 0, 'f', 1));
+
+    return lines;
+}
+
+QByteArray LVOX3_WorkersReport::toJSON() const
+{
+    QJsonArray phases;
+
+    foreach (const Phase& p, m_phases) {
+        QJsonArray workers;
+
+        foreach (const LVOX3_WorkerStats& s, p.workers) {
+            QJsonObject w;
+            w.insert("name", s.name);
+            w.insert("wall_time_ms", s.wallTimeMs);
+            w.insert("cpu_time_ms", s.cpuTimeMs);
+            w.insert("items", (double)s.nItems);
+            w.insert("items_unit", s.itemsUnit);
+            w.insert("voxel_visits", (double)s.nVoxelVisits);
+            w.insert("grid_bytes", (double)s.gridBytes);
+
+            if(s.traversal.nRays > 0) {
+                QJsonArray histogram;
+
+                for(int b=0; b<LVOX3_TraversalStats::N_BUCKETS; ++b)
+                    histogram.append((double)s.traversal.voxelsPerRay[b]);
+
+                QJsonObject t;
+                t.insert("rays", (double)s.traversal.nRays);
+                t.insert("missed_grid", (double)s.traversal.nMissedGrid);
+                t.insert("stopped_before_grid", (double)s.traversal.nStoppedBeforeGrid);
+                t.insert("stopped_on_filtered_voxel", (double)s.traversal.nStoppedOnFilteredVoxel);
+                t.insert("voxel_visits", (double)s.traversal.nVoxelVisits);
+                t.insert("voxels_per_ray_log2_histogram", histogram);
+                w.insert("traversal", t);
+            }
+            workers.append(w);
+        }
+
+        QJsonObject phase;
+        phase.insert("start_index", p.startIndex);
+        phase.insert("wall_time_ms", p.wallTimeMs);
+        phase.insert("workers", workers);
+        phases.append(phase);
+    }
+
+    QJsonObject root;
+    root.insert("phases", phases);
+    root.insert("wall_time_ms", wallTimeMs());
+    root.insert("total_grid_bytes", (double)m_gridBytes);
+    root.insert("peak_grid_bytes", (double)m_peakGridBytes);
+
+    return QJsonDocument(root).toJson();
+}
+
+bool LVOX3_WorkersReport::writeJSON(const QString& filePath) const
+{
+    QFile f(filePath);
+
+    if(!f.open(QFile::WriteOnly | QFile::Truncate))
+        return false;
+
+    const QByteArray json = toJSON();
+
+    return f.write(json) == json.size();
+}
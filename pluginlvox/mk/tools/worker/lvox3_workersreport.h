@@ -0,0 +1,85 @@
+#ifndef LVOX3_WORKERSREPORT_H
+#define LVOX3_WORKERSREPORT_H
+
+#include "lvox3_worker.h"
+
+#include <QList>
+#include <QStringList>
+
+/*!
+ * @brief Statistics of the workers of a LVOX3_ComputeAll, phase by phase (a phase is the set
+ *        of workers with the same start index)
+ */
+class LVOX3_WorkersReport
+{
+public:
+    struct Phase {
+        Phase() : startIndex(0), wallTimeMs(0) {}
+
+        int                         startIndex;
+        double                      wallTimeMs;     /*!< elapsed time between the start of the first worker and the end of the last one */
+        QList<LVOX3_WorkerStats>    workers;
+    };
+
+    LVOX3_WorkersReport();
+
+    /**
+     * @brief Add a phase. Grids of the workers are added to the total and to the grids in memory
+     *        (grids are kept until the end).
+     */
+    void addPhase(const Phase& phase);
+
+    /**
+     * @brief Add the phases of another report (phases with the same start index are merged). Grids
+     *        of the other report are added to the total but are considered freed before the grids
+     *        of this report, the peak is the greatest of both peaks.
+     */
+    void merge(const LVOX3_WorkersReport& other);
+
+    /**
+     * @brief Remove all phases
+     */
+    void clear();
+
+    const QList<Phase>& phases() const;
+
+    /**
+     * @brief Returns the sum of the elapsed time of all phases
+     */
+    double wallTimeMs() const;
+
+    /**
+     * @brief Returns the memory of the grids written by the workers of all phases and of all merged reports
+     */
+    quint64 totalGridBytes() const;
+
+    /**
+     * @brief Returns the greatest memory of the grids kept at the same time (the grids of this report
+     *        or of the greatest merged report)
+     */
+    quint64 peakGridBytes() const;
+
+    /**
+     * @brief Returns the report as lines of text (one line per phase and per type of worker)
+     */
+    QStringList toText() const;
+
+    /**
+     * @brief Returns the report in JSON
+     */
+    QByteArray toJSON() const;
+
+    /**
+     * @brief Write the report in JSON in a file
+     * @return false if the file can not be written
+     */
+    bool writeJSON(const QString& filePath) const;
+
+private:
+    QList<Phase>    m_phases;
+    quint64         m_gridBytes;
+    quint64         m_keptGridBytes;
+    quint64         m_peakGridBytes;
+};
+
+#endif // LVOX3_WORKERSREPORT_H
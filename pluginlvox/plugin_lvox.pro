@@ -12,6 +12,18 @@ contains ( QT_VERSION, "^5.*" ) {
     LIBS += -lQt5Concurrent
 }
 
+# floating point operations do not trap (it is the default of clang), gcc can then
+# vectorize the loops on grids that contains conditions (see LVOX_StepComputePAD)
+*-g++* {
+    QMAKE_CXXFLAGS += -fno-trapping-math
+}
+
+# statistics of the rays of the traversal algorithm (voxels per ray, rays stopped early) written in the
+# report of the LVOX3 workers, disabled by default : run qmake with "CONFIG+=lvox_traversal_stats"
+lvox_traversal_stats {
+    DEFINES += LVOX3_TRAVERSAL_STATS
+}
+
 TARGET = plug_lvoxv2
 
 HEADERS += $${PLUGIN_SHARED_INTERFACE_DIR}/interfaces.h \
@@ -33,6 +45,14 @@ HEADERS += $${PLUGIN_SHARED_INTERFACE_DIR}/interfaces.h \
 #    step/lvox_stepmergeinputs.h \
     step/lvox_stepexportcomputedgrids.h \
     tools/lvox_grid3dexporter.h \
+    tools/lvox_binarygrid3d.h \
+    tools/lvox_parallelfor.h \
+    tools/lvox_gridcombiner.h \
+    tools/lvox_gridcombinerstate.h \
+    tools/lvox_math.h \
+    tools/lvox_gridkernels.h \
+    tools/lvox_gridbounds.h \
+    tools/lvox_threadscheduler.h \
 #    step/lvox_stepimportcomputedgrids.h \
     step/lvox_stepexportmergedgrids.h \
 #    step/lvox_stepimportmergedgrids.h \
@@ -47,8 +67,8 @@ HEADERS += $${PLUGIN_SHARED_INTERFACE_DIR}/interfaces.h \
     urfm/step/lvox2_stepcomputeheightprofile.h \
     urfm/step/lvox2_stepfiltergridbyradius.h \
     urfm/step/lvox2_steppreparepointcloud.h \
+    urfm/tools/lvox2_pointflagger.h \
     tools/lvox_countwithlengththresholdvisitor.h \
-    tools/lvox_computebeforewithlengththresholdthread.h \
     step/lvox_stepcomputeocclusionspace.h \
     mk/step/lvox3_stepcomputelvoxgrids.h \
     mk/tools/worker/lvox3_computehits.h \
@@ -56,16 +76,33 @@ HEADERS += $${PLUGIN_SHARED_INTERFACE_DIR}/interfaces.h \
     mk/tools/worker/lvox3_worker.h \
     mk/tools/worker/lvox3_computetheoriticals.h \
     mk/tools/worker/lvox3_computebefore.h \
+    mk/tools/worker/lvox3_computeocclusionspace.h \
     mk/tools/worker/lvox3_computedensity.h \
     mk/tools/lvox3_computelvoxgridspreparator.h \
+    mk/tools/lvox3_gridcache.h \
+    mk/tools/lvox3_gridtiling.h \
+    mk/tools/lvox3_tilerays.h \
+    mk/tools/lvox3_columnfilter.h \
+    mk/tools/worker/lvox3_computetiledgrids.h \
     mk/tools/lvox3_gridmode.h \
     mk/tools/lvox3_gridtype.h \
     mk/tools/worker/lvox3_computeall.h \
+    mk/tools/worker/lvox3_workersreport.h \
+    mk/tools/worker/lvox3_parallelraycounter.h \
     mk/tools/lvox3_gridtools.h \
     mk/tools/traversal/woo/lvox3_grid3dwootraversalalgorithm.h \
+    mk/tools/traversal/woo/lvox3_traversalstats.h \
+    mk/tools/traversal/woo/visitor/lvox3_fixedpointdistancevisitor.h \
+    mk/tools/lvox3_fixedpointsumgrid.h \
+    mk/tools/lvox3_compactcountgrid.h \
+    mk/tools/lvox3_quantizeddistancegrid.h \
+    mk/tools/lvox3_mutexstripes.h \
+    mk/tools/lvox3_pointstaging.h \
+    mk/tools/lvox3_mortonorder.h \
     mk/tools/lvox3_rayboxintersectionmath.h \
     mk/tools/traversal/woo/visitor/lvox3_countvisitor.h \
     mk/tools/traversal/woo/visitor/lvox3_distancevisitor.h \
+    mk/tools/traversal/woo/visitor/lvox3_countwithlengththresholdvisitor.h \
     mk/view/loadfileconfiguration.h \
     mk/step/lvox3_steploadfiles.h \
     mk/step/lvox3_stepgenericcomputegrids.h \
@@ -107,6 +144,10 @@ SOURCES += \
 #    step/lvox_stepmergeinputs.cpp \
     step/lvox_stepexportcomputedgrids.cpp \
     tools/lvox_grid3dexporter.cpp \
+    tools/lvox_binarygrid3d.cpp \
+    tools/lvox_gridcombiner.cpp \
+    tools/lvox_gridcombinerstate.cpp \
+    tools/lvox_threadscheduler.cpp \
 #    step/lvox_stepimportcomputedgrids.cpp \
 #    step/lvox_stepimportmergedgrids.cpp \
     step/lvox_stepexportmergedgrids.cpp \
@@ -121,17 +162,23 @@ SOURCES += \
     urfm/step/lvox2_stepcomputeheightprofile.cpp \
     urfm/step/lvox2_stepfiltergridbyradius.cpp \
     urfm/step/lvox2_steppreparepointcloud.cpp \
+    urfm/tools/lvox2_pointflagger.cpp \
     tools/lvox_countwithlengththresholdvisitor.cpp \
-    tools/lvox_computebeforewithlengththresholdthread.cpp \
     step/lvox_stepcomputeocclusionspace.cpp \
     mk/step/lvox3_stepcomputelvoxgrids.cpp \
     mk/tools/worker/lvox3_computehits.cpp \
     mk/tools/worker/lvox3_worker.cpp \
     mk/tools/worker/lvox3_computetheoriticals.cpp \
     mk/tools/worker/lvox3_computebefore.cpp \
+    mk/tools/worker/lvox3_computeocclusionspace.cpp \
     mk/tools/worker/lvox3_computedensity.cpp \
     mk/tools/lvox3_computelvoxgridspreparator.cpp \
+    mk/tools/lvox3_gridcache.cpp \
+    mk/tools/lvox3_columnfilter.cpp \
+    mk/tools/worker/lvox3_computetiledgrids.cpp \
     mk/tools/worker/lvox3_computeall.cpp \
+    mk/tools/worker/lvox3_workersreport.cpp \
+    mk/tools/lvox3_pointstaging.cpp \
     mk/tools/lvox3_rayboxintersectionmath.cpp \
     mk/view/loadfileconfiguration.cpp \
     mk/step/lvox3_steploadfiles.cpp \
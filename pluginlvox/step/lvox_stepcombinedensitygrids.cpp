@@ -12,6 +12,8 @@
 
 // Inclusion of used ItemDrawable classes
 #include "ct_itemdrawable/ct_grid3d.h"
+#include "tools/lvox_gridcombiner.h"
+#include "tools/lvox_gridcombinerstate.h"
 #include "qdebug.h"
 
 // Alias for indexing in models
@@ -46,6 +48,8 @@ LVOX_StepCombineDensityGrids::LVOX_StepCombineDensityGrids(CT_StepInitializeData
     _mode = maxNt_Nb;
     _effectiveRayThresh = 10;
     _UseOnlyNotEmptyCellsIf_maxNt_Nb_div_Nt_selected = true;
+    _saveState = false;
+    _addToState = false;
 }
 
 // Step description (tooltip of contextual menu)
@@ -169,6 +173,11 @@ void LVOX_StepCombineDensityGrids::createPostConfigurationDialog()
     } else {
         configDialog->addText(tr("sum(ni) / sum(nt - nb)"), tr("Non disponible : "), tr("grille(s) ni/nt/nb manquante(s)"));
     }
+
+    configDialog->addEmpty();
+    configDialog->addBool("", "", tr("Sauvegarder l'état de la combinaison (pour ajouter des scans plus tard)"), _saveState);
+    configDialog->addBool("", "", tr("Ajouter les scans à l'état sauvegardé (les grilles en entrée sont les nouveaux scans)"), _addToState);
+    configDialog->addFileChoice(tr("Dossier de l'état"), CT_FileChoiceButton::OneExistingFolder, "", _stateFolder);
 }
 
 void LVOX_StepCombineDensityGrids::compute()
@@ -190,6 +199,7 @@ void LVOX_StepCombineDensityGrids::compute()
     if (_mode == maxNt_Nb_div_Nt && (!use_nt || !use_nb)) {qDebug() << "Configuration non prévue !"; return;}
     if (_mode == maxNi && !use_ni) {qDebug() << "Configuration non prévue !"; return;}
     if (_mode == sumNiSumNtNb && (!use_nt || !use_nb || !use_ni)) {qDebug() << "Configuration non prévue !"; return;}
+    if (use_deltaT && !use_nt) {qDebug() << "Configuration non prévue !"; return;}
 
     double xmin, ymin, zmin, res, NAd;
     size_t xdim, ydim, zdim;
@@ -271,6 +281,22 @@ void LVOX_StepCombineDensityGrids::compute()
 
     if (InGrids_density.size() <=0) {qDebug() << "Aucune Grille !"; return;}
 
+    // State of a previous combination, the input grids are added to it
+    const bool useState = _saveState || _addToState;
+    if (useState && _stateFolder.isEmpty()) {qDebug() << "Dossier de l'état non défini !"; return;}
+
+    LVOX_GridCombinerState state;
+    if (_addToState)
+    {
+        if (!state.load(_stateFolder.first())) {qDebug() << "Aucun état de combinaison valide dans le dossier !"; return;}
+
+        if (!state.isCompatible(_mode, _UseOnlyNotEmptyCellsIf_maxNt_Nb_div_Nt_selected, use_ni, use_nt, use_nb, use_deltaT, InGrids_density.first()))
+        {
+            qDebug() << "L'état sauvegardé n'a pas été créé avec les mêmes paramètres et grilles !";
+            return;
+        }
+    }
+
     // Create combined out grids, considering optional input grids
     QList<CT_ResultGroup*> outResultList = getOutResultList();
     CT_ResultGroup* resultOut_grids = outResultList.at(0);
@@ -314,162 +340,26 @@ void LVOX_StepCombineDensityGrids::compute()
     resultOut_grids->addGroup(groupOut_grids);
 
 
-    const CT_Grid3D<float>* in_d = NULL;
-    const CT_Grid3D<int>* in_ni = NULL;
-    const CT_Grid3D<int>* in_nt = NULL;
-    const CT_Grid3D<int>* in_nb = NULL;
-    const CT_Grid3D<float>* in_deltaT = NULL;
-
-    // Compute combined grids values
-    // Init with first grids
-    in_d = InGrids_density.at(0);
-    if (use_ni) {in_ni = InGrids_hits.at(0);}
-    if (use_nt) {in_nt = InGrids_theoretical.at(0);}
-    if (use_nb) {in_nb = InGrids_before.at(0);}
-    if (use_deltaT) {in_deltaT = InGrids_deltaT.at(0);}
-
-    for (size_t xx = 0 ; xx < xdim ; xx++)
-    {
-        for (size_t yy = 0 ; yy < ydim ; yy++)
-        {
-            for (size_t zz = 0 ; zz < zdim ; zz++)
-            {
-                size_t index;
-                in_d->index(xx, yy, zz, index);
-                itemOut_density->setValueAtIndex(index, in_d->valueAtIndex(index));
-                if (use_ni) {itemOut_hits->setValueAtIndex(index, in_ni->valueAtIndex(index));}
-                if (use_nt) {itemOut_theoretical->setValueAtIndex(index, in_nt->valueAtIndex(index));}
-                if (use_nb) {itemOut_before->setValueAtIndex(index, in_nb->valueAtIndex(index));}
-                if (use_deltaT) {itemOut_deltaT->setValueAtIndex(index, in_deltaT->valueAtIndex(index)*(float)in_nt->valueAtIndex(index));}
-                itemOut_scanId->setValueAtIndex(index, 0);
-            }
-        }
-    }
-
-    // Compare with others grids
-    for (int i = 1 ; i < InGrids_density.size() ; i++)
-    {
-
-        in_d = InGrids_density.at(i);
-        if (use_ni) {in_ni = InGrids_hits.at(i);}
-        if (use_nt) {in_nt = InGrids_theoretical.at(i);}
-        if (use_nb) {in_nb = InGrids_before.at(i);}
-        if (use_deltaT) {in_deltaT = InGrids_deltaT.at(i);}
-
-        for (size_t xx = 0 ; xx < xdim ; xx++)
-        {
-            for (size_t yy = 0 ; yy < ydim ; yy++)
-            {
-                for (size_t zz = 0 ; zz < zdim ; zz++)
-                {
-                    size_t index;
-                    in_d->index(xx, yy, zz, index);
-                    bool replace = false;
-
-                    if (_mode == maxDensity) {
-                        replace = (in_d->valueAtIndex(index) > itemOut_density->valueAtIndex(index));
-                    } else if (_mode == maxNt_Nb) {
-                        replace = ((in_nt->valueAtIndex(index) - in_nb->valueAtIndex(index)) > (itemOut_theoretical->valueAtIndex(index) - itemOut_before->valueAtIndex(index)));
-                    } else if (_mode == maxNt_Nb_div_Nt) {
-                        float inVal = 0;
-                        float outVal = 0;
-
-                        if (in_nt->valueAtIndex(index) > 0) {inVal = (float)(in_nt->valueAtIndex(index) - in_nb->valueAtIndex(index))/(float)in_nt->valueAtIndex(index);}
-                        if (itemOut_theoretical->valueAtIndex(index) > 0) {outVal = (float)(itemOut_theoretical->valueAtIndex(index) - itemOut_before->valueAtIndex(index))/(float)itemOut_theoretical->valueAtIndex(index);}
-
-                        replace = (inVal > outVal);
-
-                        if (_UseOnlyNotEmptyCellsIf_maxNt_Nb_div_Nt_selected && (in_d->valueAtIndex(index) <= 0)) {replace = false;}
-
-                    } else if (_mode == maxNi) {
-                        replace = (in_ni->valueAtIndex(index) > itemOut_hits->valueAtIndex(index));
-                    } else if (_mode == sumNiSumNtNb) {
-                        replace = false;
-
-                        itemOut_hits->addValueAtIndex(index, in_ni->valueAtIndex(index));
-                        itemOut_theoretical->addValueAtIndex(index, in_nt->valueAtIndex(index));
-                        itemOut_before->addValueAtIndex(index, in_nb->valueAtIndex(index));
-                        itemOut_deltaT->addValueAtIndex(index, in_deltaT->valueAtIndex(index)*(float)in_nt->valueAtIndex(index));
-
-                        if (i == (InGrids_density.size() - 1))
-                        {
-                            int ni = itemOut_hits->valueAtIndex(index);
-                            int nt = itemOut_theoretical->valueAtIndex(index);
-                            int nb = itemOut_before->valueAtIndex(index);
-
-                            int ntMnb = nt - nb;
-
-                            // Avoid division by 0
-                            if (ntMnb == 0 )
-                            {
-                                itemOut_density->setValueAtIndex(index, -1);
-                                itemOut_deltaT->setValueAtIndex(index, -1);
-                            }
-                            // If there is an error (nb > nt)
-                            else if (ntMnb < 0 )
-                            {
-                                itemOut_density->setValueAtIndex(index, -2);
-                                itemOut_deltaT->setValueAtIndex(index, -2);
-                            }
-                            // If there is not enough information
-                            else if (ntMnb < _effectiveRayThresh )
-                            {
-                                itemOut_density->setValueAtIndex(index, -3);
-                                itemOut_deltaT->setValueAtIndex(index, -3);
-                            }
-                            // Normal case
-                            else
-                            {
-                                float density = (float) ni / ((float) ntMnb);
-                                itemOut_density->setValueAtIndex(index, density);
-                            }
-
-                            if (ni > (nt - nb))
-                            {
-                                itemOut_density->setValueAtIndex(i, 1);
-                            }
-
-                        }
-                    }
-
-                    if (replace)
-                    {
-                        itemOut_density->setValueAtIndex(index, in_d->valueAtIndex(index));
-                        if (use_ni) {itemOut_hits->setValueAtIndex(index, in_ni->valueAtIndex(index));}
-                        if (use_nt) {itemOut_theoretical->setValueAtIndex(index, in_nt->valueAtIndex(index));}
-                        if (use_nb) {itemOut_before->setValueAtIndex(index, in_nb->valueAtIndex(index));}
-                        if (use_deltaT) {itemOut_deltaT->setValueAtIndex(index, in_deltaT->valueAtIndex(index) * (float)in_nt->valueAtIndex(index));}
-                        itemOut_scanId->setValueAtIndex(index, i);
-
-                    }
-                }
-            }
-        }
+    // Compute combined grids values : all scans are read at once for each voxel
+    LVOX_GridCombiner::Inputs inputs;
+    inputs.hits = InGrids_hits;
+    inputs.theoretical = InGrids_theoretical;
+    inputs.before = InGrids_before;
+    inputs.density = InGrids_density;
+    inputs.deltaT = InGrids_deltaT;
 
-    }
+    LVOX_GridCombiner::Outputs outputs;
+    outputs.hits = itemOut_hits;
+    outputs.theoretical = itemOut_theoretical;
+    outputs.before = itemOut_before;
+    outputs.density = itemOut_density;
+    outputs.deltaT = itemOut_deltaT;
+    outputs.scanId = itemOut_scanId;
 
-    if (use_deltaT)
-    {
-        for (size_t xx = 0 ; xx < xdim ; xx++)
-        {
-            for (size_t yy = 0 ; yy < ydim ; yy++)
-            {
-                for (size_t zz = 0 ; zz < zdim ; zz++)
-                {
-                    size_t index;
-                    itemOut_deltaT->index(xx, yy, zz, index);
-                    itemOut_deltaT->setValueAtIndex(index, itemOut_deltaT->valueAtIndex(index) / (float)itemOut_theoretical->valueAtIndex(index));
-                }
-            }
-        }
-    }
+    LVOX_GridCombiner combiner((LVOX_GridCombiner::Mode)_mode, _effectiveRayThresh, _UseOnlyNotEmptyCellsIf_maxNt_Nb_div_Nt_selected);
 
+    if (!combiner.combine(inputs, outputs, useState ? &state : NULL)) {qDebug() << "Configuration non prévue !"; return;}
 
-    if (itemOut_hits!=NULL) {itemOut_hits->computeMinMax();}
-    if (itemOut_theoretical!=NULL) {itemOut_theoretical->computeMinMax();}
-    if (itemOut_before!=NULL) {itemOut_before->computeMinMax();}
-    if (itemOut_density!=NULL) {itemOut_density->computeMinMax();}
-    if (itemOut_deltaT!=NULL) {itemOut_deltaT->computeMinMax();}
-    if (itemOut_scanId!=NULL) {itemOut_scanId->computeMinMax();}
+    if (useState && !state.save(_stateFolder.first())) {qDebug() << "Impossible de sauvegarder l'état de la combinaison !";}
 
 }
@@ -14,6 +14,8 @@
  * - max (ni)
  *
  * \param _mode Choosen mode for combination
+ * \param _saveState Save the accumulated values of the combination in _stateFolder
+ * \param _addToState Input grids are new scans added to the combination saved in _stateFolder
  *
  * <b>Input Models:</b>
  *
@@ -103,6 +105,9 @@ private:
     int    _mode;
     int    _effectiveRayThresh;
     bool   _UseOnlyNotEmptyCellsIf_maxNt_Nb_div_Nt_selected;
+    bool   _saveState;
+    bool   _addToState;
+    QStringList _stateFolder;
 
 };
 
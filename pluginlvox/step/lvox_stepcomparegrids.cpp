@@ -5,6 +5,9 @@
 #include "ct_result/ct_resultgroup.h"
 #include "ct_result/model/inModel/ct_inresultmodelgrouptocopy.h"
 #include "ct_result/model/outModel/tools/ct_outresultmodelgrouptocopypossibilities.h"
+#include "ct_view/ct_stepconfigurabledialog.h"
+
+#include "tools/lvox_gridkernels.h"
 
 // Alias for indexing models
 #define DEF_in_res "result"
@@ -17,6 +20,7 @@
 // Constructor : initialization of parameters
 LVOX_StepCompareGrids::LVOX_StepCompareGrids(CT_StepInitializeData &dataInit) : CT_AbstractStep(dataInit)
 {
+    _computeDifference = false;
 }
 
 // Step description (tooltip of contextual menu)
@@ -71,13 +75,18 @@ void LVOX_StepCompareGrids::createOutResultModelListProtected()
     if (out_res != NULL)
     {
         out_res->addItemModel(DEF_in_grp, _nbnt_ModelName, new CT_Grid3D<float>(), tr("nb/nt"));
+
+        if (_computeDifference)
+            out_res->addItemModel(DEF_in_grp, _diff_ModelName, new CT_Grid3D<float>(), tr("nb - nt"));
     }
 }
 
 // Semi-automatic creation of step parameters DialogBox
 void LVOX_StepCompareGrids::createPostConfigurationDialog()
 {
-    // No parameter dialog for this step
+    CT_StepConfigurableDialog *configDialog = newStandardPostConfigurationDialog();
+
+    configDialog->addBool("", "", tr("Créer la grille nb - nt"), _computeDifference);
 }
 
 void LVOX_StepCompareGrids::compute()
@@ -99,14 +108,32 @@ void LVOX_StepCompareGrids::compute()
             nb->xdim(), nb->ydim(), nb->zdim(),
             nb->resolution(), nb->NA(), nb->NA());
 
-        size_t n = nbnt->nCells();
-        for(size_t i = 0; i < n; i++)
+        // voxels with nt = 0 stay NA (avoid division by zero)
+        LVOX_GridKernels::ratio(nb, nt, nbnt);
+
+        const LVOX_GridKernels::CompareStats stats = LVOX_GridKernels::compare(nb, nt, 0);
+        QString diffRange;
+
+        if (_computeDifference)
         {
-            if(nt->valueAtIndex(i)) // avoid division by zero
-            {
-                nbnt->setValueAtIndex(i, static_cast<float>(nb->valueAtIndex(i))/nt->valueAtIndex(i));
-            }
+            CT_Grid3D<float>* diff = new CT_Grid3D<float>(_diff_ModelName.completeName(), out_res,
+                nb->minX(), nb->minY(), nb->minZ(),
+                nb->xdim(), nb->ydim(), nb->zdim(),
+                nb->resolution(), nb->NA(), nb->NA());
+
+            // voxels where nb or nt is NA are NA
+            const LVOX_GridKernels::MinMax<float> diffMinMax = LVOX_GridKernels::difference(nb, nt, diff);
+
+            if (diffMinMax.isValid())
+                diffRange = tr(", nb - nt in [%1;%2]").arg(diffMinMax.min).arg(diffMinMax.max);
+
+            out_group->addItemDrawable(diff);
+            diff->computeMinMax();
         }
+
+        PS_LOG->addInfoMessage(LogInterface::step, tr("nb = nt : %1 voxel(s), nb > nt : %2 voxel(s), nb < nt : %3 voxel(s), NA : %4 voxel(s)%5")
+                               .arg(stats.nEqual).arg(stats.nGreater).arg(stats.nLess).arg(stats.nMasked).arg(diffRange));
+
         out_group->addItemDrawable(nbnt);
         nbnt->computeMinMax();
     }
@@ -7,9 +7,10 @@
 /*!
  * \class LVOX_StepCompareGrids
  * \ingroup Steps_LVOX
- * \brief <b>No short description for this step.</b>
+ * \brief <b>Compare two grids voxel by voxel.</b>
  *
- * No detailled description for this step
+ * Outputs the nb/nt grid and optionally the nb - nt grid, and logs the number of voxels where
+ * nb is equal, greater or less than nt.
  *
  *
  */
@@ -81,8 +82,10 @@ protected:
 private:
 
     // Step parameters
-    // No parameter for this step
+    bool _computeDifference;    /*!< output the nb - nt grid */
+
     CT_AutoRenameModels _nbnt_ModelName;
+    CT_AutoRenameModels _diff_ModelName;
 };
 
 #endif // LVOX_STEPCOMPAREGRIDS_H
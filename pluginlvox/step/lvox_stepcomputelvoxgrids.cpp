@@ -53,6 +53,7 @@
 #include "tools/lvox_computetheoriticalsthread.h"
 #include "tools/lvox_computebeforethread.h"
 #include "tools/lvox_computedensitythread.h"
+#include "tools/lvox_threadscheduler.h"
 
 #include <QFileInfo>
 #include <QDebug>
@@ -219,8 +220,8 @@ void LVOX_StepComputeLvoxGrids::compute()
     // Gets the out result
     CT_ResultGroup* outResult = getOutResultList().first();
 
-    QList<CT_MonitoredQThread*> baseThreads;
-    QList<CT_MonitoredQThread*> densityThreads;
+    // at most one thread per core, the density of a scan is computed as soon as its three grids are computed
+    LVOX_ThreadScheduler scheduler;
 
     QMap<CT_AbstractItemGroup*, QPair<const CT_Scene*, const CT_Scanner*> > pointsOfView;
 
@@ -480,62 +481,42 @@ void LVOX_StepComputeLvoxGrids::compute()
         LVOX_ComputeHitsThread* hitsThread = new LVOX_ComputeHitsThread(scanner, hitGrid, deltaInGrid, deltaOutGrid, scene, _computeDistances);
         connect(hitsThread, SIGNAL(progressChanged()), this, SLOT(updateProgress()));
         _threadList.append(hitsThread);
-        baseThreads.append(hitsThread);
+        scheduler.addThread(hitsThread);
 
         LVOX_ComputeTheoriticalsThread* theoreticalThread = new LVOX_ComputeTheoriticalsThread(scanner, theoriticalGrid, deltaTheoritical, _computeDistances);
         connect(theoreticalThread, SIGNAL(progressChanged()), this, SLOT(updateProgress()));
         _threadList.append(theoreticalThread);
-        baseThreads.append(theoreticalThread);
+        scheduler.addThread(theoreticalThread);
 
         LVOX_ComputeBeforeThread* beforeThread = new LVOX_ComputeBeforeThread(scanner, beforeGrid, deltaBefore, scene, _computeDistances);
         connect(beforeThread, SIGNAL(progressChanged()), this, SLOT(updateProgress()));
         _threadList.append(beforeThread);
-        baseThreads.append(beforeThread);
+        scheduler.addThread(beforeThread);
 
         LVOX_ComputeDensityThread* densityThread = new LVOX_ComputeDensityThread(densityGrid, hitGrid, theoriticalGrid, beforeGrid, _effectiveRayThresh);
         connect(densityThread, SIGNAL(progressChanged()), this, SLOT(updateProgress()));
         _threadList.append(densityThread);
-        densityThreads.append(densityThread);
+        scheduler.addThread(densityThread, QList<CT_MonitoredQThread*>() << hitsThread << theoreticalThread << beforeThread);
     }
 
-    int size = baseThreads.size();
+    connect(this, SIGNAL(stopped()), &scheduler, SLOT(cancel()), Qt::DirectConnection);
 
-    for (int i = 0 ; i < size ; ++i)
-    {
-        baseThreads.at(i)->start();
-    }
+    scheduler.run();
 
-    for (int i = 0 ; i < size ; ++i)
+    if (!_threadList.isEmpty())
     {
-        baseThreads.at(i)->wait();
         updateProgress();
     }
 
-    for (int i = 0 ; i < size ; ++i)
-    {
-        disconnect(baseThreads.at(i), SIGNAL(progressChanged()), this, SLOT(updateProgress()));
-    }
-
-    size = densityThreads.size();
-
-    for (int i = 0 ; i < size ; ++i)
-    {
-        densityThreads.at(i)->start();
-
-    }
-
-    for (int i = 0 ; i < size ; ++i)
-    {
-        densityThreads.at(i)->wait();
-        updateProgress();
-    }
+    int size = _threadList.size();
 
     for (int i = 0 ; i < size ; ++i)
     {
-        disconnect(densityThreads.at(i), SIGNAL(progressChanged()), this, SLOT(updateProgress()));
+        disconnect(_threadList.at(i), SIGNAL(progressChanged()), this, SLOT(updateProgress()));
     }
 
     qDeleteAll(_threadList);
+    _threadList.clear();
 
     setProgress(100);
 
@@ -41,7 +41,9 @@
 #include "ct_step/abstract/ct_abstractsteploadfile.h"
 #include "ct_view/ct_stepconfigurabledialog.h"
 
-#include "tools/lvox_computebeforewithlengththresholdthread.h"
+#include "mk/tools/worker/lvox3_computeall.h"
+#include "mk/tools/worker/lvox3_computeocclusionspace.h"
+#include "tools/lvox_gridbounds.h"
 
 #include <QFileInfo>
 #include <QDebug>
@@ -144,8 +146,6 @@ void LVOX_StepComputeOcclusionsSpace::compute()
     // Gets the out result
     CT_ResultGroup* outResult = getOutResultList().first();
 
-    QList<CT_MonitoredQThread*> baseThreads;
-
     QMap<CT_AbstractItemGroup*, QPair<const CT_Scene*, const CT_Scanner*> > pointsOfView;
 
     // Global limits of generated grids
@@ -225,25 +225,14 @@ void LVOX_StepComputeOcclusionsSpace::compute()
         double yMaxAdjusted = std::max(yMaxScene, yMaxScanner);
         double zMaxAdjusted = std::max(zMaxScene, zMaxScanner);
 
-        xMin = _xBase;
-        yMin = _yBase;
-        zMin = _zBase;
-
-        while (xMin < xMinAdjusted) {xMin += _res;}
-        while (yMin < yMinAdjusted) {yMin += _res;}
-        while (zMin < zMinAdjusted) {zMin += _res;}
-
-        while (xMin > xMinAdjusted) {xMin -= _res;}
-        while (yMin > yMinAdjusted) {yMin -= _res;}
-        while (zMin > zMinAdjusted) {zMin -= _res;}
+        // bounds aligned on (_xBase, _yBase, _zBase) with a step of _res
+        xMin = LVOX_GridBounds::snapDown(_xBase, xMinAdjusted, _res);
+        yMin = LVOX_GridBounds::snapDown(_yBase, yMinAdjusted, _res);
+        zMin = LVOX_GridBounds::snapDown(_zBase, zMinAdjusted, _res);
 
-        xMax = xMin + _res;
-        yMax = yMin + _res;
-        zMax = zMin + _res;
-
-        while (xMax < xMaxAdjusted) {xMax += _res;}
-        while (yMax < yMaxAdjusted) {yMax += _res;}
-        while (zMax < zMaxAdjusted) {zMax += _res;}
+        xMax = LVOX_GridBounds::snapUpAbove(xMin, xMaxAdjusted, _res);
+        yMax = LVOX_GridBounds::snapUpAbove(yMin, yMaxAdjusted, _res);
+        zMax = LVOX_GridBounds::snapUpAbove(zMin, zMaxAdjusted, _res);
 
     } else if (_gridMode == 2) {
 
@@ -257,13 +246,13 @@ void LVOX_StepComputeOcclusionsSpace::compute()
 
         bool enlarged = false;
 
-        while (xMin > xMinScanner) {xMin -= _res; enlarged = true;}
-        while (yMin > yMinScanner) {yMin -= _res; enlarged = true;}
-        while (zMin > zMinScanner) {zMin -= _res; enlarged = true;}
+        enlarged |= LVOX_GridBounds::extendMinTo(xMin, xMinScanner, _res);
+        enlarged |= LVOX_GridBounds::extendMinTo(yMin, yMinScanner, _res);
+        enlarged |= LVOX_GridBounds::extendMinTo(zMin, zMinScanner, _res);
 
-        while (xMax < xMaxScanner) {xMax += _res; enlarged = true;}
-        while (yMax < yMaxScanner) {yMax += _res; enlarged = true;}
-        while (zMax < zMaxScanner) {zMax += _res; enlarged = true;}
+        enlarged |= LVOX_GridBounds::extendMaxTo(xMax, xMaxScanner, _res);
+        enlarged |= LVOX_GridBounds::extendMaxTo(yMax, yMaxScanner, _res);
+        enlarged |= LVOX_GridBounds::extendMaxTo(zMax, zMaxScanner, _res);
 
         if (enlarged)
         {
@@ -281,13 +270,13 @@ void LVOX_StepComputeOcclusionsSpace::compute()
 
         bool enlarged = false;
 
-        while (xMin > xMinScanner) {xMin -= _res; enlarged = true;}
-        while (yMin > yMinScanner) {yMin -= _res; enlarged = true;}
-        while (zMin > zMinScanner) {zMin -= _res; enlarged = true;}
+        enlarged |= LVOX_GridBounds::extendMinTo(xMin, xMinScanner, _res);
+        enlarged |= LVOX_GridBounds::extendMinTo(yMin, yMinScanner, _res);
+        enlarged |= LVOX_GridBounds::extendMinTo(zMin, zMinScanner, _res);
 
-        while (xMax < xMaxScanner) {xMax += _res; enlarged = true;}
-        while (yMax < yMaxScanner) {yMax += _res; enlarged = true;}
-        while (zMax < zMaxScanner) {zMax += _res; enlarged = true;}
+        enlarged |= LVOX_GridBounds::extendMaxTo(xMax, xMaxScanner, _res);
+        enlarged |= LVOX_GridBounds::extendMaxTo(yMax, yMaxScanner, _res);
+        enlarged |= LVOX_GridBounds::extendMaxTo(zMax, zMaxScanner, _res);
 
         if (enlarged)
         {
@@ -302,6 +291,8 @@ void LVOX_StepComputeOcclusionsSpace::compute()
     yMax += _res;
     zMax += _res;
 
+    LVOX3_ComputeAll workersManager;
+
     QMapIterator<CT_AbstractItemGroup*, QPair<const CT_Scene*, const CT_Scanner*> > it(pointsOfView);
     while (it.hasNext() && !isStopped())
     {
@@ -315,46 +306,19 @@ void LVOX_StepComputeOcclusionsSpace::compute()
 
         group->addItemDrawable(occlGrid);
 
-        LVOX_ComputeBeforeWithLengthThresholdThread* occlThread = new LVOX_ComputeBeforeWithLengthThresholdThread(scanner, occlGrid, scene, _distThreshold);
-        connect(occlThread, SIGNAL(progressChanged()), this, SLOT(updateProgress()));
-        _threadList.append(occlThread);
-        baseThreads.append(occlThread);
-    }
-
-    int size = baseThreads.size();
-
-    for (int i = 0 ; i < size ; ++i)
-    {
-        baseThreads.at(i)->start();
-    }
-
-    for (int i = 0 ; i < size ; ++i)
-    {
-        baseThreads.at(i)->wait();
-        updateProgress();
+        // scans are computed in parallel and the points of a scan are cut between threads by the worker
+        workersManager.addWorker(0, new LVOX3_ComputeOcclusionSpace(scanner->getShootingPattern(), scene->getPointCloudIndex(), occlGrid, _distThreshold));
     }
 
-    for (int i = 0 ; i < size ; ++i)
-    {
-        disconnect(baseThreads.at(i), SIGNAL(progressChanged()), this, SLOT(updateProgress()));
-    }
+    connect(&workersManager, SIGNAL(progressChanged(int)), this, SLOT(progressChanged(int)), Qt::DirectConnection);
+    connect(this, SIGNAL(stopped()), &workersManager, SLOT(cancel()), Qt::DirectConnection);
 
-    qDeleteAll(_threadList);
+    workersManager.compute();
 
     setProgress(100);
 }
 
-void LVOX_StepComputeOcclusionsSpace::updateProgress()
+void LVOX_StepComputeOcclusionsSpace::progressChanged(int p)
 {
-    int progress = 0;
-
-    int size = _threadList.size();
-    for (int i = 0 ; i < size ; ++i)
-    {
-        progress += _threadList.at(i)->getProgress();
-    }
-
-    progress /= size;
-    setProgress(progress);
+    setProgress(p);
 }
-
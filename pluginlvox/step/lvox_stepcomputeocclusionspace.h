@@ -33,7 +33,6 @@
 
 // Inclusion of auto-indexation system
 #include "ct_tools/model/ct_autorenamemodels.h"
-#include "ct_tools/ct_monitoredqthread.h"
 
 
 class LVOX_StepComputeOcclusionsSpace : public CT_AbstractStep
@@ -108,16 +107,14 @@ protected:
     */
     virtual void compute();
 
-public slots:
-    void updateProgress();
+private slots:
+    void progressChanged(int p);
 
 private:
 
     // Declaration of autoRenames Variables (groups or items addes to In models copies)
     CT_AutoRenameModels _occl_ModelName;
 
-    QList<CT_MonitoredQThread*>     _threadList;
-
 //********************************************//
 //              Attributes of LVox            //
 //********************************************//
@@ -12,6 +12,8 @@
 
 // Inclusion of used ItemDrawable classes
 #include "ct_itemdrawable/ct_grid3d.h"
+#include "tools/lvox_math.h"
+#include "tools/lvox_parallelfor.h"
 #include "qdebug.h"
 
 // Alias for indexing in models
@@ -26,6 +28,8 @@
 #define DEF_itemOut_PAD "PAD"
 
 #include <math.h>
+#include <limits>
+#include <cstring>
 
 // Constructor : initialization of parameters
 LVOX_StepComputePAD::LVOX_StepComputePAD(CT_StepInitializeData &dataInit) : CT_AbstractStep(dataInit)
@@ -88,6 +92,9 @@ void LVOX_StepComputePAD::compute()
     QList<CT_ResultGroup*> outResultList = getOutResultList();
     CT_ResultGroup* resultOut_grids = outResultList.at(0);
 
+    // Greatest float that is not above the limit : (pad > limit) <=> (pad > PADlimit) with pad in float
+    float PADlimit = (float)_PADlimit;
+    if ((double)PADlimit > _PADlimit) {PADlimit = std::nextafter(PADlimit, -std::numeric_limits<float>::infinity());}
 
     CT_ResultGroupIterator itGrp(resultIn_grids, this, DEF_groupIn_grids);
     while (itGrp.hasNext() && !isStopped())
@@ -116,65 +123,147 @@ void LVOX_StepComputePAD::compute()
                                                                  res, NAd, NAd);
             groupOut_grids->addItemDrawable(itemOut_PAD);
 
-            for (size_t xx = 0 ; xx < xdim ; xx++)
-            {
-                for (size_t yy = 0 ; yy < ydim ; yy++)
-                {
-                    for (size_t zz = 0 ; zz < zdim ; zz++)
-                    {
-                        size_t index;
-                        itemIn_density->index(xx, yy, zz, index);
-                        float density = itemIn_density->valueAtIndex(index);
-                        float deltaT = itemIn_deltaT->valueAtIndex(index);
-                        float result = LVOX_StepComputePAD::computePAD(density, res, deltaT, 0.5);
-
-                        // Real max operations
-                        if (result==std::numeric_limits<float>::infinity()){
-                            if(_EraseInfinity){
-                                _InfinityIndexStack.push(index); // Save the voxel index in case of infinity
-                            }
-                        }
-                        else if(realMax<result){realMax=result;} // Or compute the maximum finite result in order to replace the non finite ones
-
-                        // Value assignement
-                        if (result>_PADlimit){
-                            itemOut_PAD->setValueAtIndex(index,0);
-                        }
-                        else
-                            itemOut_PAD->setValueAtIndex(index,result);
-                }
-              }
-           }
+            // PAD of all voxels in memory order, infinite values are kept (if they must be erased) until the max is known
+            const bool eraseInfinity = _EraseInfinity;
+            PADStats stats = LVOX_ParallelFor::reduce(0, itemOut_PAD->nCells(), PADStats(),
+                                                      [itemIn_density, itemIn_deltaT, itemOut_PAD, PADlimit, eraseInfinity](size_t begin, size_t end) {
+                return computePADBlock(itemIn_density, itemIn_deltaT, itemOut_PAD, PADlimit, eraseInfinity, begin, end);
+            }, &PADStats::merge);
 
-            itemOut_PAD->computeMinMax();
-           //PS_LOG->addWarningMessage(LogInterface::reader, "Extremum PAD [" + QString::number(itemOut_PAD->dataMin()) + ";" + QString::number(itemOut_PAD->dataMax()) +"] ");
+            // Compute the maximum finite result in order to replace the non finite ones
+            if (stats.max > realMax) {realMax = stats.max;}
+
+            if(_EraseInfinity && (stats.nInfinite > 0)){
+                const float infinity = std::numeric_limits<float>::infinity();
+                const float replacement = realMax;
 
-            if(_EraseInfinity){
-                while (!_InfinityIndexStack.isEmpty())
-                itemOut_PAD->setValueAtIndex(_InfinityIndexStack.pop(), realMax);
+                LVOX_ParallelFor::run(0, itemOut_PAD->nCells(), [itemOut_PAD, infinity, replacement](size_t begin, size_t end) {
+                    for (size_t index = begin ; index < end ; ++index)
+                    {
+                        if (itemOut_PAD->valueAtIndex(index) == infinity) {itemOut_PAD->setValueAtIndex(index, replacement);}
+                    }
+                });
             }
 
             itemOut_PAD->computeMinMax();
-            //PS_LOG->addWarningMessage(LogInterface::reader, "Extremum PAD [" + QString::number(itemOut_PAD->dataMin()) + ";" + QString::number(itemOut_PAD->dataMax()) +"] ");
 
+            if (stats.nZeroDistance > 0) {PS_LOG->addMessage(LogInterface::warning, LogInterface::step, tr("Distance Nt moyenne = 0 pour %1 voxel(s) [PAD infini !!] ").arg(stats.nZeroDistance));}
+            if (stats.nInfinite > 0) {PS_LOG->addInfoMessage(LogInterface::step, tr("%1 voxel(s) avec un PAD infini").arg(stats.nInfinite));}
         }
     }
 
 }
 
-float LVOX_StepComputePAD::computePAD(float density, float res, float D_Nt_mean, float gFunction)
+LVOX_StepComputePAD::PADStats LVOX_StepComputePAD::PADStats::merge(const PADStats& a, const PADStats& b)
 {
-    if (density <= 0) {
-        //PS_LOG->addWarningMessage(LogInterface::reader, tr("Densité <= 0  [Valeur impossible !!] "));
-        return density;
-    }
-    else if (density >= 1) {
-        //PS_LOG->addWarningMessage(LogInterface::reader, tr("Densité = 1 [PAD infini !!] "));
+    PADStats stats;
+    stats.max = qMax(a.max, b.max);
+    stats.nInfinite = a.nInfinite + b.nInfinite;
+    stats.nZeroDistance = a.nZeroDistance + b.nZeroDistance;
+    return stats;
+}
+
+inline float LVOX_StepComputePAD::logTerm(float density)
+{
+    // -log(1-density) with log1p so 1-density is not rounded. The density is clamped to ]0;1[
+    // and not tested so the log is computed without branch, other densities are managed by padValue.
+    return -LVOX_Math::log1p(-qMin(qMax(density, 0.0f), 0.99999994f));
+}
+
+inline float LVOX_StepComputePAD::padValue(float density, float D_Nt_mean, float logValue)
+{
+    const bool valid = (density > 0) & (density < 1);
+
+    // density = 1 : -log(0) = infinity, density > 1 : log of a negative value
+    const float numerator = valid ? logValue : ((density == 1) ? std::numeric_limits<float>::infinity() : std::numeric_limits<float>::quiet_NaN());
+    const float pad = numerator/(D_Nt_mean*0.5f);
+
+    return (density <= 0) ? density : pad;
+}
+
+LVOX_StepComputePAD::PADStats LVOX_StepComputePAD::computePADBlock(const CT_Grid3D<float>* density,
+                                                                   const CT_Grid3D<float>* deltaT,
+                                                                   CT_Grid3D<float>* pad,
+                                                                   float PADlimit,
+                                                                   bool eraseInfinity,
+                                                                   size_t begin,
+                                                                   size_t end)
+{
+    const float infinity = std::numeric_limits<float>::infinity();
+    const size_t chunkSize = 256;
+
+    float d[chunkSize];
+    float dt[chunkSize];
+    float result[chunkSize];
+    float out[chunkSize];
+
+    PADStats stats;
+
+    // values are copied in small arrays so the loops that compute the PAD have no branch and can be vectorized
+    // (conditions are combined with & and not && to not introduce branches)
+    for (size_t chunkBegin = begin ; chunkBegin < end ; chunkBegin += chunkSize)
+    {
+        const size_t n = qMin(chunkSize, end - chunkBegin);
+
+        for (size_t i = 0 ; i < n ; ++i)
+        {
+            d[i] = density->valueAtIndex(chunkBegin + i);
+            dt[i] = deltaT->valueAtIndex(chunkBegin + i);
+        }
+
+        // the log is computed in its own loop, the compiler can not mix it with the conditions below
+        for (size_t i = 0 ; i < n ; ++i)
+            result[i] = logTerm(d[i]);
+
+        for (size_t i = 0 ; i < n ; ++i)
+        {
+            result[i] = padValue(d[i], dt[i], result[i]);
+
+            // Value assignement (infinite values are replaced later by the max if they must be erased)
+            const bool isInfinite = (result[i] == infinity);
+            const float value = (result[i] > PADlimit) ? 0 : result[i];
+            out[i] = (eraseInfinity & isInfinite) ? infinity : value;
+        }
+
+        // Summary of the chunk. The max of positive finite values is computed on the bits of the floats : positive
+        // floats have the same order than their bits read as integers and a max of integers can be vectorized
+        // (NaN are ignored)
+        quint32 nZeroDistance = 0;
+        quint32 nInfinite = 0;
+        quint32 maxBits;
+        std::memcpy(&maxBits, &stats.max, sizeof(float));
+
+        for (size_t i = 0 ; i < n ; ++i)
+        {
+            const bool isInfinite = (result[i] == infinity);
+
+            nZeroDistance += ((d[i] > 0) & (dt[i] == 0)) ? 1 : 0;
+            nInfinite += isInfinite ? 1 : 0;
+
+            quint32 resultBits;
+            std::memcpy(&resultBits, &result[i], sizeof(float));
+            resultBits &= -(quint32)(!isInfinite & (result[i] > 0));
+            maxBits = qMax(maxBits, resultBits);
+        }
+
+        for (size_t i = 0 ; i < n ; ++i)
+            pad->setValueAtIndex(chunkBegin + i, out[i]);
+
+        stats.nZeroDistance += nZeroDistance;
+        stats.nInfinite += nInfinite;
+        std::memcpy(&stats.max, &maxBits, sizeof(float));
     }
 
-    if (D_Nt_mean == 0) {PS_LOG->addWarningMessage(LogInterface::reader, tr("Distance Nt moyenne = 0 [PAD infini !!] "));}
+    return stats;
+}
 
-    return -std::log(1-density)/(D_Nt_mean*0.5);
+float LVOX_StepComputePAD::computePAD(float density, float res, float D_Nt_mean, float gFunction)
+{
+    Q_UNUSED(res);
+    Q_UNUSED(gFunction);
+
+    // Densité <= 0 : valeur impossible, densité = 1 ou distance Nt moyenne = 0 : PAD infini
+    return padValue(density, D_Nt_mean, logTerm(density));
 
 //    float deltaD_deltaH = 0.07162 * (1 - std::exp(-9.536*(res/D_Nt_mean - 1)));
 //    float deltaD = deltaD_deltaH*res;
@@ -182,4 +271,3 @@ float LVOX_StepComputePAD::computePAD(float density, float res, float D_Nt_mean,
 
 //    return (D_Nt_mean_deltaH - std::sqrt(D_Nt_mean_deltaH*D_Nt_mean_deltaH + 4*deltaD_deltaH*std::log(1-density))) / (2*deltaD*gFunction);
 }
-
@@ -29,7 +29,7 @@
 #define LVOX_STEPCOMPUTEPAD_H
 
 #include "ct_step/abstract/ct_abstractstep.h"
-#include <QStack>
+#include "ct_itemdrawable/ct_grid3d.h"
 
 /*!
  * \class LVOX_StepComputePAD
@@ -65,6 +65,10 @@ public:
      */
     CT_VirtualAbstractStep* createNewInstance(CT_StepInitializeData &dataInit);
 
+    /*! \brief PAD of one voxel
+     *
+     * Same formula than the one used by compute() for all voxels of the grid
+     */
     static float computePAD(float density, float res, float D_Nt_mean, float gFunction);
 
 protected:
@@ -96,8 +100,36 @@ private :
 
     bool    _EraseInfinity;
     double   _PADlimit;
-    QStack<size_t> _InfinityIndexStack;
 
+    /*! \brief Summary of the PAD of a part of the grid
+     */
+    struct PADStats {
+        PADStats() : max(0), nInfinite(0), nZeroDistance(0) {}
+
+        float   max;            /*! max of the finite values */
+        size_t  nInfinite;
+        size_t  nZeroDistance;  /*! voxels with density > 0 and mean distance = 0 */
+
+        static PADStats merge(const PADStats& a, const PADStats& b);
+    };
+
+    /*! \brief -log(1-density), valid for densities in ]0;1[
+     */
+    static inline float logTerm(float density);
+
+    /*! \brief PAD from the density, the mean distance and logTerm(density)
+     */
+    static inline float padValue(float density, float D_Nt_mean, float logValue);
+
+    /*! \brief Compute the PAD of voxels [begin;end[ and returns the summary of this part
+     */
+    static PADStats computePADBlock(const CT_Grid3D<float>* density,
+                                    const CT_Grid3D<float>* deltaT,
+                                    CT_Grid3D<float>* pad,
+                                    float PADlimit,
+                                    bool eraseInfinity,
+                                    size_t begin,
+                                    size_t end);
 };
 
 #endif // LVOX_STEPCOMPUTEPAD_H
@@ -9,6 +9,7 @@
 #include "ctlibio/readers/ct_reader_asciigrid3d.h"
 #include "ct_itemdrawable/ct_standarditemgroup.h"
 #include "tools/lvox_grid3dexporter.h"
+#include "tools/lvox_binarygrid3d.h"
 #include "qdir.h"
 
 // Alias for indexing models
@@ -26,6 +27,7 @@
 // Constructor : initialization of parameters
 LVOX_StepExportComputedGrids::LVOX_StepExportComputedGrids(CT_StepInitializeData &dataInit) : CT_AbstractStep(dataInit)
 {
+    _binaryFormat = false;
 }
 
 // Step description (tooltip of contextual menu)
@@ -91,6 +93,7 @@ void LVOX_StepExportComputedGrids::createPostConfigurationDialog()
     CT_StepConfigurableDialog* diag = newStandardPostConfigurationDialog();
 
     diag->addFileChoice(tr("Choisir la destination"), CT_FileChoiceButton::OneNewFile, "", _folder, "Choisissez le dossier de destination à créer", "", "");
+    diag->addBool(tr("Format binaire (LVG3D)"), "", "", _binaryFormat);
 }
 
 //template<class T>
@@ -115,6 +118,8 @@ void LVOX_StepExportComputedGrids::compute()
 {
     QDir().mkdir(_folder.first());
 
+    const QString suffix = _binaryFormat ? LVOX_BinaryGrid3DFile::suffix() : QString("GRD3D");
+
     // on récupère le modèle d'entrée à exporter
     CT_InAbstractModel* hits_mod{};
     CT_InAbstractModel* theo_mod{};
@@ -159,7 +164,7 @@ void LVOX_StepExportComputedGrids::compute()
     {
         LVOX_Grid3DExporter exporter;
         exporter.init();
-        exporter.setExportFilePath(_folder.first() + "/ni.GRD3D");
+        exporter.setExportFilePath(_folder.first() + "/ni." + suffix);
 
         // on la donne à l'exportateur
         if(!exporter.setItemDrawableToExport(hits_list))
@@ -178,7 +183,7 @@ void LVOX_StepExportComputedGrids::compute()
     {
         LVOX_Grid3DExporter exporter;
         exporter.init();
-        exporter.setExportFilePath(_folder.first() + "/nt.GRD3D");
+        exporter.setExportFilePath(_folder.first() + "/nt." + suffix);
 
         // on la donne à l'exportateur
         if(!exporter.setItemDrawableToExport(theo_list))
@@ -197,7 +202,7 @@ void LVOX_StepExportComputedGrids::compute()
     {
         LVOX_Grid3DExporter exporter;
         exporter.init();
-        exporter.setExportFilePath(_folder.first() + "/nb.GRD3D");
+        exporter.setExportFilePath(_folder.first() + "/nb." + suffix);
 
         // on la donne à l'exportateur
         if(!exporter.setItemDrawableToExport(before_list))
@@ -216,7 +221,7 @@ void LVOX_StepExportComputedGrids::compute()
     {
         LVOX_Grid3DExporter exporter;
         exporter.init();
-        exporter.setExportFilePath(_folder.first() + "/density.GRD3D");
+        exporter.setExportFilePath(_folder.first() + "/density." + suffix);
 
         // on la donne à l'exportateur
         if(!exporter.setItemDrawableToExport(density_list))
@@ -82,6 +82,7 @@ private:
 
     // Step parameters
     QStringList _folder;
+    bool        _binaryFormat;
 };
 
 #endif // LVOX_STEPEXPORTMERGEDGRIDS_H
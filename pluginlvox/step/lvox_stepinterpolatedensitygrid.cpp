@@ -18,12 +18,27 @@
 #define DEF_itemIn_hits "hits"
 #define DEF_itemIn_density "density"
 
+#include "tools/lvox_parallelfor.h"
+
 #include <math.h>
+#include <algorithm>
+#include <vector>
+
+namespace {
+    struct LevelSum {
+        LevelSum() : sum(0), ncells(0) {}
+
+        double  sum;
+        size_t  ncells;
+    };
+}
 
 // Constructor : initialization of parameters
 LVOX_StepInterpolateDensityGrids::LVOX_StepInterpolateDensityGrids(CT_StepInitializeData &dataInit) : CT_AbstractStep(dataInit)
 {
     _effectiveRayThresh = 1;
+    _levelValueMode = levelMean;
+    _trimPercent = 10;
 }
 
 // Step description (tooltip of contextual menu)
@@ -67,6 +82,13 @@ void LVOX_StepInterpolateDensityGrids::createPostConfigurationDialog()
     CT_StepConfigurableDialog *configDialog = newStandardPostConfigurationDialog();
     configDialog->addInt(tr("Ni minimum pour utiliser la valeur moyenne (0 sinon)"),"",-100000,100000, _effectiveRayThresh);
 
+    configDialog->addText(tr("Valeur du niveau z"), tr("(cellules de densité > 0) :"), "");
+    CT_ButtonGroup &bg_mode = configDialog->addButtonGroup(_levelValueMode);
+    configDialog->addExcludeValue(tr("moyenne"), "", "", bg_mode, levelMean);
+    configDialog->addExcludeValue(tr("médiane"), "", "", bg_mode, levelMedian);
+    configDialog->addExcludeValue(tr("moyenne tronquée"), "", "", bg_mode, levelTrimmedMean);
+    configDialog->addDouble(tr("    -> pourcentage retiré à chaque extrémité"), "%", 0, 49.99, 2, _trimPercent);
+
 }
 
 void LVOX_StepInterpolateDensityGrids::compute()
@@ -95,52 +117,154 @@ void LVOX_StepInterpolateDensityGrids::compute()
                                                                      itemIn_density->NA(),
                                                                      itemIn_density->NA());
 
-            // loop on z levels
-            for (size_t zz = 0 ;  zz < itemIn_density->zdim() ; zz++)
-            {
-                float meanDensity = 0;
-                size_t ncells = 0;
-                // Compute mean value for the level z
-                for (size_t yy = 0 ;  yy < itemIn_density->ydim() ; yy++)
-                {
-                    for (size_t xx = 0 ;  xx < itemIn_density->xdim() ; xx++)
-                    {
-                        float value = itemIn_density->value(xx, yy, zz);
-                        if (value > 0) // empty cells don't count for the mean density
-                        {
-                            meanDensity += value;
-                            ncells++;
-                        }
-                    }
-                }
-                meanDensity /= ncells;
+            const size_t levelSize = itemIn_density->xdim()*itemIn_density->ydim();
+            const QVector<float> levelValues = (_levelValueMode == levelMean) ? computeLevelMeans(itemIn_density)
+                                                                              : computeLevelRobustValues(itemIn_density, _levelValueMode, _trimPercent);
+            const int effectiveRayThresh = _effectiveRayThresh;
 
-                // set mean value for all NA cells
-                for (size_t yy = 0 ;  yy < itemIn_density->ydim() ; yy++)
+            // set the value of the level for all NA cells, in parallel on the whole grid
+            LVOX_ParallelFor::run(0, itemIn_density->nCells(), [itemIn_density, itemIn_hits, itemOut_density, &levelValues, levelSize, effectiveRayThresh](size_t begin, size_t end) {
+                for (size_t index = begin ; index < end ; ++index)
                 {
-                    for (size_t xx = 0 ;  xx < itemIn_density->xdim() ; xx++)
+                    float value = itemIn_density->valueAtIndex(index);
+                    if (value < 0 ) // replace NA values or incoherent density results
                     {
-                        float value = itemIn_density->value(xx, yy, zz);
-                        if (value < 0 ) // replace NA values or incoherent density results
+                        if (itemIn_hits->valueAtIndex(index) >= effectiveRayThresh)
                         {
-                            if (itemIn_hits->value(xx, yy, zz) >= _effectiveRayThresh)
-                            {
-                                itemOut_density->setValue(xx, yy, zz, meanDensity);
-                            } else {
-                                itemOut_density->setValue(xx, yy, zz, 0.0);
-                            }
-                        } else { // else if not a NA : keep the IN value
-                            itemOut_density->setValue(xx, yy, zz, value);
+                            value = levelValues.at(index / levelSize);
+                        } else {
+                            value = 0.0;
                         }
-                    }
+                    } // else if not a NA : keep the IN value
+
+                    itemOut_density->setValueAtIndex(index, value);
                 }
-            }
+            });
 
             itemOut_density->computeMinMax();
             groupIn_grids->addItemDrawable(itemOut_density);
         }
     }
+}
+
+QVector<float> LVOX_StepInterpolateDensityGrids::computeLevelMeans(const CT_Grid3D<float>* density)
+{
+    const size_t levelSize = density->xdim()*density->ydim();
+    const int zdim = density->zdim();
 
+    // each block accumulates the sums of the levels it covers, partial sums are added in the order of the blocks
+    const QVector<LevelSum> sums = LVOX_ParallelFor::reduce(0, density->nCells(), QVector<LevelSum>(), [density, levelSize, zdim](size_t begin, size_t end) {
+        QVector<LevelSum> partial(zdim);
+
+        for (size_t index = begin ; index < end ; ++index)
+        {
+            const float value = density->valueAtIndex(index);
+            if (value > 0) // empty cells don't count for the mean density
+            {
+                LevelSum& level = partial[index / levelSize];
+                level.sum += value;
+                level.ncells++;
+            }
+        }
+
+        return partial;
+    }, [](const QVector<LevelSum>& a, const QVector<LevelSum>& b) {
+        if (a.isEmpty()) {return b;}
+
+        QVector<LevelSum> sum(a);
+
+        for (int i = 0 ; i < sum.size() ; ++i)
+        {
+            sum[i].sum += b.at(i).sum;
+            sum[i].ncells += b.at(i).ncells;
+        }
+
+        return sum;
+    });
+
+    QVector<float> means(zdim, 0);
+
+    for (int zz = 0 ; zz < sums.size() ; ++zz)
+    {
+        if (sums.at(zz).ncells > 0)
+            means[zz] = sums.at(zz).sum / sums.at(zz).ncells;
+    }
 
+    return means;
+}
+
+QVector<float> LVOX_StepInterpolateDensityGrids::computeLevelRobustValues(const CT_Grid3D<float>* density, int mode, double trimPercent)
+{
+    const size_t xdim = density->xdim();
+    const size_t ydim = density->ydim();
+    QVector<float> values(density->zdim(), 0);
+    float* levelValues = values.data();
+
+    // the median and the trimmed mean only need a partial order of the values : selection (nth_element), not a full sort
+    LVOX_ParallelFor::run(0, density->zdim(), [density, xdim, ydim, mode, trimPercent, levelValues](size_t begin, size_t end) {
+        std::vector<float> positives;
+        positives.reserve(xdim*ydim);
+
+        for (size_t zz = begin ; zz < end ; ++zz)
+        {
+            positives.clear();
+
+            for (size_t yy = 0 ;  yy < ydim ; yy++)
+            {
+                for (size_t xx = 0 ;  xx < xdim ; xx++)
+                {
+                    const float value = density->value(xx, yy, zz);
+                    if (value > 0) {positives.push_back(value);}
+                }
+            }
+
+            const size_t n = positives.size();
+
+            if (n == 0)
+                continue;
+
+            // number of values removed at each end (none for the median)
+            size_t nTrim = (mode == levelTrimmedMean) ? (size_t)(n * trimPercent / 100.0) : 0;
+
+            if (2*nTrim >= n)
+                nTrim = (n - 1) / 2;
+
+            if (mode == levelTrimmedMean && nTrim > 0)
+            {
+                std::vector<float>::iterator first = positives.begin() + nTrim;
+                std::vector<float>::iterator last = positives.end() - nTrim;
+
+                // [first;last[ will contain the values that are not trimmed
+                std::nth_element(positives.begin(), first, positives.end());
+                std::nth_element(first, last, positives.end());
+
+                double sum = 0;
+                for (std::vector<float>::iterator it = first ; it != last ; ++it) {sum += *it;}
+
+                levelValues[zz] = sum / (n - 2*nTrim);
+            }
+            else if (mode == levelTrimmedMean)
+            {
+                double sum = 0;
+                for (size_t i = 0 ; i < n ; ++i) {sum += positives[i];}
+
+                levelValues[zz] = sum / n;
+            }
+            else
+            {
+                std::vector<float>::iterator middle = positives.begin() + n/2;
+                std::nth_element(positives.begin(), middle, positives.end());
+
+                float median = *middle;
+
+                // even number of values : mean of the two values of the middle, the lower one is the max of the first half
+                if (n % 2 == 0)
+                    median = (median + *std::max_element(positives.begin(), middle)) / 2.0f;
+
+                levelValues[zz] = median;
+            }
+        }
+    }, 1);
 
+    return values;
 }
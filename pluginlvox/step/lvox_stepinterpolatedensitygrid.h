@@ -3,6 +3,9 @@
 
 #include "ct_step/abstract/ct_abstractstep.h"
 #include "ct_tools/model/ct_autorenamemodels.h"
+#include "ct_itemdrawable/ct_grid3d.h"
+
+#include <QVector>
 
 
 
@@ -60,8 +63,24 @@ protected:
 
 private:
 
+    /*! \brief Value used for the NA cells of a level (computed from the cells of the level with a density > 0) */
+    enum LevelValueMode
+    {
+        levelMean = 0,
+        levelMedian = 1,
+        levelTrimmedMean = 2
+    };
+
+    /*! \brief Mean of the cells with a density > 0 of each z level, computed in one parallel pass on the grid */
+    static QVector<float> computeLevelMeans(const CT_Grid3D<float>* density);
+
+    /*! \brief Median or trimmed mean of the cells with a density > 0 of each z level (levels are computed in parallel) */
+    static QVector<float> computeLevelRobustValues(const CT_Grid3D<float>* density, int mode, double trimPercent);
+
     // Step parameters
     int    _effectiveRayThresh;
+    int    _levelValueMode;
+    double _trimPercent;        /*! percentage of values removed at each end for the trimmed mean */
 
     CT_AutoRenameModels _outGridDensity_ModelName;
 
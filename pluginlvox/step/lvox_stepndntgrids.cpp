@@ -6,6 +6,8 @@
 #include "ct_result/model/inModel/ct_inresultmodelgrouptocopy.h"
 #include "ct_result/model/outModel/tools/ct_outresultmodelgrouptocopypossibilities.h"
 
+#include "tools/lvox_gridkernels.h"
+
 // Alias for indexing models
 #define DEF_in_res "result"
 #define DEF_in_grp "group"
@@ -99,14 +101,9 @@ void LVOX_StepNdNtGrids::compute()
             nb->xdim(), nb->ydim(), nb->zdim(),
             nb->resolution(), nb->NA(), nb->NA());
 
-        size_t n = nbnt->nCells();
-        for(size_t i = 0; i < n; i++)
-        {
-            if(nt->valueAtIndex(i)) // avoid division by zero
-            {
-                nbnt->setValueAtIndex(i, static_cast<float>(nb->valueAtIndex(i))/nt->valueAtIndex(i));
-            }
-        }
+        // voxels with nt = 0 stay NA (avoid division by zero)
+        LVOX_GridKernels::ratio(nb, nt, nbnt);
+
         out_group->addItemDrawable(nbnt);
         nbnt->computeMinMax();
     }
@@ -0,0 +1,95 @@
+#include "lvox_binarygrid3d.h"
+
+#include <cstring>
+
+#define LVOX_BINARYGRID3D_MAGIC "LVOXG3D"
+
+bool LVOX_BinaryGrid3DFile::isBinaryGridFile(const QString& filePath)
+{
+    QFile file(filePath);
+
+    if(!file.open(QFile::ReadOnly))
+        return false;
+
+    Header header;
+    return readHeader(file, header);
+}
+
+bool LVOX_BinaryGrid3DFile::readHeader(QFile& file, Header& header)
+{
+    if(!file.seek(0))
+        return false;
+
+    if(file.read((char*)&header, sizeof(Header)) != sizeof(Header))
+        return false;
+
+    return (std::memcmp(header.magic, LVOX_BINARYGRID3D_MAGIC, sizeof(header.magic)) == 0)
+            && (header.version == VERSION);
+}
+
+bool LVOX_BinaryGrid3DFile::write(const CT_AbstractGrid3D* grid, const QString& filePath)
+{
+    if(const CT_Grid3D<int>* g = dynamic_cast<const CT_Grid3D<int>*>(grid))
+        return writeT(g, filePath);
+
+    if(const CT_Grid3D<float>* g = dynamic_cast<const CT_Grid3D<float>*>(grid))
+        return writeT(g, filePath);
+
+    if(const CT_Grid3D<double>* g = dynamic_cast<const CT_Grid3D<double>*>(grid))
+        return writeT(g, filePath);
+
+    return false;
+}
+
+bool LVOX_BinaryGrid3DFile::writeHeader(QFile& file, const CT_AbstractGrid3D* geometry, qint32 dataType, double na)
+{
+    Header header;
+    std::memset(&header, 0, sizeof(Header));
+    std::memcpy(header.magic, LVOX_BINARYGRID3D_MAGIC, sizeof(header.magic));
+    header.version = VERSION;
+    header.dataType = dataType;
+    header.xdim = geometry->xdim();
+    header.ydim = geometry->ydim();
+    header.zdim = geometry->zdim();
+    header.minX = geometry->minX();
+    header.minY = geometry->minY();
+    header.minZ = geometry->minZ();
+    header.resolution = geometry->resolution();
+    header.na = na;
+
+    return file.write((const char*)&header, sizeof(Header)) == sizeof(Header);
+}
+
+template<typename T>
+bool LVOX_BinaryGrid3DFile::writeT(const CT_Grid3D<T>* grid, const QString& filePath)
+{
+    QFile file(filePath);
+
+    if(!file.open(QFile::WriteOnly) || !writeHeader(file, grid, metaTypeOf<T>(), grid->NA()))
+        return false;
+
+    // values are written by blocks to limit the number of calls to write
+    const size_t nCells = grid->nCells();
+    const size_t blockSize = 65536;
+    std::vector<T> block(qMin(blockSize, nCells));
+
+    size_t i = 0;
+
+    while(i < nCells) {
+        const size_t n = qMin(blockSize, nCells - i);
+
+        for(size_t j = 0 ; j < n ; ++j)
+            block[j] = grid->valueAtIndex(i + j);
+
+        const qint64 nBytes = n * sizeof(T);
+
+        if(file.write((const char*)block.data(), nBytes) != nBytes)
+            return false;
+
+        i += n;
+    }
+
+    file.close();
+
+    return true;
+}
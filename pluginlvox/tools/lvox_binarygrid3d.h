@@ -0,0 +1,218 @@
+#ifndef LVOX_BINARYGRID3D_H
+#define LVOX_BINARYGRID3D_H
+
+#include "ct_itemdrawable/ct_grid3d.h"
+
+#include <QFile>
+#include <QString>
+#include <QMetaType>
+
+/*!
+ * \brief Binary 3D grid file (extension .LVG3D)
+ *
+ * A fixed size header followed by the raw values of the grid, stored in the
+ * same order as in memory (x fastest, then y, then z) and in the native byte order.
+ * Unlike the ASCII GRD3D format the values can be used directly from a memory
+ * mapping of the file, without parsing anything.
+ */
+class LVOX_BinaryGrid3DFile
+{
+public:
+    struct Header {
+        char    magic[8];       /*! always "LVOXG3D" followed by a null character */
+        quint32 version;        /*! version of the format */
+        qint32  dataType;       /*! QMetaType::Type of the values or an encoding (QUANTIZED_DISTANCES) */
+        quint64 xdim;
+        quint64 ydim;
+        quint64 zdim;
+        double  minX;
+        double  minY;
+        double  minZ;
+        double  resolution;
+        double  na;             /*! NA value of the grid */
+    };
+
+    static const quint32 VERSION = 1;
+
+    /**
+     * @brief dataType of the files of LVOX3_QuantizedDistanceGrid : unsigned short codes that are not
+     *        the values of the grid (not a QMetaType::Type, so they can not be read as plain values)
+     */
+    static const qint32 QUANTIZED_DISTANCES = -1;
+
+    /**
+     * @brief Returns the file suffix used for binary grids
+     */
+    static QString suffix() { return "LVG3D"; }
+
+    /**
+     * @brief Returns true if the file begins with a valid binary grid header
+     */
+    static bool isBinaryGridFile(const QString& filePath);
+
+    /**
+     * @brief Read and check the header of an opened file
+     */
+    static bool readHeader(QFile& file, Header& header);
+
+    /**
+     * @brief Write the grid in a binary file. Only grids of type int, float and double can be written.
+     * @return false if the type of the grid is not supported or if the file can not be written
+     */
+    static bool write(const CT_AbstractGrid3D* grid, const QString& filePath);
+
+    /**
+     * @brief Write values that are not in a CT_Grid3D (per example an encoded copy of a grid) with the
+     *        geometry of a grid. Values must be in the CT_Grid3D index order.
+     * @param dataType : type written in the header, the QMetaType::Type of T or the encoding of the values
+     */
+    template<typename T>
+    static bool writeValues(const CT_AbstractGrid3D* geometry, double na, const T* values, const QString& filePath, qint32 dataType = metaTypeOf<T>())
+    {
+        QFile file(filePath);
+
+        if(!file.open(QFile::WriteOnly) || !writeHeader(file, geometry, dataType, na))
+            return false;
+
+        const qint64 nBytes = geometry->nCells() * sizeof(T);
+
+        return file.write((const char*)values, nBytes) == nBytes;
+    }
+
+    /**
+     * @brief Returns the QMetaType::Type that correspond to the template parameter
+     */
+    template<typename T>
+    static QMetaType::Type metaTypeOf() { return (QMetaType::Type)qMetaTypeId<T>(); }
+
+private:
+    template<typename T>
+    static bool writeT(const CT_Grid3D<T>* grid, const QString& filePath);
+
+    static bool writeHeader(QFile& file, const CT_AbstractGrid3D* geometry, qint32 dataType, double na);
+};
+
+/*!
+ * \brief Read-only view of a binary grid file
+ *
+ * The file is memory-mapped so only the pages of the voxels that are read
+ * are loaded from the disk.
+ */
+template<typename T>
+class LVOX_MappedGrid3D
+{
+public:
+    LVOX_MappedGrid3D() : m_values(NULL), m_open(false) {}
+    ~LVOX_MappedGrid3D() { close(); }
+
+    /**
+     * @brief Map the file. Returns false if it is not a binary grid of type T.
+     */
+    bool open(const QString& filePath)
+    {
+        return open(filePath, LVOX_BinaryGrid3DFile::metaTypeOf<T>());
+    }
+
+    /**
+     * @brief Map the file. Returns false if its values are not of the data type (stored in values of type T).
+     */
+    bool open(const QString& filePath, qint32 dataType)
+    {
+        close();
+
+        m_file.setFileName(filePath);
+
+        if(!m_file.open(QFile::ReadOnly))
+            return false;
+
+        if(!LVOX_BinaryGrid3DFile::readHeader(m_file, m_header)
+                || (m_header.dataType != dataType)) {
+            m_file.close();
+            return false;
+        }
+
+        const qint64 dataSize = nCells() * sizeof(T);
+
+        if(m_file.size() < (qint64)(sizeof(LVOX_BinaryGrid3DFile::Header) + dataSize)) {
+            m_file.close();
+            return false;
+        }
+
+        // a grid without voxel has nothing to map (mapping 0 bytes fails)
+        if(dataSize == 0) {
+            m_file.close();
+            m_open = true;
+            return true;
+        }
+
+        uchar* mem = m_file.map(sizeof(LVOX_BinaryGrid3DFile::Header), dataSize);
+
+        if(mem == NULL) {
+            m_file.close();
+            return false;
+        }
+
+        m_values = (const T*)mem;
+        m_open = true;
+
+        return true;
+    }
+
+    void close()
+    {
+        if(m_values != NULL)
+            m_file.unmap((uchar*)m_values);
+
+        m_values = NULL;
+        m_open = false;
+
+        if(m_file.isOpen())
+            m_file.close();
+    }
+
+    bool isOpen() const { return m_open; }
+
+    const LVOX_BinaryGrid3DFile::Header& header() const { return m_header; }
+
+    size_t xdim() const { return m_header.xdim; }
+    size_t ydim() const { return m_header.ydim; }
+    size_t zdim() const { return m_header.zdim; }
+    size_t nCells() const { return m_header.xdim * m_header.ydim * m_header.zdim; }
+    T NA() const { return (T)m_header.na; }
+
+    /**
+     * @brief Returns the raw values, in the CT_Grid3D index order (NULL if the grid has no voxel)
+     */
+    const T* values() const { return m_values; }
+
+    T valueAtIndex(size_t index) const { return m_values[index]; }
+
+    /**
+     * @brief Create a CT_Grid3D with the geometry and the values of the file. CT_Grid3D owns its values
+     *        so all of them are copied (and all pages of the file are read).
+     */
+    CT_Grid3D<T>* createGrid(const CT_OutAbstractSingularItemModel* model, const CT_AbstractResult* result) const
+    {
+        CT_Grid3D<T>* grid = new CT_Grid3D<T>(model, result,
+                                              m_header.minX, m_header.minY, m_header.minZ,
+                                              m_header.xdim, m_header.ydim, m_header.zdim,
+                                              m_header.resolution, NA(), NA());
+
+        const size_t n = nCells();
+
+        for(size_t i = 0 ; i < n ; ++i)
+            grid->setValueAtIndex(i, m_values[i]);
+
+        grid->computeMinMax();
+
+        return grid;
+    }
+
+private:
+    QFile                           m_file;
+    LVOX_BinaryGrid3DFile::Header   m_header;
+    const T*                        m_values;
+    bool                            m_open;
+};
+
+#endif // LVOX_BINARYGRID3D_H
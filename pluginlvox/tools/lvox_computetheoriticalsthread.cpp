@@ -1,9 +1,9 @@
 #include "lvox_computetheoriticalsthread.h"
 #include "qdebug.h"
 #include "ct_itemdrawable/ct_beam.h"
-#include "ct_itemdrawable/tools/gridtools/ct_grid3dwootraversalalgorithm.h"
-#include "tools/lvox_distancevisitor.h"
-#include "tools/lvox_countvisitor.h"
+#include "mk/tools/traversal/woo/lvox3_grid3dwootraversalalgorithm.h"
+#include "mk/tools/traversal/woo/visitor/lvox3_countvisitor.h"
+#include "mk/tools/traversal/woo/visitor/lvox3_distancevisitor.h"
 
 LVOX_ComputeTheoriticalsThread::LVOX_ComputeTheoriticalsThread(const CT_Scanner *scanner,
                                                                CT_Grid3D<int> *outputTheoriticalGrid,
@@ -19,9 +19,6 @@ LVOX_ComputeTheoriticalsThread::LVOX_ComputeTheoriticalsThread(const CT_Scanner
 void LVOX_ComputeTheoriticalsThread::run()
 {
     qDebug() << "Début de LVOX_ComputeTheoriticalsThread / ScanId=" << _scanner->getScanID();
-    Eigen::Vector3d bot, top;
-    _outputTheoriticalGrid->getMinCoordinates(bot);
-    _outputTheoriticalGrid->getMaxCoordinates(top);
 
     // Creates the ray traversal algorithm
 
@@ -29,19 +26,21 @@ void LVOX_ComputeTheoriticalsThread::run()
     int nVerticalRays = _scanner->getNVRays();
 
     // Creates visitors
-    QList<CT_AbstractGrid3DBeamVisitor*> list;
+    QVector<LVOX3_Grid3DVoxelWooVisitor*> list;
 
-    LVOX_CountVisitor countVisitor(_outputTheoriticalGrid);
+    LVOX3_CountVisitor<int> countVisitor(_outputTheoriticalGrid);
     list.append(&countVisitor);
 
+    // declared here because the algorithm keeps a pointer on it
+    LVOX3_DistanceVisitor<float> distVisitor(_computeDistance ? _outputDeltaTheoriticalGrid : NULL);
+
     if (_computeDistance)
     {
-        LVOX_DistanceVisitor distVisitor(_outputDeltaTheoriticalGrid);
         list.append(&distVisitor);
     }
 
-    // Creates traversal algorithm
-    CT_Grid3DWooTraversalAlgorithm algo(_outputTheoriticalGrid, true, list);
+    // Creates traversal algorithm (shared with LVOX3 steps)
+    LVOX3_Grid3DWooTraversalAlgorithm<int> algo(_outputTheoriticalGrid, true, list);
 
     CT_Beam beam(NULL, NULL);
 
@@ -57,10 +56,8 @@ void LVOX_ComputeTheoriticalsThread::run()
             // Get the next ray
             _scanner->beam(i,j, beam);
 
-            if (beam.intersect(bot, top))
-            {
-                algo.compute(beam);
-            }
+            // rays that miss the grid are ignored by the algorithm
+            algo.compute(beam.getOrigin(), beam.getDirection());
         }
 
         if (i % progressStep == 0)
@@ -1,4 +1,5 @@
 #include "lvox_grid3dexporter.h"
+#include "lvox_binarygrid3d.h"
 #include "ct_itemdrawable/abstract/ct_abstractgrid3d.h"
 
 #include <math.h>
@@ -20,7 +21,7 @@ LVOX_Grid3DExporter::~LVOX_Grid3DExporter()
 
 QString LVOX_Grid3DExporter::getExporterCustomName() const
 {
-    return tr("Grilles 3D, ACSII");
+    return tr("Grilles 3D, ASCII ou binaire");
 }
 
 CT_StepsMenu::LevelPredefined LVOX_Grid3DExporter::getExporterSubMenuName() const
@@ -32,8 +33,9 @@ CT_StepsMenu::LevelPredefined LVOX_Grid3DExporter::getExporterSubMenuName() cons
 void LVOX_Grid3DExporter::init()
 {
     addNewExportFormat(FileFormat("GRD3D", tr("Fichiers Grilles 3D (ASCII)")));
+    addNewExportFormat(FileFormat(LVOX_BinaryGrid3DFile::suffix(), tr("Fichiers Grilles 3D (binaire)")));
 
-    setToolTip(tr("Export des Grilles 3D au format ASCII, inspiré du format ASCII ESRI GRID pour les rasters (1 fichier par grille)"));
+    setToolTip(tr("Export des Grilles 3D au format ASCII, inspiré du format ASCII ESRI GRID pour les rasters, ou au format binaire LVG3D (en-tête suivi des valeurs brutes). 1 fichier par grille"));
 }
 
 bool LVOX_Grid3DExporter::setItemDrawableToExport(const QList<CT_AbstractItemDrawable*> &list)
@@ -88,6 +90,12 @@ bool LVOX_Grid3DExporter::protectedExportToFile()
     QString baseName = exportPathInfo.baseName();
     QString suffix = "GRD3D";
 
+    // binary grids can be memory-mapped when they are imported
+    const bool binary = (exportPathInfo.suffix().compare(LVOX_BinaryGrid3DFile::suffix(), Qt::CaseInsensitive) == 0);
+
+    if(binary)
+        suffix = LVOX_BinaryGrid3DFile::suffix();
+
     QString indice = "";
     if (itemDrawableToExport().size() > 1) {indice = "_0";}
     int cpt = 0;
@@ -100,6 +108,13 @@ bool LVOX_Grid3DExporter::protectedExportToFile()
         {
             QString filePath = QString("%1/%2%3.%4").arg(path).arg(baseName).arg(indice).arg(suffix);
 
+            if(binary)
+            {
+                if(!LVOX_BinaryGrid3DFile::write(item, filePath)) {ok = false;}
+                indice = QString("_%1").arg(++cpt);
+                continue;
+            }
+
             QFile file(filePath);
 
             if(file.open(QFile::Text | QFile::WriteOnly))
@@ -0,0 +1,90 @@
+#ifndef LVOX_GRIDBOUNDS_H
+#define LVOX_GRIDBOUNDS_H
+
+#include <cmath>
+
+/*!
+ * \brief Alignment of the bounds of a grid on a lattice of step "resolution"
+ *
+ * Computes in constant time what the steps did with loops adding or removing the resolution
+ * until the bound reaches a coordinate. The resolution must be > 0.
+ */
+class LVOX_GridBounds
+{
+public:
+    /**
+     * @brief Returns the greatest value "base + k*resolution" (k integer) lower or equal to "value"
+     */
+    static double snapDown(double base, double value, double resolution)
+    {
+        double snapped = base + std::floor((value - base) / resolution) * resolution;
+
+        // the rounding of the division can give one step too much or too few
+        if(snapped > value)
+            snapped -= resolution;
+        else if((snapped + resolution) <= value)
+            snapped += resolution;
+
+        return snapped;
+    }
+
+    /**
+     * @brief Returns the smallest value "min + k*resolution" with k >= 1 greater or equal to "value"
+     */
+    static double snapUpAbove(double min, double value, double resolution)
+    {
+        const double k = std::ceil((value - min) / resolution);
+        double snapped = min + ((k < 1) ? 1 : k) * resolution;
+
+        if(snapped < value)
+            snapped += resolution;
+        else if((k > 1) && ((snapped - resolution) >= value))
+            snapped -= resolution;
+
+        return snapped;
+    }
+
+    /**
+     * @brief Move "min" down by a whole number of resolutions until it is lower or equal to "value"
+     * @return true if "min" was moved
+     */
+    static bool extendMinTo(double& min, double value, double resolution)
+    {
+        if(min <= value)
+            return false;
+
+        const double k = std::ceil((min - value) / resolution);
+        double moved = min - k * resolution;
+
+        if(moved > value)
+            moved -= resolution;
+        else if((k > 1) && ((moved + resolution) <= value))
+            moved += resolution;
+
+        min = moved;
+        return true;
+    }
+
+    /**
+     * @brief Move "max" up by a whole number of resolutions until it is greater or equal to "value"
+     * @return true if "max" was moved
+     */
+    static bool extendMaxTo(double& max, double value, double resolution)
+    {
+        if(max >= value)
+            return false;
+
+        const double k = std::ceil((value - max) / resolution);
+        double moved = max + k * resolution;
+
+        if(moved < value)
+            moved += resolution;
+        else if((k > 1) && ((moved - resolution) >= value))
+            moved -= resolution;
+
+        max = moved;
+        return true;
+    }
+};
+
+#endif // LVOX_GRIDBOUNDS_H
@@ -0,0 +1,294 @@
+#include "lvox_gridcombiner.h"
+
+#include "tools/lvox_gridcombinerstate.h"
+#include "tools/lvox_parallelfor.h"
+
+struct LVOX_GridCombiner::Context {
+    /*! accumulated grids of the state, NULL if not used or if there is no state */
+    struct StateGrids {
+        StateGrids() : hits(NULL), theoretical(NULL), before(NULL), density(NULL), deltaT(NULL), scanId(NULL) {}
+
+        LVOX3_CompactCountGrid* hits;
+        LVOX3_CompactCountGrid* theoretical;
+        LVOX3_CompactCountGrid* before;
+        CT_Grid3D<float>*       density;
+        CT_Grid3D<float>*       deltaT;         /*! sum of deltaT*nt */
+        CT_Grid3D<int>*         scanId;
+    };
+
+    int                                 nScans;
+    bool                                useNi;
+    bool                                useNt;
+    bool                                useNb;
+    bool                                useDeltaT;
+    const CT_Grid3D<int>* const*        ni;
+    const CT_Grid3D<int>* const*        nt;
+    const CT_Grid3D<int>* const*        nb;
+    const CT_Grid3D<float>* const*      d;
+    const CT_Grid3D<float>* const*      deltaT;
+    Outputs                             out;
+    bool                                resume;         /*! true to begin with the values of the state */
+    int                                 scanIdOffset;   /*! number of scans already in the state */
+    int                                 nTotalScans;
+    StateGrids                          state;
+};
+
+LVOX_GridCombiner::LVOX_GridCombiner(Mode mode,
+                                     int effectiveRayThresh,
+                                     bool useOnlyNotEmptyCellsIfMaxNt_Nb_div_Nt)
+{
+    m_mode = mode;
+    m_effectiveRayThresh = effectiveRayThresh;
+    m_useOnlyNotEmptyCells = useOnlyNotEmptyCellsIfMaxNt_Nb_div_Nt;
+}
+
+bool LVOX_GridCombiner::isConfigurationValid(const Inputs& inputs, const Outputs& outputs, const LVOX_GridCombinerState* state) const
+{
+    const int nScans = inputs.density.size();
+
+    if((nScans == 0) || (outputs.density == NULL) || (outputs.scanId == NULL))
+        return false;
+
+    const bool useNi = !inputs.hits.isEmpty();
+    const bool useNt = !inputs.theoretical.isEmpty();
+    const bool useNb = !inputs.before.isEmpty();
+    const bool useDeltaT = !inputs.deltaT.isEmpty();
+
+    if((useNi && ((inputs.hits.size() != nScans) || (outputs.hits == NULL)))
+            || (useNt && ((inputs.theoretical.size() != nScans) || (outputs.theoretical == NULL)))
+            || (useNb && ((inputs.before.size() != nScans) || (outputs.before == NULL)))
+            || (useDeltaT && ((inputs.deltaT.size() != nScans) || (outputs.deltaT == NULL))))
+        return false;
+
+    // delta are weighted by nt
+    if(useDeltaT && !useNt)
+        return false;
+
+    if(((m_mode == MaxNt_Nb) || (m_mode == MaxNt_Nb_div_Nt)) && (!useNt || !useNb))
+        return false;
+
+    if((m_mode == MaxNi) && !useNi)
+        return false;
+
+    if((m_mode == SumNiSumNtNb) && (!useNi || !useNt || !useNb))
+        return false;
+
+    if((state != NULL)
+            && !state->isEmpty()
+            && !state->isCompatible(m_mode, m_useOnlyNotEmptyCells, useNi, useNt, useNb, useDeltaT, outputs.density))
+        return false;
+
+    return true;
+}
+
+bool LVOX_GridCombiner::combine(const Inputs& inputs, Outputs& outputs, LVOX_GridCombinerState* state) const
+{
+    if(!isConfigurationValid(inputs, outputs, state))
+        return false;
+
+    Context c;
+    c.nScans = inputs.density.size();
+    c.useNi = !inputs.hits.isEmpty();
+    c.useNt = !inputs.theoretical.isEmpty();
+    c.useNb = !inputs.before.isEmpty();
+    c.useDeltaT = !inputs.deltaT.isEmpty();
+    c.ni = inputs.hits.constData();
+    c.nt = inputs.theoretical.constData();
+    c.nb = inputs.before.constData();
+    c.d = inputs.density.constData();
+    c.deltaT = inputs.deltaT.constData();
+    c.out = outputs;
+    c.resume = (state != NULL) && !state->isEmpty();
+    c.scanIdOffset = c.resume ? state->nScans() : 0;
+    c.nTotalScans = c.scanIdOffset + c.nScans;
+
+    if(state != NULL)
+    {
+        if(!c.resume)
+        {
+            const CT_Grid3D<float>* g = outputs.density;
+
+            state->clear();
+            state->m_mode = m_mode;
+            state->m_useOnlyNotEmptyCells = m_useOnlyNotEmptyCells;
+            state->m_density = new CT_Grid3D<float>(NULL, NULL, g->minX(), g->minY(), g->minZ(), g->xdim(), g->ydim(), g->zdim(), g->resolution(), g->NA(), g->NA());
+            state->m_scanId = new CT_Grid3D<int>(NULL, NULL, g->minX(), g->minY(), g->minZ(), g->xdim(), g->ydim(), g->zdim(), g->resolution(), -1, -1);
+
+            if(c.useNi) {state->m_hits = new LVOX3_CompactCountGrid(g->nCells(), outputs.hits->NA());}
+            if(c.useNt) {state->m_theoretical = new LVOX3_CompactCountGrid(g->nCells(), outputs.theoretical->NA());}
+            if(c.useNb) {state->m_before = new LVOX3_CompactCountGrid(g->nCells(), outputs.before->NA());}
+            if(c.useDeltaT) {state->m_deltaTSum = new CT_Grid3D<float>(NULL, NULL, g->minX(), g->minY(), g->minZ(), g->xdim(), g->ydim(), g->zdim(), g->resolution(), 0, 0);}
+        }
+
+        c.state.hits = state->m_hits;
+        c.state.theoretical = state->m_theoretical;
+        c.state.before = state->m_before;
+        c.state.density = state->m_density;
+        c.state.deltaT = state->m_deltaTSum;
+        c.state.scanId = state->m_scanId;
+    }
+
+    // dispatch the mode only one time, outside the loop on voxels
+    switch(m_mode) {
+    case MaxDensity:        combineAll<MaxDensity>(c); break;
+    case MaxNt_Nb:          combineAll<MaxNt_Nb>(c); break;
+    case MaxNt_Nb_div_Nt:   combineAll<MaxNt_Nb_div_Nt>(c); break;
+    case MaxNi:             combineAll<MaxNi>(c); break;
+    case SumNiSumNtNb:      combineAll<SumNiSumNtNb>(c); break;
+    }
+
+    if(outputs.hits != NULL) {outputs.hits->computeMinMax();}
+    if(outputs.theoretical != NULL) {outputs.theoretical->computeMinMax();}
+    if(outputs.before != NULL) {outputs.before->computeMinMax();}
+    if(outputs.density != NULL) {outputs.density->computeMinMax();}
+    if(outputs.deltaT != NULL) {outputs.deltaT->computeMinMax();}
+    if(outputs.scanId != NULL) {outputs.scanId->computeMinMax();}
+
+    if(state != NULL)
+        state->m_nScans = c.nTotalScans;
+
+    return true;
+}
+
+template<int MODE>
+void LVOX_GridCombiner::combineAll(const Context& c) const
+{
+    LVOX_ParallelFor::run(0, c.out.density->nCells(), [this, &c](size_t begin, size_t end) {
+        combineBlock<MODE>(c, begin, end);
+    });
+}
+
+template<int MODE>
+void LVOX_GridCombiner::combineBlock(const Context& c, size_t begin, size_t end) const
+{
+    for(size_t index = begin ; index < end ; ++index)
+    {
+        float d;
+        int ni, nt, nb, scanId, first;
+        float deltaT;
+
+        if(c.resume)
+        {
+            // Init with the scans already combined
+            d = c.state.density->valueAtIndex(index);
+            ni = c.useNi ? c.state.hits->valueAtIndex(index) : 0;
+            nt = c.useNt ? c.state.theoretical->valueAtIndex(index) : 0;
+            nb = c.useNb ? c.state.before->valueAtIndex(index) : 0;
+            deltaT = c.useDeltaT ? c.state.deltaT->valueAtIndex(index) : 0;
+            scanId = c.state.scanId->valueAtIndex(index);
+            first = 0;
+        }
+        else
+        {
+            // Init with first grids
+            d = c.d[0]->valueAtIndex(index);
+            ni = c.useNi ? c.ni[0]->valueAtIndex(index) : 0;
+            nt = c.useNt ? c.nt[0]->valueAtIndex(index) : 0;
+            nb = c.useNb ? c.nb[0]->valueAtIndex(index) : 0;
+            deltaT = c.useDeltaT ? c.deltaT[0]->valueAtIndex(index)*(float)nt : 0;
+            scanId = 0;
+            first = 1;
+        }
+
+        // Compare with others grids
+        for(int i = first ; i < c.nScans ; ++i)
+        {
+            if(MODE == SumNiSumNtNb) {
+                const int inNt = c.nt[i]->valueAtIndex(index);
+
+                ni += c.ni[i]->valueAtIndex(index);
+                nt += inNt;
+                nb += c.nb[i]->valueAtIndex(index);
+
+                if(c.useDeltaT) {deltaT += c.deltaT[i]->valueAtIndex(index)*(float)inNt;}
+
+                continue;
+            }
+
+            const float inD = c.d[i]->valueAtIndex(index);
+            const int inNt = c.useNt ? c.nt[i]->valueAtIndex(index) : 0;
+            const int inNb = c.useNb ? c.nb[i]->valueAtIndex(index) : 0;
+            bool replace = false;
+
+            if(MODE == MaxDensity) {
+                replace = (inD > d);
+            } else if(MODE == MaxNt_Nb) {
+                replace = ((inNt - inNb) > (nt - nb));
+            } else if(MODE == MaxNt_Nb_div_Nt) {
+                float inVal = 0;
+                float outVal = 0;
+
+                if (inNt > 0) {inVal = (float)(inNt - inNb)/(float)inNt;}
+                if (nt > 0) {outVal = (float)(nt - nb)/(float)nt;}
+
+                replace = (inVal > outVal);
+
+                if (m_useOnlyNotEmptyCells && (inD <= 0)) {replace = false;}
+            } else if(MODE == MaxNi) {
+                replace = (c.ni[i]->valueAtIndex(index) > ni);
+            }
+
+            if(replace)
+            {
+                d = inD;
+                if (c.useNi) {ni = c.ni[i]->valueAtIndex(index);}
+                nt = inNt;
+                nb = inNb;
+                if (c.useDeltaT) {deltaT = c.deltaT[i]->valueAtIndex(index)*(float)inNt;}
+                scanId = c.scanIdOffset + i;
+            }
+        }
+
+        if(c.state.density != NULL)
+        {
+            // in sum mode the density is computed again from the sums when scans are added
+            c.state.density->setValueAtIndex(index, d);
+            if (c.useNi) {c.state.hits->setValueAtIndex(index, ni);}
+            if (c.useNt) {c.state.theoretical->setValueAtIndex(index, nt);}
+            if (c.useNb) {c.state.before->setValueAtIndex(index, nb);}
+            if (c.useDeltaT) {c.state.deltaT->setValueAtIndex(index, deltaT);}
+            c.state.scanId->setValueAtIndex(index, scanId);
+        }
+
+        if((MODE == SumNiSumNtNb) && (c.nTotalScans > 1))
+        {
+            const int ntMnb = nt - nb;
+
+            // Avoid division by 0
+            if (ntMnb == 0)
+            {
+                d = -1;
+                deltaT = -1;
+            }
+            // If there is an error (nb > nt)
+            else if (ntMnb < 0)
+            {
+                d = -2;
+                deltaT = -2;
+            }
+            // If there is not enough information
+            else if (ntMnb < m_effectiveRayThresh)
+            {
+                d = -3;
+                deltaT = -3;
+            }
+            // More hits than rays that go through the voxel
+            else if (ni > ntMnb)
+            {
+                d = 1;
+            }
+            // Normal case
+            else
+            {
+                d = (float) ni / ((float) ntMnb);
+            }
+        }
+
+        c.out.density->setValueAtIndex(index, d);
+        if (c.useNi) {c.out.hits->setValueAtIndex(index, ni);}
+        if (c.useNt) {c.out.theoretical->setValueAtIndex(index, nt);}
+        if (c.useNb) {c.out.before->setValueAtIndex(index, nb);}
+        if (c.useDeltaT) {c.out.deltaT->setValueAtIndex(index, deltaT / (float)nt);}
+        c.out.scanId->setValueAtIndex(index, scanId);
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef LVOX_GRIDCOMBINER_H
+#define LVOX_GRIDCOMBINER_H
+
+#include "ct_itemdrawable/ct_grid3d.h"
+
+#include <QVector>
+
+class LVOX_GridCombinerState;
+
+/*!
+ * \brief Combine the LVOX grids of N scans in one set of grids (k-way reduction)
+ *
+ * For each voxel the grids of all scans are read at once and the result is written
+ * only one time. Voxels are visited in memory order and blocks of voxels are processed
+ * in parallel. The mode is chosen before the loop (one specialized loop per mode).
+ *
+ * All input grids must have the same geometry than the output grids.
+ *
+ * A LVOX_GridCombinerState can be given to keep the accumulated values: when the state is not
+ * empty the input grids are the new scans and they are folded in the state in one pass. The
+ * result is the same as the combination of all scans at once.
+ */
+class LVOX_GridCombiner
+{
+public:
+    /**
+     * @brief Same values than the "combinaisonMode" of the combine steps
+     */
+    enum Mode
+    {
+        MaxDensity,         /*! keep the scan with the max density */
+        MaxNt_Nb,           /*! keep the scan with the max (nt-nb) */
+        MaxNt_Nb_div_Nt,    /*! keep the scan with the max (nt-nb)/nt */
+        MaxNi,              /*! keep the scan with the max ni */
+        SumNiSumNtNb        /*! density = sum(ni)/sum(nt-nb) */
+    };
+
+    /**
+     * @brief Grids of all scans, a list is empty if the grid is not used
+     */
+    struct Inputs {
+        QVector<const CT_Grid3D<int>*>      hits;
+        QVector<const CT_Grid3D<int>*>      theoretical;
+        QVector<const CT_Grid3D<int>*>      before;
+        QVector<const CT_Grid3D<float>*>    density;
+        QVector<const CT_Grid3D<float>*>    deltaT;
+    };
+
+    /**
+     * @brief Combined grids, NULL if the grid is not used (density and scanId are always used)
+     */
+    struct Outputs {
+        Outputs() : hits(NULL), theoretical(NULL), before(NULL), density(NULL), deltaT(NULL), scanId(NULL) {}
+
+        CT_Grid3D<int>*     hits;
+        CT_Grid3D<int>*     theoretical;
+        CT_Grid3D<int>*     before;
+        CT_Grid3D<float>*   density;
+        CT_Grid3D<float>*   deltaT;
+        CT_Grid3D<int>*     scanId;     /*! index of the scan kept for each voxel */
+    };
+
+    LVOX_GridCombiner(Mode mode,
+                      int effectiveRayThresh,
+                      bool useOnlyNotEmptyCellsIfMaxNt_Nb_div_Nt);
+
+    /**
+     * @brief Returns false if the grids needed by the mode are not used or if the state is not
+     *        compatible with the inputs (nothing is computed)
+     */
+    bool isConfigurationValid(const Inputs& inputs, const Outputs& outputs, const LVOX_GridCombinerState* state = NULL) const;
+
+    /**
+     * @brief Compute the combined grids (min and max of each output grid are computed too)
+     * @param state : optionnal. If it is empty it is filled with the accumulated values of the inputs,
+     *                else the inputs are added to the scans of the state and the state is updated.
+     *                The scan id of the first input is the number of scans of the state.
+     * @return false if the configuration is not valid
+     */
+    bool combine(const Inputs& inputs, Outputs& outputs, LVOX_GridCombinerState* state = NULL) const;
+
+private:
+    Mode    m_mode;
+    int     m_effectiveRayThresh;
+    bool    m_useOnlyNotEmptyCells;
+
+    /**
+     * @brief Raw pointers to values of all grids for the loop
+     */
+    struct Context;
+
+    template<int MODE>
+    void combineBlock(const Context& c, size_t begin, size_t end) const;
+
+    template<int MODE>
+    void combineAll(const Context& c) const;
+};
+
+#endif // LVOX_GRIDCOMBINER_H
@@ -0,0 +1,222 @@
+#include "lvox_gridcombinerstate.h"
+
+#include "tools/lvox_binarygrid3d.h"
+
+#include <QDir>
+#include <QScopedPointer>
+#include <QSettings>
+
+#include <cmath>
+
+#define LVOX_COMBINERSTATE_INFO "state.ini"
+#define LVOX_COMBINERSTATE_VERSION 1
+
+const double LVOX_GridCombinerState::EPSILON = 0.000001;
+
+namespace {
+    QString gridFilePath(const QDir& dir, const QString& gridName)
+    {
+        return dir.filePath(QString("%1.%2").arg(gridName).arg(LVOX_BinaryGrid3DFile::suffix()));
+    }
+}
+
+LVOX_GridCombinerState::LVOX_GridCombinerState()
+{
+    m_hits = NULL;
+    m_theoretical = NULL;
+    m_before = NULL;
+    m_density = NULL;
+    m_deltaTSum = NULL;
+    m_scanId = NULL;
+
+    clear();
+}
+
+LVOX_GridCombinerState::~LVOX_GridCombinerState()
+{
+    clear();
+}
+
+bool LVOX_GridCombinerState::isEmpty() const
+{
+    return (m_nScans == 0) || (m_density == NULL);
+}
+
+int LVOX_GridCombinerState::nScans() const
+{
+    return m_nScans;
+}
+
+int LVOX_GridCombinerState::mode() const
+{
+    return m_mode;
+}
+
+bool LVOX_GridCombinerState::useOnlyNotEmptyCells() const
+{
+    return m_useOnlyNotEmptyCells;
+}
+
+bool LVOX_GridCombinerState::isCompatible(int mode,
+                                          bool useOnlyNotEmptyCells,
+                                          bool useNi,
+                                          bool useNt,
+                                          bool useNb,
+                                          bool useDeltaT,
+                                          const CT_AbstractGrid3D* grid) const
+{
+    if(isEmpty() || (grid == NULL))
+        return false;
+
+    if((mode != m_mode)
+            || (useOnlyNotEmptyCells != m_useOnlyNotEmptyCells)
+            || (useNi != (m_hits != NULL))
+            || (useNt != (m_theoretical != NULL))
+            || (useNb != (m_before != NULL))
+            || (useDeltaT != (m_deltaTSum != NULL)))
+        return false;
+
+    return (grid->xdim() == m_density->xdim())
+            && (grid->ydim() == m_density->ydim())
+            && (grid->zdim() == m_density->zdim())
+            && (std::fabs(grid->minX() - m_density->minX()) < EPSILON)
+            && (std::fabs(grid->minY() - m_density->minY()) < EPSILON)
+            && (std::fabs(grid->minZ() - m_density->minZ()) < EPSILON)
+            && (std::fabs(grid->resolution() - m_density->resolution()) < EPSILON);
+}
+
+void LVOX_GridCombinerState::clear()
+{
+    delete m_hits;
+    delete m_theoretical;
+    delete m_before;
+    delete m_density;
+    delete m_deltaTSum;
+    delete m_scanId;
+
+    m_hits = NULL;
+    m_theoretical = NULL;
+    m_before = NULL;
+    m_density = NULL;
+    m_deltaTSum = NULL;
+    m_scanId = NULL;
+
+    m_mode = 0;
+    m_useOnlyNotEmptyCells = false;
+    m_nScans = 0;
+}
+
+bool LVOX_GridCombinerState::save(const QString& directory) const
+{
+    if(isEmpty() || !QDir().mkpath(directory))
+        return false;
+
+    QDir dir(directory);
+
+    // the information file is removed first so a partially written state is never loaded
+    QFile::remove(dir.filePath(LVOX_COMBINERSTATE_INFO));
+
+    bool ok = LVOX_BinaryGrid3DFile::write(m_density, gridFilePath(dir, "density"))
+            && LVOX_BinaryGrid3DFile::write(m_scanId, gridFilePath(dir, "scanId"));
+
+    if(ok && (m_hits != NULL)) {ok = saveCountGrid(m_hits, gridFilePath(dir, "hits"));}
+    if(ok && (m_theoretical != NULL)) {ok = saveCountGrid(m_theoretical, gridFilePath(dir, "theoretical"));}
+    if(ok && (m_before != NULL)) {ok = saveCountGrid(m_before, gridFilePath(dir, "before"));}
+    if(ok && (m_deltaTSum != NULL)) {ok = LVOX_BinaryGrid3DFile::write(m_deltaTSum, gridFilePath(dir, "deltaTSum"));}
+
+    if(!ok)
+        return false;
+
+    QSettings info(dir.filePath(LVOX_COMBINERSTATE_INFO), QSettings::IniFormat);
+    info.setValue("version", LVOX_COMBINERSTATE_VERSION);
+    info.setValue("mode", m_mode);
+    info.setValue("useOnlyNotEmptyCells", m_useOnlyNotEmptyCells);
+    info.setValue("nScans", m_nScans);
+    info.setValue("useNi", m_hits != NULL);
+    info.setValue("useNt", m_theoretical != NULL);
+    info.setValue("useNb", m_before != NULL);
+    info.setValue("useDeltaT", m_deltaTSum != NULL);
+    info.sync();
+
+    return (info.status() == QSettings::NoError);
+}
+
+bool LVOX_GridCombinerState::load(const QString& directory)
+{
+    clear();
+
+    QDir dir(directory);
+
+    if(!dir.exists(LVOX_COMBINERSTATE_INFO))
+        return false;
+
+    QSettings info(dir.filePath(LVOX_COMBINERSTATE_INFO), QSettings::IniFormat);
+
+    if(info.value("version", 0).toInt() != LVOX_COMBINERSTATE_VERSION)
+        return false;
+
+    const int nScans = info.value("nScans", 0).toInt();
+
+    if(nScans <= 0)
+        return false;
+
+    bool ok = loadGrid(gridFilePath(dir, "density"), m_density)
+            && loadGrid(gridFilePath(dir, "scanId"), m_scanId);
+
+    if(ok && info.value("useNi", false).toBool()) {ok = loadCountGrid(gridFilePath(dir, "hits"), m_hits);}
+    if(ok && info.value("useNt", false).toBool()) {ok = loadCountGrid(gridFilePath(dir, "theoretical"), m_theoretical);}
+    if(ok && info.value("useNb", false).toBool()) {ok = loadCountGrid(gridFilePath(dir, "before"), m_before);}
+    if(ok && info.value("useDeltaT", false).toBool()) {ok = loadGrid(gridFilePath(dir, "deltaTSum"), m_deltaTSum);}
+
+    if(!ok) {
+        clear();
+        return false;
+    }
+
+    m_mode = info.value("mode", 0).toInt();
+    m_useOnlyNotEmptyCells = info.value("useOnlyNotEmptyCells", false).toBool();
+    m_nScans = nScans;
+
+    return true;
+}
+
+template<typename T>
+bool LVOX_GridCombinerState::loadGrid(const QString& filePath, CT_Grid3D<T>*& grid)
+{
+    LVOX_MappedGrid3D<T> mapped;
+
+    if(!mapped.open(filePath))
+        return false;
+
+    grid = mapped.createGrid(NULL, NULL);
+
+    return true;
+}
+
+bool LVOX_GridCombinerState::loadCountGrid(const QString& filePath, LVOX3_CompactCountGrid*& grid)
+{
+    LVOX_MappedGrid3D<int> mapped;
+
+    if(!mapped.open(filePath))
+        return false;
+
+    // values are read from the mapping, the grid of int is never created
+    const size_t nCells = mapped.nCells();
+    grid = new LVOX3_CompactCountGrid(nCells);
+
+    for(size_t i = 0 ; i < nCells ; ++i)
+        grid->setValueAtIndex(i, mapped.valueAtIndex(i));
+
+    return true;
+}
+
+bool LVOX_GridCombinerState::saveCountGrid(const LVOX3_CompactCountGrid* grid, const QString& filePath) const
+{
+    // the file format is not changed : the values are expanded in a grid of int, one grid at a time
+    const CT_Grid3D<float>* g = m_density;
+    QScopedPointer< CT_Grid3D<int> > expanded(new CT_Grid3D<int>(NULL, NULL, g->minX(), g->minY(), g->minZ(), g->xdim(), g->ydim(), g->zdim(), g->resolution(), lvox::Max_Error_Code, 0));
+
+    grid->copyTo(expanded.data());
+
+    return LVOX_BinaryGrid3DFile::write(expanded.data(), filePath);
+}
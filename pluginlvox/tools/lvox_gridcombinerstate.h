@@ -0,0 +1,102 @@
+#ifndef LVOX_GRIDCOMBINERSTATE_H
+#define LVOX_GRIDCOMBINERSTATE_H
+
+#include "ct_itemdrawable/ct_grid3d.h"
+#include "mk/tools/lvox3_compactcountgrid.h"
+
+#include <QString>
+
+/*!
+ * \brief Accumulated state of a combination of scans (see LVOX_GridCombiner)
+ *
+ * Keeps for each voxel the values needed to fold new scans in the combination without
+ * reading again the grids of the scans already combined: the values of the kept scan
+ * (max modes) or the sums (sum mode) of ni, nt and nb, the sum of deltaT weighted by nt,
+ * the density and the index of the kept scan. Sums of counts can only grow with the number of
+ * scans, they are kept in LVOX3_CompactCountGrid (16 bits per voxel, greater sums are promoted).
+ *
+ * The state can be saved in a folder (one binary grid (LVG3D) per accumulated grid and a
+ * text file with the parameters of the combination) and loaded later.
+ */
+class LVOX_GridCombinerState
+{
+public:
+    LVOX_GridCombinerState();
+    ~LVOX_GridCombinerState();
+
+    /**
+     * @brief Returns true if no scan was combined
+     */
+    bool isEmpty() const;
+
+    /**
+     * @brief Returns the number of scans already combined
+     */
+    int nScans() const;
+
+    /**
+     * @brief Returns the combination mode (LVOX_GridCombiner::Mode) of the state
+     */
+    int mode() const;
+
+    bool useOnlyNotEmptyCells() const;
+
+    /**
+     * @brief Returns true if the state can be used to add scans with these parameters and a grid with
+     *        this geometry (same mode, same used grids, same dimensions, resolution and bounding box)
+     */
+    bool isCompatible(int mode,
+                      bool useOnlyNotEmptyCells,
+                      bool useNi,
+                      bool useNt,
+                      bool useNb,
+                      bool useDeltaT,
+                      const CT_AbstractGrid3D* grid) const;
+
+    /**
+     * @brief Remove all accumulated grids, the state will be empty
+     */
+    void clear();
+
+    /**
+     * @brief Write the state in the folder (it is created if it does not exist)
+     */
+    bool save(const QString& directory) const;
+
+    /**
+     * @brief Read a state previously saved in the folder
+     * @return false if the folder does not contains a valid state (the state is empty)
+     */
+    bool load(const QString& directory);
+
+private:
+    friend class LVOX_GridCombiner;
+
+    static const double EPSILON;
+
+    int                 m_mode;
+    bool                m_useOnlyNotEmptyCells;
+    int                 m_nScans;
+
+    LVOX3_CompactCountGrid* m_hits;         /*! NULL if not used */
+    LVOX3_CompactCountGrid* m_theoretical;  /*! NULL if not used */
+    LVOX3_CompactCountGrid* m_before;       /*! NULL if not used */
+    CT_Grid3D<float>*       m_density;
+    CT_Grid3D<float>*       m_deltaTSum;    /*! sum of deltaT*nt, NULL if not used */
+    CT_Grid3D<int>*         m_scanId;
+
+    template<typename T>
+    static bool loadGrid(const QString& filePath, CT_Grid3D<T>*& grid);
+
+    /**
+     * @brief Read a grid of counts (a binary grid of int) in a compact grid
+     */
+    static bool loadCountGrid(const QString& filePath, LVOX3_CompactCountGrid*& grid);
+
+    /**
+     * @brief Write a compact grid as a binary grid of int with the geometry of the density grid
+     */
+    bool saveCountGrid(const LVOX3_CompactCountGrid* grid, const QString& filePath) const;
+};
+
+#endif // LVOX_GRIDCOMBINERSTATE_H
@@ -0,0 +1,262 @@
+#ifndef LVOX_GRIDKERNELS_H
+#define LVOX_GRIDKERNELS_H
+
+#include "ct_itemdrawable/ct_grid3d.h"
+
+#include "tools/lvox_parallelfor.h"
+
+#include <limits>
+#include <cmath>
+
+/*!
+ * \brief Arithmetic on grids voxel by voxel (ratio, difference, comparison, min/max)
+ *
+ * Each operation exists in two levels :
+ * - on raw arrays of n values : loops without branches (conditions are selects) that the compiler can vectorize
+ * - on grids : the grids are read in memory order by blocks in parallel, each block is copied in small
+ *   arrays of CHUNK_SIZE values and the raw arrays kernel is used on them
+ *
+ * NA values of the input grids are masked (ignored) except for the ratio that keep the behaviour of
+ * the nb/nt step (only a null denominator is masked).
+ */
+class LVOX_GridKernels
+{
+public:
+    static const size_t CHUNK_SIZE = 256;
+
+    /**
+     * @brief Min and max of the values that are not masked
+     */
+    template<typename T>
+    struct MinMax {
+        MinMax() : min(std::numeric_limits<T>::max()), max(std::numeric_limits<T>::lowest()), nValues(0) {}
+
+        T       min;
+        T       max;
+        size_t  nValues;    /*! number of values not masked */
+
+        bool isValid() const { return nValues > 0; }
+
+        static MinMax merge(const MinMax& a, const MinMax& b)
+        {
+            MinMax m;
+            m.min = qMin(a.min, b.min);
+            m.max = qMax(a.max, b.max);
+            m.nValues = a.nValues + b.nValues;
+            return m;
+        }
+    };
+
+    /**
+     * @brief Result of the comparison of two grids (a compared to b)
+     */
+    struct CompareStats {
+        CompareStats() : nEqual(0), nGreater(0), nLess(0), nMasked(0) {}
+
+        size_t  nEqual;     /*! |a-b| <= tolerance */
+        size_t  nGreater;   /*! a > b + tolerance */
+        size_t  nLess;      /*! a < b - tolerance */
+        size_t  nMasked;    /*! a or b is NA */
+
+        static CompareStats merge(const CompareStats& a, const CompareStats& b)
+        {
+            CompareStats s;
+            s.nEqual = a.nEqual + b.nEqual;
+            s.nGreater = a.nGreater + b.nGreater;
+            s.nLess = a.nLess + b.nLess;
+            s.nMasked = a.nMasked + b.nMasked;
+            return s;
+        }
+    };
+
+    //////////////////// RAW ARRAYS //////////////////
+
+    /**
+     * @brief out[i] = num[i]/den[i], or "na" if den[i] = 0
+     */
+    template<typename N, typename D>
+    static void ratio(const N* num, const D* den, size_t n, float na, float* out)
+    {
+        for(size_t i = 0 ; i < n ; ++i)
+        {
+            const bool valid = (den[i] != 0);
+            const float q = static_cast<float>(num[i]) / static_cast<float>(valid ? den[i] : 1);
+            out[i] = valid ? q : na;
+        }
+    }
+
+    /**
+     * @brief out[i] = a[i] - b[i], or "na" if a[i] or b[i] is NA
+     */
+    template<typename A, typename B>
+    static void difference(const A* a, const B* b, size_t n, A naA, B naB, float na, float* out)
+    {
+        for(size_t i = 0 ; i < n ; ++i)
+        {
+            const bool valid = (a[i] != naA) & (b[i] != naB);
+            const float d = static_cast<float>(a[i]) - static_cast<float>(b[i]);
+            out[i] = valid ? d : na;
+        }
+    }
+
+    /**
+     * @brief Update "stats" with the comparison of a[i] and b[i]
+     */
+    template<typename A, typename B>
+    static void compare(const A* a, const B* b, size_t n, A naA, B naB, double tolerance, CompareStats& stats)
+    {
+        size_t nEqual = 0;
+        size_t nGreater = 0;
+        size_t nLess = 0;
+        size_t nMasked = 0;
+
+        for(size_t i = 0 ; i < n ; ++i)
+        {
+            const bool valid = (a[i] != naA) & (b[i] != naB);
+            const double d = static_cast<double>(a[i]) - static_cast<double>(b[i]);
+
+            nMasked += valid ? 0 : 1;
+            nGreater += (valid & (d > tolerance)) ? 1 : 0;
+            nLess += (valid & (d < -tolerance)) ? 1 : 0;
+            nEqual += (valid & (d >= -tolerance) & (d <= tolerance)) ? 1 : 0;
+        }
+
+        stats.nEqual += nEqual;
+        stats.nGreater += nGreater;
+        stats.nLess += nLess;
+        stats.nMasked += nMasked;
+    }
+
+    /**
+     * @brief Update "mm" with values that are not NA (and not NaN)
+     */
+    template<typename T>
+    static void minMax(const T* values, size_t n, T na, MinMax<T>& mm)
+    {
+        T min = mm.min;
+        T max = mm.max;
+        size_t nValues = 0;
+
+        for(size_t i = 0 ; i < n ; ++i)
+        {
+            const T v = values[i];
+            const bool valid = (v != na) & (v == v);
+
+            nValues += valid ? 1 : 0;
+            min = (valid & (v < min)) ? v : min;
+            max = (valid & (v > max)) ? v : max;
+        }
+
+        mm.min = min;
+        mm.max = max;
+        mm.nValues += nValues;
+    }
+
+    //////////////////// GRIDS //////////////////
+
+    /**
+     * @brief Ratio of two grids (see ratio on arrays), the NA of the output grid is used for null denominators
+     * @return min and max of the output values that are not NA
+     */
+    template<typename N, typename D>
+    static MinMax<float> ratio(const CT_Grid3D<N>* num, const CT_Grid3D<D>* den, CT_Grid3D<float>* out)
+    {
+        const float na = out->NA();
+
+        return LVOX_ParallelFor::reduce(0, out->nCells(), MinMax<float>(), [num, den, out, na](size_t begin, size_t end) {
+            N bufNum[CHUNK_SIZE];
+            D bufDen[CHUNK_SIZE];
+            float bufOut[CHUNK_SIZE];
+            MinMax<float> mm;
+
+            for(size_t chunk = begin ; chunk < end ; chunk += CHUNK_SIZE)
+            {
+                const size_t n = qMin(end - chunk, (size_t)CHUNK_SIZE);
+
+                read(num, chunk, n, bufNum);
+                read(den, chunk, n, bufDen);
+                ratio(bufNum, bufDen, n, na, bufOut);
+                minMax(bufOut, n, na, mm);
+                write(out, chunk, n, bufOut);
+            }
+
+            return mm;
+        }, &MinMax<float>::merge);
+    }
+
+    /**
+     * @brief Difference of two grids (see difference on arrays), the NA of the output grid is used for masked voxels
+     * @return min and max of the output values that are not NA
+     */
+    template<typename A, typename B>
+    static MinMax<float> difference(const CT_Grid3D<A>* a, const CT_Grid3D<B>* b, CT_Grid3D<float>* out)
+    {
+        const A naA = a->NA();
+        const B naB = b->NA();
+        const float na = out->NA();
+
+        return LVOX_ParallelFor::reduce(0, out->nCells(), MinMax<float>(), [a, b, out, naA, naB, na](size_t begin, size_t end) {
+            A bufA[CHUNK_SIZE];
+            B bufB[CHUNK_SIZE];
+            float bufOut[CHUNK_SIZE];
+            MinMax<float> mm;
+
+            for(size_t chunk = begin ; chunk < end ; chunk += CHUNK_SIZE)
+            {
+                const size_t n = qMin(end - chunk, (size_t)CHUNK_SIZE);
+
+                read(a, chunk, n, bufA);
+                read(b, chunk, n, bufB);
+                difference(bufA, bufB, n, naA, naB, na, bufOut);
+                minMax(bufOut, n, na, mm);
+                write(out, chunk, n, bufOut);
+            }
+
+            return mm;
+        }, &MinMax<float>::merge);
+    }
+
+    /**
+     * @brief Compare two grids of the same geometry
+     */
+    template<typename A, typename B>
+    static CompareStats compare(const CT_Grid3D<A>* a, const CT_Grid3D<B>* b, double tolerance)
+    {
+        const A naA = a->NA();
+        const B naB = b->NA();
+
+        return LVOX_ParallelFor::reduce(0, a->nCells(), CompareStats(), [a, b, naA, naB, tolerance](size_t begin, size_t end) {
+            A bufA[CHUNK_SIZE];
+            B bufB[CHUNK_SIZE];
+            CompareStats stats;
+
+            for(size_t chunk = begin ; chunk < end ; chunk += CHUNK_SIZE)
+            {
+                const size_t n = qMin(end - chunk, (size_t)CHUNK_SIZE);
+
+                read(a, chunk, n, bufA);
+                read(b, chunk, n, bufB);
+                compare(bufA, bufB, n, naA, naB, tolerance, stats);
+            }
+
+            return stats;
+        }, &CompareStats::merge);
+    }
+
+private:
+    template<typename T>
+    static void read(const CT_Grid3D<T>* grid, size_t begin, size_t n, T* values)
+    {
+        for(size_t i = 0 ; i < n ; ++i)
+            values[i] = grid->valueAtIndex(begin + i);
+    }
+
+    template<typename T>
+    static void write(CT_Grid3D<T>* grid, size_t begin, size_t n, const T* values)
+    {
+        for(size_t i = 0 ; i < n ; ++i)
+            grid->setValueAtIndex(begin + i, values[i]);
+    }
+};
+
+#endif // LVOX_GRIDKERNELS_H
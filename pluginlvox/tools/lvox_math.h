@@ -0,0 +1,68 @@
+#ifndef LVOX_MATH_H
+#define LVOX_MATH_H
+
+#include <QtGlobal>
+
+#include <cstring>
+
+/*!
+ * \brief Math functions written without branches nor calls so that the compiler can
+ *        vectorize the loops that use them (they are inlined in the loop)
+ */
+class LVOX_Math
+{
+public:
+    /**
+     * @brief Returns log(1+x) for x > -1 (relative error of a few ulp).
+     *
+     * Uses the polynomial of the cephes logf on the mantissa of 1+x. The rounding error
+     * of 1+x is corrected so that the result stays accurate when x is near 0.
+     * Results for x <= -1, infinity or NaN are not defined (use std::log1p).
+     */
+    static inline float log1p(float x)
+    {
+        const float u = 1.0f + x;
+
+        // u = m * 2^e with m in [0.5;1[
+        quint32 bits;
+        std::memcpy(&bits, &u, sizeof(float));
+
+        int e = (int)((bits >> 23) & 0xff) - 126;
+        bits = (bits & 0x007fffff) | 0x3f000000;
+
+        float m;
+        std::memcpy(&m, &bits, sizeof(float));
+
+        // m in [sqrt(0.5);sqrt(2)[, written with selects of values and not branches
+        // (m-1)+m is exact and equal to 2m-1
+        const bool small = (m < 0.707106781186547524f);
+        e -= (int)small;
+        m = (m - 1.0f) + (small ? m : 0.0f);
+
+        const float z = m * m;
+
+        float y = 7.0376836292E-2f;
+        y = y * m - 1.1514610310E-1f;
+        y = y * m + 1.1676998740E-1f;
+        y = y * m - 1.2420140846E-1f;
+        y = y * m + 1.4249322787E-1f;
+        y = y * m - 1.6668057665E-1f;
+        y = y * m + 2.0000714765E-1f;
+        y = y * m - 2.4999993993E-1f;
+        y = y * m + 3.3333331174E-1f;
+        y = y * m * z;
+
+        const float fe = (float)e;
+
+        y += -2.12194440E-4f * fe;
+        y += -0.5f * z;
+
+        float result = m + y;
+        result += 0.693359375f * fe;
+
+        // log(1+x) = log(u) + (x - (u-1))/u
+        return result + ((x - (u - 1.0f)) / u);
+    }
+};
+
+#endif // LVOX_MATH_H
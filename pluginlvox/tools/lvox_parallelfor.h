@@ -0,0 +1,96 @@
+#ifndef LVOX_PARALLELFOR_H
+#define LVOX_PARALLELFOR_H
+
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent/QtConcurrentMap>
+
+/*!
+ * \brief Run a loop over [begin;end[ on the threads of the global thread pool
+ *
+ * The range is cut in contiguous blocks (a few per thread to balance the load) and the
+ * function is called once per block with the bounds of the block. Use it to walk grids in
+ * memory order: each thread works on a contiguous part of the arrays.
+ */
+class LVOX_ParallelFor
+{
+public:
+    struct Block {
+        size_t begin;
+        size_t end;
+    };
+
+    /**
+     * @brief Call "f(blockBegin, blockEnd)" for each block of [begin;end[ and wait until all blocks are done
+     * @param minBlockSize : minimum number of elements of a block, below it the loop is not worth a thread
+     */
+    template<typename Function>
+    static void run(size_t begin, size_t end, const Function& f, size_t minBlockSize = 16384)
+    {
+        if(end <= begin)
+            return;
+
+        QVector<Block> blocks = cut(begin, end, minBlockSize);
+
+        if(blocks.size() == 1) {
+            f(begin, end);
+            return;
+        }
+
+        QtConcurrent::blockingMap(blocks, [&f](Block& b) { f(b.begin, b.end); });
+    }
+
+    /**
+     * @brief Call "f(blockBegin, blockEnd)" for each block of [begin;end[, each call returns a partial result.
+     *        Partial results are combined with "reduce(value, partialResult)" in the order of the blocks,
+     *        beginning with "init", so the result does not depend on the scheduling of threads.
+     */
+    template<typename T, typename Function, typename Reduce>
+    static T reduce(size_t begin, size_t end, const T& init, const Function& f, const Reduce& reduce, size_t minBlockSize = 16384)
+    {
+        QVector<Block> blocks = cut(begin, end, minBlockSize);
+        QVector<T> results(blocks.size(), init);
+
+        if(blocks.size() == 1) {
+            results[0] = f(begin, end);
+        } else if(blocks.size() > 1) {
+            const Block* first = blocks.constData();
+            T* partial = results.data();
+
+            QtConcurrent::blockingMap(blocks, [&f, first, partial](Block& b) { partial[&b - first] = f(b.begin, b.end); });
+        }
+
+        T value = init;
+
+        for(int i = 0 ; i < results.size() ; ++i)
+            value = reduce(value, results.at(i));
+
+        return value;
+    }
+
+    /**
+     * @brief Returns the blocks used by run(), blocks are in the order of the range
+     */
+    static QVector<Block> cut(size_t begin, size_t end, size_t minBlockSize = 16384)
+    {
+        QVector<Block> blocks;
+
+        if(end <= begin)
+            return blocks;
+
+        const size_t size = end - begin;
+        const size_t nBlocksMax = qMax(1, QThread::idealThreadCount()) * 4;
+        const size_t blockSize = qMax(qMax((size_t)1, minBlockSize), (size + nBlocksMax - 1) / nBlocksMax);
+
+        for(size_t b = begin ; b < end ; b += blockSize) {
+            Block block;
+            block.begin = b;
+            block.end = qMin(end, b + blockSize);
+            blocks.append(block);
+        }
+
+        return blocks;
+    }
+};
+
+#endif // LVOX_PARALLELFOR_H
@@ -0,0 +1,112 @@
+#include "lvox_threadscheduler.h"
+
+#include <QThread>
+#include <QMutexLocker>
+
+LVOX_ThreadScheduler::LVOX_ThreadScheduler(int maxThreads) : QObject()
+{
+    m_maxThreads = (maxThreads > 0) ? maxThreads : qMax(1, QThread::idealThreadCount());
+    m_nRunning = 0;
+    m_canceled = false;
+}
+
+void LVOX_ThreadScheduler::addThread(CT_MonitoredQThread* thread, const QList<CT_MonitoredQThread*>& dependencies)
+{
+    Task task;
+    task.thread = thread;
+    task.started = false;
+    task.finished = false;
+
+    foreach (CT_MonitoredQThread* dependency, dependencies) {
+        if(m_indexes.contains(dependency))
+            task.dependencies.append(m_indexes.value(dependency));
+    }
+
+    const int index = m_tasks.size();
+
+    m_indexes.insert(thread, index);
+    m_tasks.append(task);
+
+    // direct connection : the slot is called in the finished thread
+    connect(thread, &QThread::finished, this, [this, index]() { threadFinished(index); }, Qt::DirectConnection);
+}
+
+void LVOX_ThreadScheduler::run()
+{
+    QMutexLocker locker(&m_mutex);
+
+    const int nTasks = m_tasks.size();
+    int nFinished = 0;
+    int firstNotStarted = 0;
+
+    while(nFinished < nTasks)
+    {
+        if(!m_canceled)
+        {
+            for(int i = firstNotStarted ; (i < nTasks) && (m_nRunning < m_maxThreads) ; ++i)
+            {
+                Task& task = m_tasks[i];
+
+                if(!task.started && isReady(task)) {
+                    task.started = true;
+                    ++m_nRunning;
+                    task.thread->start();
+                }
+            }
+
+            while((firstNotStarted < nTasks) && m_tasks.at(firstNotStarted).started)
+                ++firstNotStarted;
+        }
+
+        if(m_nRunning == 0)
+            break;
+
+        m_taskFinished.wait(&m_mutex);
+
+        nFinished = 0;
+
+        for(int i = 0 ; i < nTasks ; ++i) {
+            if(m_tasks.at(i).finished)
+                ++nFinished;
+        }
+    }
+
+    locker.unlock();
+
+    // the "finished" signal is emitted before the end of the thread
+    for(int i = 0 ; i < nTasks ; ++i) {
+        if(m_tasks.at(i).started)
+            m_tasks.at(i).thread->wait();
+    }
+}
+
+int LVOX_ThreadScheduler::maxThreads() const
+{
+    return m_maxThreads;
+}
+
+void LVOX_ThreadScheduler::cancel()
+{
+    QMutexLocker locker(&m_mutex);
+    m_canceled = true;
+}
+
+bool LVOX_ThreadScheduler::isReady(const Task& task) const
+{
+    foreach (int dependency, task.dependencies) {
+        if(!m_tasks.at(dependency).finished)
+            return false;
+    }
+
+    return true;
+}
+
+void LVOX_ThreadScheduler::threadFinished(int index)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_tasks[index].finished = true;
+    --m_nRunning;
+
+    m_taskFinished.wakeAll();
+}
@@ -0,0 +1,85 @@
+#ifndef LVOX_THREADSCHEDULER_H
+#define LVOX_THREADSCHEDULER_H
+
+#include "ct_tools/ct_monitoredqthread.h"
+
+#include <QObject>
+#include <QList>
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+
+/*!
+ * \brief Runs a list of threads with a bounded number of threads running at the same time
+ *
+ * A thread can depend on other threads of the scheduler : it is started only when all its
+ * dependencies are finished. Ready threads are started in the order they were added, so a
+ * thread added just after its dependencies is started as soon as they are finished.
+ *
+ * The scheduler does not own the threads.
+ */
+class LVOX_ThreadScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief Create a scheduler
+     * @param maxThreads : maximum number of threads running at the same time (the number of
+     *                     cores if <= 0)
+     */
+    LVOX_ThreadScheduler(int maxThreads = 0);
+
+    /**
+     * @brief Add a thread to run
+     * @param thread : the thread
+     * @param dependencies : threads (already added) that must be finished before this thread is started
+     */
+    void addThread(CT_MonitoredQThread* thread,
+                   const QList<CT_MonitoredQThread*>& dependencies = QList<CT_MonitoredQThread*>());
+
+    /**
+     * @brief Run all threads and returns when they are all finished (or when the scheduler
+     *        was canceled and running threads are finished)
+     */
+    void run();
+
+    /**
+     * @brief Returns the maximum number of threads running at the same time
+     */
+    int maxThreads() const;
+
+public slots:
+    /**
+     * @brief Don't start other threads. Threads already running are not stopped.
+     */
+    void cancel();
+
+private:
+    struct Task {
+        CT_MonitoredQThread*    thread;
+        QList<int>              dependencies;
+        bool                    started;
+        bool                    finished;
+    };
+
+    QList<Task>                         m_tasks;
+    QHash<CT_MonitoredQThread*, int>    m_indexes;
+    int                                 m_maxThreads;
+    int                                 m_nRunning;
+    bool                                m_canceled;
+    QMutex                              m_mutex;
+    QWaitCondition                      m_taskFinished;
+
+    /**
+     * @brief Returns true if all dependencies of the task are finished (mutex must be locked)
+     */
+    bool isReady(const Task& task) const;
+
+    /**
+     * @brief Called (in the finished thread) when a thread is finished
+     */
+    void threadFinished(int index);
+};
+
+#endif // LVOX_THREADSCHEDULER_H
@@ -12,6 +12,7 @@
 
 // Inclusion of used ItemDrawable classes
 #include "ct_itemdrawable/ct_grid3d.h"
+#include "tools/lvox_gridcombiner.h"
 #include "qdebug.h"
 
 // MNT
@@ -221,6 +222,7 @@ void LVOX2_StepCombineLvoxGrids::compute()
     if (_mode == maxNt_Nb_div_Nt && (!use_nt || !use_nb)) {qDebug() << "Configuration non prévue !"; return;}
     if (_mode == maxNi && !use_ni) {qDebug() << "Configuration non prévue !"; return;}
     if (_mode == sumNiSumNtNb && (!use_nt || !use_nb || !use_ni)) {qDebug() << "Configuration non prévue !"; return;}
+    if (use_deltaT && !use_nt) {qDebug() << "Configuration non prévue !"; return;}
 
     double xmin, ymin, zmin, res, NAd;
     size_t xdim, ydim, zdim;
@@ -347,170 +349,27 @@ void LVOX2_StepCombineLvoxGrids::compute()
     resultOut_grids->addGroup(groupOut_grids);
 
 
-    const CT_Grid3D<float>* in_d = NULL;
-    const CT_Grid3D<int>* in_ni = NULL;
-    const CT_Grid3D<int>* in_nt = NULL;
-    const CT_Grid3D<int>* in_nb = NULL;
-    const CT_Grid3D<float>* in_deltaT = NULL;
-    qDebug() << "  Computing combined grids...";
+    // Compute combined grids values : all scans are read at once for each voxel
+    LVOX_GridCombiner::Inputs inputs;
+    inputs.hits = InGrids_hits;
+    inputs.theoretical = InGrids_theoretical;
+    inputs.before = InGrids_before;
+    inputs.density = InGrids_density;
+    inputs.deltaT = InGrids_deltaT;
 
-    // Compute combined grids values
-    // Init with first grids
-    in_d = InGrids_density.at(0);
-    if (use_ni) {in_ni = InGrids_hits.at(0);}
-    if (use_nt) {in_nt = InGrids_theoretical.at(0);}
-    if (use_nb) {in_nb = InGrids_before.at(0);}
-    if (use_deltaT) {in_deltaT = InGrids_deltaT.at(0);}
+    LVOX_GridCombiner::Outputs outputs;
+    outputs.hits = itemOut_hits;
+    outputs.theoretical = itemOut_theoretical;
+    outputs.before = itemOut_before;
+    outputs.density = itemOut_density;
+    outputs.deltaT = itemOut_deltaT;
+    outputs.scanId = itemOut_scanId;
 
-    for (size_t xx = 0 ; xx < xdim ; xx++)
-    {
-        for (size_t yy = 0 ; yy < ydim ; yy++)
-        {
-            for (size_t zz = 0 ; zz < zdim ; zz++)
-            {
-                size_t index;
-                in_d->index(xx, yy, zz, index);
-                itemOut_density->setValueAtIndex(index, in_d->valueAtIndex(index));
-                if (use_ni) {itemOut_hits->setValueAtIndex(index, in_ni->valueAtIndex(index));}
-                if (use_nt) {itemOut_theoretical->setValueAtIndex(index, in_nt->valueAtIndex(index));}
-                if (use_nb) {itemOut_before->setValueAtIndex(index, in_nb->valueAtIndex(index));}
-                if (use_deltaT) {itemOut_deltaT->setValueAtIndex(index, in_deltaT->valueAtIndex(index)*(float)in_nt->valueAtIndex(index));}
-                itemOut_scanId->setValueAtIndex(index, 0);
-            }
-        }
-    }
-    qDebug() << "  Initialization with first grid done. Starting other grids...";
-    // Compare with others grids
-    for (int i = 1 ; i < InGrids_density.size() ; i++)
-    {
-        //qDebug() << "i=" << i;
-        in_d = InGrids_density.at(i);
-        if (use_ni) {in_ni = InGrids_hits.at(i);}
-        if (use_nt) {in_nt = InGrids_theoretical.at(i);}
-        if (use_nb) {in_nb = InGrids_before.at(i);}
-        if (use_deltaT) {in_deltaT = InGrids_deltaT.at(i);}
-        //qDebug() << "i=" << i;
-        for (size_t xx = 0 ; xx < xdim ; xx++)
-        {
-            for (size_t yy = 0 ; yy < ydim ; yy++)
-            {
-                for (size_t zz = 0 ; zz < zdim ; zz++)
-                {
-                    size_t index;
-                    in_d->index(xx, yy, zz, index);
-                    bool replace = false;
-
-                    if (_mode == maxDensity) {
-                        replace = (in_d->valueAtIndex(index) > itemOut_density->valueAtIndex(index));
-                    } else if (_mode == maxNt_Nb) {
-                        //qDebug() << "before replace";
-                        replace = ((in_nt->valueAtIndex(index) - in_nb->valueAtIndex(index)) > (itemOut_theoretical->valueAtIndex(index) - itemOut_before->valueAtIndex(index)));
-                    } else if (_mode == maxNt_Nb_div_Nt) {
-                        float inVal = 0;
-                        float outVal = 0;
-
-                        if (in_nt->valueAtIndex(index) > 0) {inVal = (float)(in_nt->valueAtIndex(index) - in_nb->valueAtIndex(index))/(float)in_nt->valueAtIndex(index);}
-                        if (itemOut_theoretical->valueAtIndex(index) > 0) {outVal = (float)(itemOut_theoretical->valueAtIndex(index) - itemOut_before->valueAtIndex(index))/(float)itemOut_theoretical->valueAtIndex(index);}
-
-                        replace = (inVal > outVal);
-
-                        if (_UseOnlyNotEmptyCellsIf_maxNt_Nb_div_Nt_selected && (in_d->valueAtIndex(index) <= 0)) {replace = false;}
-
-                    } else if (_mode == maxNi) {
-                        replace = (in_ni->valueAtIndex(index) > itemOut_hits->valueAtIndex(index));
-                    } else if (_mode == sumNiSumNtNb) {
-                        //qDebug() << "i=" <<i;
-                        replace = false;
-                        //qDebug() << "ni=" <<in_ni->valueAtIndex(index);
-                        //qDebug() << "nt=" <<in_nt->valueAtIndex(index);
-                        //qDebug() << "nb=" <<in_nb->valueAtIndex(index);
-                        //qDebug() << use_deltaT;
-                        //qDebug() << "ndelta=" <<in_deltaT->valueAtIndex(index)*(float)in_nt->valueAtIndex(index);
-
-                        itemOut_hits->addValueAtIndex(index, in_ni->valueAtIndex(index));
-                        itemOut_theoretical->addValueAtIndex(index, in_nt->valueAtIndex(index));
-                        itemOut_before->addValueAtIndex(index, in_nb->valueAtIndex(index));
-                        if (use_deltaT) {itemOut_deltaT->addValueAtIndex(index, in_deltaT->valueAtIndex(index)*(float)in_nt->valueAtIndex(index));}
-
-                        if (i == (InGrids_density.size() - 1))
-                        {
-                            int ni = itemOut_hits->valueAtIndex(index);
-                            int nt = itemOut_theoretical->valueAtIndex(index);
-                            int nb = itemOut_before->valueAtIndex(index);
-                            //qDebug() << "ni,nt,nb";
-                            int ntMnb = nt - nb;
-
-                            // Avoid division by 0
-                            if (ntMnb == 0 )
-                            {
-                                itemOut_density->setValueAtIndex(index, -1);
-                                if (use_deltaT) {itemOut_deltaT->setValueAtIndex(index, -1);}
-                            }
-                            // If there is an error (nb > nt)
-                            else if (ntMnb < 0 )
-                            {
-                                itemOut_density->setValueAtIndex(index, -2);
-                                if (use_deltaT) {itemOut_deltaT->setValueAtIndex(index, -2);}
-                            }
-                            // If there is not enough information
-                            else if (ntMnb < _effectiveRayThresh )
-                            {
-                                itemOut_density->setValueAtIndex(index, -3);
-                                if (use_deltaT) {itemOut_deltaT->setValueAtIndex(index, -3);}
-                            }
-                            // Normal case
-                            else
-                            {
-                                float density = (float) ni / ((float) ntMnb);
-                                itemOut_density->setValueAtIndex(index, density);
-                                if (use_deltaT) {
-                                    //TODO
-                                    qDebug() << "use_deltaT not implemented";
-                                    exit(1);
-                                }
-                            }
-
-                            if (ni > (nt - nb))
-                            {
-                                itemOut_density->setValueAtIndex(i, 1);
-                            }
+    LVOX_GridCombiner combiner((LVOX_GridCombiner::Mode)_mode, _effectiveRayThresh, _UseOnlyNotEmptyCellsIf_maxNt_Nb_div_Nt_selected);
 
-                        }
-                    }
-
-                    if (replace)
-                    {
-                        itemOut_density->setValueAtIndex(index, in_d->valueAtIndex(index));
+    if (!combiner.combine(inputs, outputs)) {qDebug() << "Configuration non prévue !"; return;}
+    qDebug() << "  Combined grids computed";
 
-                        if (use_ni) {itemOut_hits->setValueAtIndex(index, in_ni->valueAtIndex(index));}
-                        if (use_nt) {itemOut_theoretical->setValueAtIndex(index, in_nt->valueAtIndex(index));}
-                        if (use_nb) {itemOut_before->setValueAtIndex(index, in_nb->valueAtIndex(index));}
-                        if (use_deltaT) {itemOut_deltaT->setValueAtIndex(index, in_deltaT->valueAtIndex(index) * (float)in_nt->valueAtIndex(index));}
-                        itemOut_scanId->setValueAtIndex(index, i);
-
-                    }
-                   // qDebug() << "vox="<< xx << yy << zz;
-                }
-            }
-        }
-
-    }
-     if (use_deltaT)
-    {
-        qDebug() << " Building delta grid...";
-        for (size_t xx = 0 ; xx < xdim ; xx++)
-        {
-            for (size_t yy = 0 ; yy < ydim ; yy++)
-            {
-                for (size_t zz = 0 ; zz < zdim ; zz++)
-                {
-                    size_t index;
-                    itemOut_deltaT->index(xx, yy, zz, index);
-                    itemOut_deltaT->setValueAtIndex(index, itemOut_deltaT->valueAtIndex(index) / (float)itemOut_theoretical->valueAtIndex(index));
-                }
-            }
-        }
-    }
      //int invisible=0;
      double thres =0.1;
     if (dtm!=NULL) { // put an average density in unseen vox above ground
@@ -572,11 +431,7 @@ void LVOX2_StepCombineLvoxGrids::compute()
          //qDebug() << "Invisible points ="<<invisible;
     }
 
-    if (itemOut_hits!=NULL) {itemOut_hits->computeMinMax();}
-    if (itemOut_theoretical!=NULL) {itemOut_theoretical->computeMinMax();}
-    if (itemOut_before!=NULL) {itemOut_before->computeMinMax();}
-    if (itemOut_density!=NULL) {itemOut_density->computeMinMax();}
-    if (itemOut_deltaT!=NULL) {itemOut_deltaT->computeMinMax();}
-    if (itemOut_scanId!=NULL) {itemOut_scanId->computeMinMax();}
+    // hidden voxels may have been filled
+    if (dtm!=NULL) {itemOut_density->computeMinMax();}
     qDebug() << " Combination terminated";
 }
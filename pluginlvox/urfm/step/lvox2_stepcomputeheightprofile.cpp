@@ -25,7 +25,13 @@
 #define DEF_SearchInMNTGroup         "gmnt"
 #define DEF_SearchInMNT              "mnt"
 
+#include "tools/lvox_parallelfor.h"
+
 #include <math.h>
+#include <algorithm>
+
+// maximum memory used by the counts of the threads (the grid is cut in less blocks if needed)
+#define PROFILE_COUNTS_MAX_MEMORY 268435456
 
 // Constructor : initialization of parameters
 LVOX2_StepComputeHeightProfile::LVOX2_StepComputeHeightProfile(CT_StepInitializeData &dataInit) : CT_AbstractStep(dataInit)
@@ -112,6 +118,19 @@ void LVOX2_StepComputeHeightProfile::compute()
         }
     }
 
+    // thresholds of the profiles, in ascending order
+    QVector<double> thresholds;
+
+    if (_step > 0)
+    {
+        for (double threshold = _min ; threshold <= _max ; threshold += _step)
+        {
+            thresholds.append(threshold);
+        }
+    } else if (_min <= _max) {
+        thresholds.append(_min);
+    }
+
     CT_ResultGroup *outResult = getOutResultList().first();
 
     CT_ResultGroupIterator itGrp(outResult, this, DEF_groupIn_grids);
@@ -130,8 +149,110 @@ void LVOX2_StepComputeHeightProfile::compute()
             double zMinProfile = 0;
             if (dtm == NULL) {zMinProfile = inGrid->minZ();}
 
-            for (double threshold = _min ; threshold <= _max ; threshold += _step)
+            const size_t xdim = inGrid->xdim();
+            const size_t ydim = inGrid->ydim();
+            const size_t zdim = inGrid->zdim();
+            const size_t nColumns = xdim*ydim;
+            const int nThresholds = thresholds.size();
+
+            // height of the DTM (or bottom of the grid) for each column, read only one time per column
+            QVector<double> columnDTM(nColumns);
+
+            for (size_t yy = 0 ;  yy < ydim ; yy++)
+            {
+                for (size_t xx = 0 ;  xx < xdim ; xx++)
+                {
+                    double zDTM = inGrid->minZ();
+
+                    if (dtm != NULL)
+                    {
+                        zDTM = dtm->valueAtCoords(inGrid->getCellCenterX(xx), inGrid->getCellCenterY(yy));
+                    }
+
+                    columnDTM[yy*xdim + xx] = zDTM;
+                }
+            }
+
+            QVector<double> levelZ(zdim);
+
+            for (size_t zz = 0 ;  zz < zdim ; zz++)
+            {
+                levelZ[zz] = inGrid->getCellCenterZ(zz);
+            }
+
+            // One pass on the grid (in memory order, in parallel) : for each profile cell, count the voxels
+            // by number of thresholds exceeded by their value. The cumulative sum of these counts gives the
+            // number of voxels above each threshold, so all profiles are computed from this single pass.
+            const size_t matrixSize = zdim*nThresholds;
+            const size_t nBlocksMax = qMax((size_t)1, (size_t)PROFILE_COUNTS_MAX_MEMORY / qMax((size_t)1, matrixSize*sizeof(size_t)));
+            const size_t nCells = inGrid->nCells();
+
+            QVector<size_t> counts = LVOX_ParallelFor::reduce(0, nCells, QVector<size_t>(), [&](size_t begin, size_t end) {
+                QVector<size_t> blockCounts(matrixSize, 0);
+
+                size_t zz = begin / nColumns;
+                size_t column = begin - zz*nColumns;
+
+                for (size_t index = begin ; index < end ; ++index)
+                {
+                    const double zDTM = columnDTM.at(column);
+
+                    if (zDTM != NAval)
+                    {
+                        // same profile cell than addValueAtIndex(height) : the height is truncated, cells outside the profile are ignored
+                        const double height = levelZ.at(zz) - zDTM;
+
+                        if (height > -1.0 && height < (double)zdim)
+                        {
+                            const double value = inGrid->valueAtIndexAsDouble(index);
+
+                            // NaN exceeds no threshold (value > threshold is false)
+                            if (value == value)
+                            {
+                                const int nExceeded = std::lower_bound(thresholds.constBegin(), thresholds.constEnd(), value) - thresholds.constBegin();
+
+                                if (nExceeded > 0)
+                                {
+                                    ++blockCounts[((size_t)height)*nThresholds + nExceeded - 1];
+                                }
+                            }
+                        }
+                    }
+
+                    if (++column == nColumns)
+                    {
+                        column = 0;
+                        ++zz;
+                    }
+                }
+
+                return blockCounts;
+            }, [](const QVector<size_t>& a, const QVector<size_t>& b) {
+                if (a.isEmpty()) {return b;}
+
+                QVector<size_t> sum(a);
+
+                for (int i = 0 ; i < sum.size() ; ++i)
+                    sum[i] += b.at(i);
+
+                return sum;
+            }, qMax((size_t)16384, (nCells + nBlocksMax - 1) / nBlocksMax));
+
+            // counts[cell][t] = number of voxels of the cell with a value above the threshold t
+            for (size_t cell = 0 ; cell < zdim && !counts.isEmpty() ; cell++)
+            {
+                for (int t = nThresholds - 2 ; t >= 0 ; t--)
+                {
+                    counts[cell*nThresholds + t] += counts[cell*nThresholds + t + 1];
+                }
+            }
+
+            const double voxelVol = pow(inGrid->resolution(), 3);
+
+            for (int t = 0 ; t < nThresholds ; t++)
             {
+                const double threshold = thresholds.at(t);
+
                 CT_Profile<double>* outProfile = new CT_Profile<double>(_outProfile_ModelName.completeName(),
                                                                         outResult,
                                                                         (inGrid->maxX() + inGrid->minX()) / 2.0,
@@ -145,31 +266,13 @@ void LVOX2_StepComputeHeightProfile::compute()
                                                                         NAval,
                                                                         0.0);
 
-                double voxelVol = pow(inGrid->resolution(), 3);
-
-                // loop on z levels
-                for (size_t zz = 0 ;  zz < inGrid->zdim() ; zz++)
+                for (size_t cell = 0 ; cell < zdim && !counts.isEmpty() ; cell++)
                 {
-                    for (size_t yy = 0 ;  yy < inGrid->ydim() ; yy++)
-                    {
-                        for (size_t xx = 0 ;  xx < inGrid->xdim() ; xx++)
-                        {
-                            size_t index;
-                            inGrid->index(xx, yy, zz, index);
-                            double value = inGrid->valueAtIndexAsDouble(index);
+                    const size_t n = counts.at(cell*nThresholds + t);
 
-                            double zDTM = inGrid->minZ();
-
-                            if (dtm != NULL)
-                            {
-                                zDTM = dtm->valueAtCoords(inGrid->getCellCenterX(xx), inGrid->getCellCenterY(yy));
-                            }
-
-                            if (value > threshold && zDTM != NAval)
-                            {
-                                outProfile->addValueAtIndex(inGrid->getCellCenterZ(zz) - zDTM, voxelVol);
-                            }
-                        }
+                    if (n > 0)
+                    {
+                        outProfile->addValueAtIndex(cell, n*voxelVol);
                     }
                 }
 
@@ -49,6 +49,7 @@
 #include "tools/lvox_computetheoriticalsthread.h"
 #include "tools/lvox_computebeforethread.h"
 #include "tools/lvox_computedensitythread.h"
+#include "tools/lvox_threadscheduler.h"
 #include "urfm/tools/lvox2_computeactualbeamthread.h"
 #include "urfm/tools/lvox2_computehitsthread.h"
 #include "ct_iterator/ct_pointiterator.h"
@@ -201,8 +202,8 @@ void LVOX2_StepComputeLvoxGrids::compute()
     // Gets the out result
     CT_ResultGroup* outResult = getOutResultList().first();
 
-    QList<CT_MonitoredQThread*> baseThreads;
-    QList<CT_MonitoredQThread*> densityThreads;
+    // at most one thread per core, the density of a scan is computed as soon as the grids it uses are computed
+    LVOX_ThreadScheduler scheduler;
 
     QMap<CT_AbstractItemGroup*, QPair<const CT_Scene*, const CT_Scanner*> > pointsOfView;
 
@@ -456,34 +457,34 @@ void LVOX2_StepComputeLvoxGrids::compute()
         LVOX2_ComputeHitsThread* hitsThread = new LVOX2_ComputeHitsThread(scanner, hitGrid, deltaInGrid, deltaOutGrid, scene, _computeDistances, _cylindricFilter, xMin, xMax, yMin, yMax, zMin,zMax);
             connect(hitsThread, SIGNAL(progressChanged()), this, SLOT(updateProgress()));
         _threadList.append(hitsThread);
-        baseThreads.append(hitsThread);
+        scheduler.addThread(hitsThread);
 
         LVOX_ComputeBeforeThread* beforeThread = new LVOX_ComputeBeforeThread(scanner, beforeGrid, deltaBefore, scene, _computeDistances);
             connect(beforeThread, SIGNAL(progressChanged()), this, SLOT(updateProgress()));
         _threadList.append(beforeThread);
-        baseThreads.append(beforeThread);
+        scheduler.addThread(beforeThread);
 
         if (_ntMode==0) // Nt is theoritical (initial formulation)
         {
             LVOX_ComputeTheoriticalsThread* theoreticalThread = new LVOX_ComputeTheoriticalsThread(scanner, theoriticalGrid, deltaTheoritical, _computeDistances);
               connect(theoreticalThread, SIGNAL(progressChanged()), this, SLOT(updateProgress()));
             _threadList.append(theoreticalThread);
-            baseThreads.append(theoreticalThread);
+            scheduler.addThread(theoreticalThread);
 
             LVOX_ComputeDensityThread* densityThread = new LVOX_ComputeDensityThread(density, hitGrid, theoriticalGrid, beforeGrid, _effectiveRayThresh);
                 connect(densityThread, SIGNAL(progressChanged()), this, SLOT(updateProgress()));
             _threadList.append(densityThread);
-              densityThreads.append(densityThread);
+            scheduler.addThread(densityThread, QList<CT_MonitoredQThread*>() << hitsThread << beforeThread << theoreticalThread);
         } else if (_ntMode>=1) { // Nt is really computed (new formulation that requires that the scene contains the whole point cloud)
             LVOX2_ComputeActualBeamThread* actualBeamThread = new LVOX2_ComputeActualBeamThread(scanner, actualGrid, deltaActual, scene, _computeDistances);
             connect(actualBeamThread, SIGNAL(progressChanged()), this, SLOT(updateProgress()));
             _threadList.append(actualBeamThread);
-            baseThreads.append(actualBeamThread);
+            scheduler.addThread(actualBeamThread);
 
             LVOX_ComputeDensityThread* densityThread = new LVOX_ComputeDensityThread(density, hitGrid, actualGrid, beforeGrid, _effectiveRayThresh);
                 connect(densityThread, SIGNAL(progressChanged()), this, SLOT(updateProgress()));
             _threadList.append(densityThread);
-              densityThreads.append(densityThread);
+            scheduler.addThread(densityThread, QList<CT_MonitoredQThread*>() << hitsThread << beforeThread << actualBeamThread);
 
         }
         if (_ntMode==2) // Nt is theoritical (initial formulation)
@@ -491,7 +492,7 @@ void LVOX2_StepComputeLvoxGrids::compute()
             LVOX_ComputeTheoriticalsThread* theoreticalThread = new LVOX_ComputeTheoriticalsThread(scanner, theoriticalGrid, deltaTheoritical, _computeDistances);
                connect(theoreticalThread, SIGNAL(progressChanged()), this, SLOT(updateProgress()));
             _threadList.append(theoreticalThread);
-            baseThreads.append(theoreticalThread);
+            scheduler.addThread(theoreticalThread);
         }
 
 
@@ -499,44 +500,24 @@ void LVOX2_StepComputeLvoxGrids::compute()
 
     }
 
-    int size = baseThreads.size();
+    connect(this, SIGNAL(stopped()), &scheduler, SLOT(cancel()), Qt::DirectConnection);
 
-    for (int i = 0 ; i < size ; ++i)
-    {
-        baseThreads.at(i)->start();
-    }
+    scheduler.run();
 
-    for (int i = 0 ; i < size ; ++i)
+    if (!_threadList.isEmpty())
     {
-        baseThreads.at(i)->wait();
         updateProgress();
     }
 
-    for (int i = 0 ; i < size ; ++i)
-    {
-        disconnect(baseThreads.at(i), SIGNAL(progressChanged()), this, SLOT(updateProgress()));
-    }
-
-    size = densityThreads.size();
-
-    for (int i = 0 ; i < size ; ++i)
-    {
-        densityThreads.at(i)->start();
-
-    }
-
-    for (int i = 0 ; i < size ; ++i)
-    {
-        densityThreads.at(i)->wait();
-        updateProgress();
-    }
+    int size = _threadList.size();
 
     for (int i = 0 ; i < size ; ++i)
     {
-        disconnect(densityThreads.at(i), SIGNAL(progressChanged()), this, SLOT(updateProgress()));
+        disconnect(_threadList.at(i), SIGNAL(progressChanged()), this, SLOT(updateProgress()));
     }
 
     qDeleteAll(_threadList);
+    _threadList.clear();
 
 
 
@@ -43,6 +43,7 @@
 
 #include "ct_view/ct_stepconfigurabledialog.h"
 
+#include "tools/lvox_parallelfor.h"
 
 #include <math.h>
 
@@ -127,30 +128,31 @@ void LVOX2_StepFilterGridByRadius::compute()
             //CT_Grid3D<float>*   density = new CT_Grid3D<float>(_density_ModelName.completeName(), outResult, hitGrid->minX(), hitGrid->minY(), hitGrid->minZ(), hitGrid->xdim(), hitGrid->ydim(), hitGrid->zdim(), _res, -1, 0);
             //density->addItemAttribute(new CT_StdItemAttributeT<bool>(_DensityFlag_ModelName.completeName(), "LVOX_GRD_DENSITY", outResult, true));
 
-            outGrid->computeMinMax();
-           // qDebug() << "Filtering grid by radius:" << outGrid->dataMin() << outGrid->dataMax();
+            const double radius2 = _radius*_radius;
+            const size_t xdim = inGrid->xdim();
+            const size_t ydim = inGrid->ydim();
+
+            // the cells inside the radius only depend on x and y : one span per y index, shared by all z levels
+            QVector<RowSpan> spans(ydim);
 
-            // loop on z levels
-            for (size_t zz = 0 ;  zz < inGrid->zdim() ; zz++)
+            for (size_t yy = 0 ;  yy < ydim ; yy++)
             {
-                for (size_t yy = 0 ;  yy < inGrid->ydim() ; yy++)
+                spans[yy] = rowSpan(inGrid, yy, _centerX, _centerY, radius2);
+            }
+
+            // rows (yy, zz) are filtered in parallel, only the cells of the span are copied (others keep the value 0 of the initialisation)
+            LVOX_ParallelFor::run(0, ydim*inGrid->zdim(), [inGrid, outGrid, &spans, xdim, ydim](size_t begin, size_t end) {
+                for (size_t row = begin ; row < end ; ++row)
                 {
-                    for (size_t xx = 0 ;  xx < inGrid->xdim() ; xx++)
+                    const RowSpan& span = spans.at(row % ydim);
+                    const size_t rowIndex = row*xdim;
+
+                    for (size_t xx = span.first ;  xx < span.end ; xx++)
                     {
-                        size_t index;
-                        inGrid->index(xx, yy, zz, index);
-                        double value = inGrid->valueAtIndexAsDouble(index);
-                          //qDebug() << "Filtering grid by radius=" << value;
-                          double dist2 = pow(inGrid->getCellCenterX(xx) - _centerX, 2.0) + pow(inGrid->getCellCenterY(yy) - _centerY,2.0);
-                        if (dist2 < pow(_radius, 2.0))
-                        {
-                            outGrid->setValueAtIndex(index, value);
-                        } else {
-                            outGrid->setValueAtIndex(index, 0.f);
-                        }
+                        outGrid->setValueAtIndex(rowIndex + xx, inGrid->valueAtIndexAsDouble(rowIndex + xx));
                     }
                 }
-            }
+            }, qMax((size_t)1, (size_t)16384 / qMax((size_t)1, xdim)));
 
             outGrid->computeMinMax();
             qDebug() << "Filtering grid by radius:" << outGrid->dataMin() << outGrid->dataMax();
@@ -161,4 +163,44 @@ void LVOX2_StepFilterGridByRadius::compute()
     setProgress(99);
 }
 
+LVOX2_StepFilterGridByRadius::RowSpan LVOX2_StepFilterGridByRadius::rowSpan(const CT_AbstractGrid3D* grid, size_t yy, double centerX, double centerY, double radius2)
+{
+    RowSpan span;
+    span.first = 0;
+    span.end = 0;
+
+    const size_t xdim = grid->xdim();
+    const double dy = grid->getCellCenterY(yy) - centerY;
+    const double dy2 = dy*dy;
+
+    if (xdim == 0 || dy2 >= radius2)
+        return span;
+
+    // centers of the cells at a distance of the center lower than the half chord
+    const double halfChord = sqrt(radius2 - dy2);
+    const double res = grid->resolution();
+    const double firstX = ceil((centerX - halfChord - grid->minX()) / res - 0.5);
+    const double endX = floor((centerX + halfChord - grid->minX()) / res - 0.5) + 1.0;
+
+    span.first = (size_t)qBound(0.0, firstX, (double)xdim);
+    span.end = (size_t)qBound(0.0, endX, (double)xdim);
+
+    // the rounding of the computation can shift a bound of one cell
+    while (span.first > 0 && isInside(grid, span.first - 1, centerX, dy2, radius2)) {--span.first;}
+    while (span.first < xdim && !isInside(grid, span.first, centerX, dy2, radius2)) {++span.first;}
+    while (span.end < xdim && isInside(grid, span.end, centerX, dy2, radius2)) {++span.end;}
+    while (span.end > span.first && !isInside(grid, span.end - 1, centerX, dy2, radius2)) {--span.end;}
+
+    if (span.end < span.first)
+        span.end = span.first;
+
+    return span;
+}
+
+bool LVOX2_StepFilterGridByRadius::isInside(const CT_AbstractGrid3D* grid, size_t xx, double centerX, double dy2, double radius2)
+{
+    const double dx = grid->getCellCenterX(xx) - centerX;
+    return (dx*dx + dy2) < radius2;
+}
+
 
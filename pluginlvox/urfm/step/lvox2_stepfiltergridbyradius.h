@@ -74,6 +74,22 @@ public:
     */
     virtual CT_VirtualAbstractStep* createNewInstance(CT_StepInitializeData &dataInit);
 
+    /**
+     * @brief Cells [first;end[ of a row of the grid (along x) that are inside the radius
+     */
+    struct RowSpan {
+        size_t first;
+        size_t end;
+    };
+
+    /**
+     * @brief Returns the span of the cells inside the circle (centerX, centerY, radius2 = radius*radius) for
+     *        the rows at the y index "yy" (it is the same for all z levels). The bounds are computed from the
+     *        equation of the circle then adjusted with the test of the cells so the span is exactly the cells
+     *        with dist2 < radius2.
+     */
+    static RowSpan rowSpan(const CT_AbstractGrid3D* grid, size_t yy, double centerX, double centerY, double radius2);
+
 protected:
     /*!
     *  \brief Creates the input of this step
@@ -116,6 +132,8 @@ protected:
 
 private:
 
+    static bool isInside(const CT_AbstractGrid3D* grid, size_t xx, double centerX, double dy2, double radius2);
+
     double  _centerX;
     double  _centerY;
     double  _radius;
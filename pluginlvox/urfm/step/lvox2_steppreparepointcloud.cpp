@@ -5,6 +5,7 @@
 #include "ct_global/ct_context.h"
 
 #include "ct_view/ct_stepconfigurabledialog.h"
+#include "ct_result/model/inModel/ct_inresultmodelgroup.h"
 #include "ct_result/model/inModel/ct_inresultmodelgrouptocopy.h"
 #include "ct_result/model/outModel/ct_outresultmodelgroupcopy.h"
 #include "ct_result/model/outModel/tools/ct_outresultmodelgrouptocopypossibilities.h"
@@ -15,17 +16,42 @@
 
 // Inclusion of used ItemDrawable classes
 #include "ct_itemdrawable/ct_scene.h"
+#include "ct_itemdrawable/ct_scanner.h"
+#include "ct_itemdrawable/ct_image2d.h"
 
 #include "ct_itemdrawable/ct_pointsattributesscalartemplated.h"
+#include "ct_itemdrawable/abstract/ct_abstractpointattributesscalar.h"
+#include "ct_iterator/ct_resultitemiterator.h"
+
+#include "urfm/tools/lvox2_pointflagger.h"
 
 // Alias for indexing in models
 #define DEF_SearchInResult "inputResult"
 #define DEF_SearchInGroup "inputSceneGrp"
 #define DEF_itemIn_scene "inputScene"
+#define DEF_itemIn_scanner "inputScanner"
+#define DEF_itemIn_intensity "inputIntensity"
+
+#define DEF_SearchInMNTResult        "rmnt"
+#define DEF_SearchInMNTGroup         "gmnt"
+#define DEF_SearchInMNT              "mnt"
 
 // Constructor : initialization of parameters
 LVOX2_StepPreparePointCloud::LVOX2_StepPreparePointCloud(CT_StepInitializeData &dataInit) : CT_AbstractStep(dataInit)
 {
+    _usePositiveX = true;
+
+    _useHeight = false;
+    _minHeight = 0;
+    _maxHeight = 100;
+
+    _useDistance = false;
+    _minDistance = 0;
+    _maxDistance = 100;
+
+    _useIntensity = false;
+    _minIntensity = 0;
+    _maxIntensity = 65535;
 }
 
 // Step description (tooltip of contextual menu)
@@ -49,6 +75,15 @@ void LVOX2_StepPreparePointCloud::createInResultModelListProtected()
     resultInModel->setZeroOrMoreRootGroup();
     resultInModel->addGroupModel("", DEF_SearchInGroup);
     resultInModel->addItemModel(DEF_SearchInGroup, DEF_itemIn_scene, CT_Scene::staticGetType(),tr("Scene"));
+    resultInModel->addItemModel(DEF_SearchInGroup, DEF_itemIn_scanner, CT_Scanner::staticGetType(), tr("Scanner"), "", CT_InAbstractModel::C_ChooseOneIfMultiple, CT_InAbstractModel::F_IsOptional);
+    resultInModel->addItemModel(DEF_SearchInGroup, DEF_itemIn_intensity, CT_AbstractPointAttributesScalar::staticGetType(), tr("Intensité"), "", CT_InAbstractModel::C_ChooseOneIfMultiple, CT_InAbstractModel::F_IsOptional);
+
+    // MNT
+    CT_InResultModelGroup* resultModelMNT = createNewInResultModel(DEF_SearchInMNTResult, tr("MNT (Raster)"), "", true);
+    resultModelMNT->setZeroOrMoreRootGroup();
+    resultModelMNT->addGroupModel("", DEF_SearchInMNTGroup);
+    resultModelMNT->addItemModel(DEF_SearchInMNTGroup, DEF_SearchInMNT, CT_Image2D<float>::staticGetType(), tr("Modèle Numérique de Terrain"));
+    resultModelMNT->setMinimumNumberOfPossibilityThatMustBeSelectedForOneTurn(0);
 }
 
 // Creation and affiliation of OUT models
@@ -65,46 +100,79 @@ void LVOX2_StepPreparePointCloud::createOutResultModelListProtected()
 // Semi-automatic creation of step parameters DialogBox
 void LVOX2_StepPreparePointCloud::createPostConfigurationDialog()
 {
-    // No dialog box
+    CT_StepConfigurableDialog *configDialog = newStandardPostConfigurationDialog();
+
+    configDialog->addTitle(tr("Un point a le flag 1 s'il respecte tous les critères cochés, 0 sinon"));
+    configDialog->addBool(tr("X positif"), "", "", _usePositiveX);
+    configDialog->addEmpty();
+    configDialog->addBool(tr("Hauteur au-dessus du MNT"), "", "", _useHeight);
+    configDialog->addDouble(tr("    -> Hauteur minimum"), "m", -99999, 99999, 2, _minHeight);
+    configDialog->addDouble(tr("    -> Hauteur maximum"), "m", -99999, 99999, 2, _maxHeight);
+    configDialog->addEmpty();
+    configDialog->addBool(tr("Distance au scanner"), "", "", _useDistance);
+    configDialog->addDouble(tr("    -> Distance minimum"), "m", 0, 99999, 2, _minDistance);
+    configDialog->addDouble(tr("    -> Distance maximum"), "m", 0, 99999, 2, _maxDistance);
+    configDialog->addEmpty();
+    configDialog->addBool(tr("Intensité"), "", "", _useIntensity);
+    configDialog->addDouble(tr("    -> Intensité minimum"), "", -1e+10, 1e+10, 2, _minIntensity);
+    configDialog->addDouble(tr("    -> Intensité maximum"), "", -1e+10, 1e+10, 2, _maxIntensity);
 }
 
 void LVOX2_StepPreparePointCloud::compute()
 {
+    CT_Image2D<float>* dtm = NULL;
+    if (_useHeight && getInputResults().size() > 1)
+    {
+        CT_ResultItemIterator itMNT(getInputResults().at(1), this, DEF_SearchInMNT);
+        if(itMNT.hasNext())
+        {
+            dtm = (CT_Image2D<float>*)itMNT.next();
+        }
+    }
+
+    if (_useHeight && dtm == NULL) {PS_LOG->addMessage(LogInterface::warning, LogInterface::step, tr("Pas de MNT : le critère de hauteur est ignoré"));}
+
     CT_ResultGroup* outResult = getOutResultList().first();
 
     CT_ResultGroupIterator itOut(outResult, this, DEF_SearchInGroup);
     // iterate over all groups
-    while(itOut.hasNext())
+    while(itOut.hasNext() && (!isStopped()))
     {
         CT_StandardItemGroup *group = (CT_StandardItemGroup*)itOut.next();
         const CT_Scene* scene = (const CT_Scene*)group->firstItemByINModelName(this, DEF_itemIn_scene);
 
         if(scene != NULL)
         {
+            const CT_Scanner* scanner = (const CT_Scanner*)group->firstItemByINModelName(this, DEF_itemIn_scanner);
+            const CT_AbstractPointAttributesScalar* intensity = (const CT_AbstractPointAttributesScalar*)group->firstItemByINModelName(this, DEF_itemIn_intensity);
             const CT_AbstractPointCloudIndex* pointCloudIndex = scene->getPointCloudIndex();
             size_t nbPoints = pointCloudIndex->size();
-            CT_StandardCloudStdVectorT<int> *attributes = new CT_StandardCloudStdVectorT<int>(nbPoints);
-            int minVal = std::numeric_limits<int>::max();
-            int maxVal = -std::numeric_limits<int>::max();
 
-            size_t cpt = 0;
-            CT_PointIterator itP(pointCloudIndex);
-            while(itP.hasNext() && (!isStopped()))
-            {
-                const CT_Point &point = itP.next().currentPoint();
+            // all the criteria are evaluated in the same pass on the points
+            LVOX2_PointFlagger flagger;
 
-                int flagVal = 0;
-                if (point(0) > 0)
-                {
-                    flagVal = 1;
-                }
+            if (_usePositiveX) {flagger.addPredicate(new LVOX2_PointFlagger::PositiveX());}
+            if (_useHeight && dtm != NULL) {flagger.addPredicate(new LVOX2_PointFlagger::HeightAboveDTM(dtm, _minHeight, _maxHeight));}
 
-                if (flagVal < minVal) {minVal = flagVal;}
-                if (flagVal > maxVal) {maxVal = flagVal;}
+            if (_useDistance)
+            {
+                if (scanner != NULL) {flagger.addPredicate(new LVOX2_PointFlagger::DistanceToScanner(scanner->getCenterX(), scanner->getCenterY(), scanner->getCenterZ(), _minDistance, _maxDistance));}
+                else {PS_LOG->addMessage(LogInterface::warning, LogInterface::step, tr("Pas de scanner : le critère de distance est ignoré"));}
+            }
 
-                (*attributes)[cpt++] = flagVal;
+            if (_useIntensity)
+            {
+                // the intensity of a point is read at its position in the index of the scene
+                if (intensity == NULL) {PS_LOG->addMessage(LogInterface::warning, LogInterface::step, tr("Pas d'intensité : le critère d'intensité est ignoré"));}
+                else if (intensity->attributesSize() != nbPoints) {PS_LOG->addMessage(LogInterface::warning, LogInterface::step, tr("L'intensité n'a pas autant de valeurs que la scène a de points (%1 / %2) : le critère d'intensité est ignoré").arg(intensity->attributesSize()).arg(nbPoints));}
+                else {flagger.addPredicate(new LVOX2_PointFlagger::IntensityWindow(intensity, _minIntensity, _maxIntensity));}
             }
 
+            CT_StandardCloudStdVectorT<int> *attributes = new CT_StandardCloudStdVectorT<int>(nbPoints);
+            int minVal, maxVal;
+
+            flagger.compute(pointCloudIndex, attributes, minVal, maxVal, [this]() { return isStopped(); });
+
             CT_PointsAttributesScalarTemplated<int> *attributesItem = new CT_PointsAttributesScalarTemplated<int>(_outFlagAttribute_ModelName.completeName(),
                                                                                                                outResult,
                                                                                                                scene->getPointCloudIndexRegistered(),
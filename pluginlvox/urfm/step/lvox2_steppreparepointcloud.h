@@ -59,6 +59,19 @@ protected:
 private:
 
     // Step parameters
+    bool    _usePositiveX;      /*!< flag points with x > 0 (historical criterion) */
+
+    bool    _useHeight;         /*!< flag points with a height above the DTM in [_minHeight;_maxHeight] */
+    double  _minHeight;
+    double  _maxHeight;
+
+    bool    _useDistance;       /*!< flag points with a distance to the scanner in [_minDistance;_maxDistance] */
+    double  _minDistance;
+    double  _maxDistance;
+
+    bool    _useIntensity;      /*!< flag points with an intensity in [_minIntensity;_maxIntensity] */
+    double  _minIntensity;
+    double  _maxIntensity;
 
     CT_AutoRenameModels _outFlagAttribute_ModelName;
 };
@@ -1,8 +1,7 @@
 #include "lvox2_computeactualbeamthread.h"
-#include "ct_itemdrawable/ct_beam.h"
-#include "ct_itemdrawable/tools/gridtools/ct_grid3dwootraversalalgorithm.h"
-#include "tools/lvox_distancevisitor.h"
-#include "tools/lvox_countvisitor.h"
+#include "mk/tools/traversal/woo/lvox3_grid3dwootraversalalgorithm.h"
+#include "mk/tools/traversal/woo/visitor/lvox3_countvisitor.h"
+#include "mk/tools/traversal/woo/visitor/lvox3_distancevisitor.h"
 #include "ct_pointcloudindex/abstract/ct_abstractpointcloudindex.h"
 #include "ct_iterator/ct_pointiterator.h"
 
@@ -26,26 +25,24 @@ void LVOX2_ComputeActualBeamThread::run()
     const CT_AbstractPointCloudIndex *pointCloudIndex = _scene->getPointCloudIndex();
     size_t n_points = pointCloudIndex->size();
 
-    Eigen::Vector3d bot, top;
-    _outputActualBeamGrid->getMinCoordinates(bot);
-    _outputActualBeamGrid->getMaxCoordinates(top);
+    const Eigen::Vector3d scannerPosition = _scanner->getPosition();
 
     // Creates visitors
-    QList<CT_AbstractGrid3DBeamVisitor*> list;
+    QVector<LVOX3_Grid3DVoxelWooVisitor*> list;
 
-    LVOX_CountVisitor countVisitor(_outputActualBeamGrid);
+    LVOX3_CountVisitor<int> countVisitor(_outputActualBeamGrid);
     list.append(&countVisitor);
 
+    // declared here because the algorithm keeps a pointer on it
+    LVOX3_DistanceVisitor<float> distVisitor(_computeDistance ? _outputDeltaActualBeamGrid : NULL);
+
     if (_computeDistance)
     {
-        LVOX_DistanceVisitor distVisitor(_outputDeltaActualBeamGrid);
         list.append(&distVisitor);
     }
 
-    // Creates traversal algorithm
-    CT_Grid3DWooTraversalAlgorithm algo(_outputActualBeamGrid, false, list);
-
-    CT_Beam beam(NULL, NULL);
+    // Creates traversal algorithm (shared with LVOX3 steps)
+    LVOX3_Grid3DWooTraversalAlgorithm<int> algo(_outputActualBeamGrid, false, list);
 
     size_t progressStep = n_points / 20;
     size_t i = 0;
@@ -56,14 +53,11 @@ void LVOX2_ComputeActualBeamThread::run()
         ++i;
         const CT_Point &point = itP.next().currentPoint();
 
-        // Get the next ray
-        beam.setOrigin(_scanner->getPosition());
-        beam.setDirection(point-_scanner->getPosition());
+        // Get the next ray (direction normalized as CT_Beam did)
+        const Eigen::Vector3d direction = (point - scannerPosition).normalized();
 
-        if (beam.intersect(bot, top))
-        {
-            algo.compute(beam);
-        }
+        // rays that miss the grid are ignored by the algorithm
+        algo.compute(scannerPosition, direction);
 
         if (i % progressStep == 0)
         {
@@ -0,0 +1,166 @@
+#include "lvox2_pointflagger.h"
+
+#include "ct_accessor/ct_pointaccessor.h"
+
+#include "tools/lvox_parallelfor.h"
+
+#include <limits>
+
+namespace {
+    struct FlagRange {
+        FlagRange() : min(std::numeric_limits<int>::max()), max(-std::numeric_limits<int>::max()) {}
+
+        int min;
+        int max;
+
+        static FlagRange merge(const FlagRange& a, const FlagRange& b)
+        {
+            FlagRange r;
+            r.min = qMin(a.min, b.min);
+            r.max = qMax(a.max, b.max);
+            return r;
+        }
+    };
+}
+
+void LVOX2_PointFlagger::PositiveX::evaluate(const Chunk& chunk, int* accepted) const
+{
+    for(size_t i = 0 ; i < chunk.n ; ++i)
+        accepted[i] &= (chunk.x[i] > 0) ? 1 : 0;
+}
+
+LVOX2_PointFlagger::HeightAboveDTM::HeightAboveDTM(const CT_Image2D<float>* dtm, double min, double max)
+{
+    m_dtm = dtm;
+    m_min = min;
+    m_max = max;
+}
+
+void LVOX2_PointFlagger::HeightAboveDTM::evaluate(const Chunk& chunk, int* accepted) const
+{
+    const float na = m_dtm->NA();
+
+    for(size_t i = 0 ; i < chunk.n ; ++i)
+    {
+        const float zDTM = m_dtm->valueAtCoords(chunk.x[i], chunk.y[i]);
+        const double h = chunk.z[i] - zDTM;
+
+        accepted[i] &= ((zDTM != na) & (h >= m_min) & (h <= m_max)) ? 1 : 0;
+    }
+}
+
+LVOX2_PointFlagger::DistanceToScanner::DistanceToScanner(double scannerX, double scannerY, double scannerZ, double min, double max)
+{
+    m_x = scannerX;
+    m_y = scannerY;
+    m_z = scannerZ;
+    m_min2 = (min > 0) ? min*min : 0;
+    m_max2 = max*max;
+}
+
+void LVOX2_PointFlagger::DistanceToScanner::evaluate(const Chunk& chunk, int* accepted) const
+{
+    for(size_t i = 0 ; i < chunk.n ; ++i)
+    {
+        const double dx = chunk.x[i] - m_x;
+        const double dy = chunk.y[i] - m_y;
+        const double dz = chunk.z[i] - m_z;
+        const double d2 = dx*dx + dy*dy + dz*dz;
+
+        accepted[i] &= ((d2 >= m_min2) & (d2 <= m_max2)) ? 1 : 0;
+    }
+}
+
+LVOX2_PointFlagger::IntensityWindow::IntensityWindow(const CT_AbstractPointAttributesScalar* intensity, double min, double max)
+{
+    m_intensity = intensity;
+    m_min = min;
+    m_max = max;
+}
+
+void LVOX2_PointFlagger::IntensityWindow::evaluate(const Chunk& chunk, int* accepted) const
+{
+    for(size_t i = 0 ; i < chunk.n ; ++i)
+    {
+        const double intensity = m_intensity->dValueAt(chunk.first + i);
+
+        accepted[i] &= ((intensity >= m_min) & (intensity <= m_max)) ? 1 : 0;
+    }
+}
+
+LVOX2_PointFlagger::LVOX2_PointFlagger()
+{
+}
+
+LVOX2_PointFlagger::~LVOX2_PointFlagger()
+{
+    qDeleteAll(m_predicates);
+}
+
+void LVOX2_PointFlagger::addPredicate(Predicate* predicate)
+{
+    if(predicate != NULL)
+        m_predicates.append(predicate);
+}
+
+int LVOX2_PointFlagger::nPredicates() const
+{
+    return m_predicates.size();
+}
+
+void LVOX2_PointFlagger::compute(const CT_AbstractPointCloudIndex* pointCloudIndex,
+                                 CT_StandardCloudStdVectorT<int>* flags,
+                                 int& minVal,
+                                 int& maxVal,
+                                 std::function<bool()> stop) const
+{
+    const QList<Predicate*>& predicates = m_predicates;
+
+    // the predicates must not modify the flagger, so the blocks only share constant data
+    const FlagRange range = LVOX_ParallelFor::reduce(0, pointCloudIndex->size(), FlagRange(), [pointCloudIndex, flags, &predicates, &stop](size_t begin, size_t end) {
+        CT_PointAccessor accessor;
+        double x[CHUNK_SIZE];
+        double y[CHUNK_SIZE];
+        double z[CHUNK_SIZE];
+        int accepted[CHUNK_SIZE];
+        FlagRange r;
+
+        for(size_t first = begin ; first < end ; first += CHUNK_SIZE)
+        {
+            if(stop && stop())
+                break;
+
+            Chunk chunk;
+            chunk.first = first;
+            chunk.n = qMin(end - first, (size_t)CHUNK_SIZE);
+            chunk.x = x;
+            chunk.y = y;
+            chunk.z = z;
+
+            for(size_t i = 0 ; i < chunk.n ; ++i)
+            {
+                const CT_Point& point = accessor.constPointAt(pointCloudIndex->indexAt(first + i));
+
+                x[i] = point(0);
+                y[i] = point(1);
+                z[i] = point(2);
+                accepted[i] = 1;
+            }
+
+            for(int p = 0 ; p < predicates.size() ; ++p)
+                predicates.at(p)->evaluate(chunk, accepted);
+
+            for(size_t i = 0 ; i < chunk.n ; ++i)
+            {
+                r.min = qMin(r.min, accepted[i]);
+                r.max = qMax(r.max, accepted[i]);
+                (*flags)[first + i] = accepted[i];
+            }
+        }
+
+        return r;
+    }, &FlagRange::merge);
+
+    minVal = range.min;
+    maxVal = range.max;
+}
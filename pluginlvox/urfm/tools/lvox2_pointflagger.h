@@ -0,0 +1,135 @@
+#ifndef LVOX2_POINTFLAGGER_H
+#define LVOX2_POINTFLAGGER_H
+
+#include "ct_cloudindex/abstract/ct_abstractpointcloudindex.h"
+#include "ct_cloud/ct_standardcloudstdvectort.h"
+#include "ct_itemdrawable/ct_image2d.h"
+#include "ct_itemdrawable/abstract/ct_abstractpointattributesscalar.h"
+
+#include <QList>
+
+#include <functional>
+
+/*!
+ * \brief Compute a flag for each point of a cloud in one pass: 1 if the point is accepted by all the
+ *        predicates, 0 otherwise.
+ *
+ * The cloud is cut in blocks processed in parallel. The coordinates of each block are copied by chunks
+ * of CHUNK_SIZE points in small arrays (x, y, z) and each predicate is evaluated on the whole chunk, so
+ * the loop of a predicate is short, without virtual calls, and can be vectorized by the compiler.
+ *
+ * To add a criterion, inherit LVOX2_PointFlagger::Predicate and add an instance with addPredicate().
+ */
+class LVOX2_PointFlagger
+{
+public:
+    static const size_t CHUNK_SIZE = 256;
+
+    /**
+     * @brief Points of a chunk. "first" is the index of the first point in the point cloud index (local index).
+     */
+    struct Chunk {
+        size_t          first;
+        size_t          n;
+        const double*   x;
+        const double*   y;
+        const double*   z;
+    };
+
+    class Predicate
+    {
+    public:
+        virtual ~Predicate() {}
+
+        /**
+         * @brief Set accepted[i] to 0 for points of the chunk that are not accepted (other values must not be modified)
+         */
+        virtual void evaluate(const Chunk& chunk, int* accepted) const = 0;
+    };
+
+    /**
+     * @brief Accept points with x > 0
+     */
+    class PositiveX : public Predicate
+    {
+    public:
+        void evaluate(const Chunk& chunk, int* accepted) const;
+    };
+
+    /**
+     * @brief Accept points with a height above the DTM in [min;max]. Points outside the DTM are rejected.
+     */
+    class HeightAboveDTM : public Predicate
+    {
+    public:
+        HeightAboveDTM(const CT_Image2D<float>* dtm, double min, double max);
+
+        void evaluate(const Chunk& chunk, int* accepted) const;
+
+    private:
+        const CT_Image2D<float>*    m_dtm;
+        double                      m_min;
+        double                      m_max;
+    };
+
+    /**
+     * @brief Accept points with a distance to the scanner in [min;max]
+     */
+    class DistanceToScanner : public Predicate
+    {
+    public:
+        DistanceToScanner(double scannerX, double scannerY, double scannerZ, double min, double max);
+
+        void evaluate(const Chunk& chunk, int* accepted) const;
+
+    private:
+        double  m_x;
+        double  m_y;
+        double  m_z;
+        double  m_min2;
+        double  m_max2;
+    };
+
+    /**
+     * @brief Accept points with an intensity in [min;max]. The attribute must be indexed like the point cloud index.
+     */
+    class IntensityWindow : public Predicate
+    {
+    public:
+        IntensityWindow(const CT_AbstractPointAttributesScalar* intensity, double min, double max);
+
+        void evaluate(const Chunk& chunk, int* accepted) const;
+
+    private:
+        const CT_AbstractPointAttributesScalar* m_intensity;
+        double                                  m_min;
+        double                                  m_max;
+    };
+
+    LVOX2_PointFlagger();
+    ~LVOX2_PointFlagger();
+
+    /**
+     * @brief Add a predicate (the flagger takes the ownership)
+     */
+    void addPredicate(Predicate* predicate);
+
+    int nPredicates() const;
+
+    /**
+     * @brief Compute the flag of each point of the cloud index and the min and the max of the flags
+     * @param stop : called between chunks, if it returns true the pass is stopped (flags not computed stay at 0)
+     */
+    void compute(const CT_AbstractPointCloudIndex* pointCloudIndex,
+                 CT_StandardCloudStdVectorT<int>* flags,
+                 int& minVal,
+                 int& maxVal,
+                 std::function<bool()> stop = std::function<bool()>()) const;
+
+private:
+    Q_DISABLE_COPY(LVOX2_PointFlagger)
+
+    QList<Predicate*>   m_predicates;
+};
+
+#endif // LVOX2_POINTFLAGGER_H
@@ -0,0 +1,690 @@
+/*
+ * Benchmarks of the LVOX3 kernels on reproducible synthetic inputs.
+ *
+ * Usage : bench_lvox3_kernels [--quick] [--seed N] [--angular-resolution DEG]
+ *                             [--resolutions R1,R2,...] [--min-time S]
+ *                             [--filter TEXT] [--out FILE.json]
+ *
+ * Every benchmark is repeated until it has run at least --min-time seconds (and at
+ * least 3 times). The best and the mean time of one iteration are reported with the
+ * throughput computed from the best time. With --out the results are written in a
+ * JSON file using the field names of Google Benchmark ("context", "benchmarks",
+ * "real_time", "items_per_second", ...) so the usual comparison scripts can be used.
+ *
+ * The peak RSS is the peak of the whole process (it is reached by the biggest grids).
+ */
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QThread>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QScopedPointer>
+#include <QTextStream>
+
+#include <functional>
+#include <random>
+#include <limits>
+#include <cmath>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+#ifdef Q_OS_LINUX
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "ct_global/ct_context.h"
+#include "ct_iterator/ct_mutablepointiterator.h"
+#include "ct_itemdrawable/tools/scanner/ct_thetaphishootingpattern.h"
+
+#include "mk/tools/lvox3_gridtype.h"
+#include "mk/tools/lvox3_errorcode.h"
+#include "mk/tools/lvox3_genericconfiguration.h"
+#include "mk/tools/lvox3_pointstaging.h"
+#include "mk/tools/lvox3_mortonorder.h"
+#include "mk/tools/lvox3_compactcountgrid.h"
+#include "mk/tools/traversal/woo/lvox3_grid3dwootraversalalgorithm.h"
+#include "mk/tools/traversal/woo/visitor/lvox3_countvisitor.h"
+#include "mk/tools/worker/lvox3_computeall.h"
+#include "mk/tools/worker/lvox3_computehits.h"
+#include "mk/tools/worker/lvox3_computetheoriticals.h"
+#include "mk/tools/worker/lvox3_computebefore.h"
+#include "mk/tools/worker/lvox3_computedensity.h"
+#include "mk/tools/worker/lvox3_genericcompute.h"
+#include "mk/tools/worker/lvox3_interpolatedistance.h"
+#include "mk/tools/worker/lvox3_interpolatetrustfactor.h"
+
+namespace {
+
+const double TWO_PI = 6.283185307179586;
+
+struct BenchOptions {
+    BenchOptions() : quick(false), seed(42), angularResolution(0.1), minTime(0.5) {
+        resolutions << 0.5 << 0.25 << 0.1;
+    }
+
+    bool            quick;
+    quint32         seed;
+    double          angularResolution;  /*!< in degrees */
+    QList<double>   resolutions;
+    double          minTime;            /*!< in seconds */
+    QString         filter;
+    QString         output;
+};
+
+struct BenchResult {
+    QString     name;
+    QString     unit;
+    double      itemsPerIteration;
+    int         iterations;
+    double      bestSeconds;
+    double      meanSeconds;
+    double      cacheMisses;    /*!< mean per iteration, < 0 if not available */
+};
+
+/**
+ * @brief Hardware counter of the cache misses (last level) of the calling thread. Only on Linux
+ *        when perf events are allowed (see /proc/sys/kernel/perf_event_paranoid).
+ */
+class CacheMissCounter
+{
+public:
+    CacheMissCounter() : m_fd(-1)
+    {
+#ifdef Q_OS_LINUX
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        m_fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+    }
+
+    ~CacheMissCounter()
+    {
+#ifdef Q_OS_LINUX
+        if(m_fd >= 0)
+            close(m_fd);
+#endif
+    }
+
+    bool isValid() const { return m_fd >= 0; }
+
+    void start()
+    {
+#ifdef Q_OS_LINUX
+        if(m_fd >= 0) {
+            ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    /**
+     * @brief Returns the number of misses since start() (-1 if not available)
+     */
+    qint64 stop()
+    {
+#ifdef Q_OS_LINUX
+        long long count = 0;
+
+        if((m_fd >= 0)
+                && (ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0) == 0)
+                && (read(m_fd, &count, sizeof(count)) == sizeof(count)))
+            return count;
+#endif
+        return -1;
+    }
+
+private:
+    int m_fd;
+
+    Q_DISABLE_COPY(CacheMissCounter)
+};
+
+/**
+ * @brief Peak resident set size of the process in kB (-1 if unknown)
+ */
+qint64 peakRSSkB()
+{
+#ifdef Q_OS_UNIX
+    struct rusage usage;
+
+    if(getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef Q_OS_MAC
+        return usage.ru_maxrss / 1024; // bytes on macOS
+#else
+        return usage.ru_maxrss;
+#endif
+    }
+#endif
+    return -1;
+}
+
+/**
+ * @brief Synthetic forest plot : a sloped ground, trunks (cylinders) and crowns (ellipsoids).
+ *        The cloud is created in the global point cloud so the workers can use it.
+ */
+class SyntheticForest
+{
+public:
+    SyntheticForest(quint32 seed, double plotSize, int nTrees, size_t pointsPerTree, size_t groundPoints)
+    {
+        m_plotSize = plotSize;
+        m_maxHeight = 0;
+
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+        struct Tree { double x, y, height, radius; };
+        QVector<Tree> trees(nTrees);
+
+        for(int t = 0 ; t < nTrees ; ++t) {
+            trees[t].x = (unit(rng) - 0.5) * plotSize * 0.9;
+            trees[t].y = (unit(rng) - 0.5) * plotSize * 0.9;
+            trees[t].height = 8.0 + unit(rng) * 14.0;
+            trees[t].radius = 0.1 + unit(rng) * 0.25;
+            m_maxHeight = qMax(m_maxHeight, trees[t].height + groundZ(trees[t].x));
+        }
+
+        const size_t nPoints = groundPoints + nTrees * pointsPerTree;
+
+        m_pcir = PS_REPOSITORY->createNewPointCloud(nPoints);
+
+        CT_MutablePointIterator it(m_pcir);
+        CT_Point p;
+
+        for(size_t i = 0 ; i < groundPoints ; ++i) {
+            p(0) = (unit(rng) - 0.5) * plotSize;
+            p(1) = (unit(rng) - 0.5) * plotSize;
+            p(2) = groundZ(p(0)) + (unit(rng) - 0.5) * 0.05;
+            it.next().replaceCurrentPoint(p);
+        }
+
+        for(int t = 0 ; t < nTrees ; ++t) {
+            const Tree& tree = trees[t];
+            const double z0 = groundZ(tree.x);
+            const size_t nTrunk = pointsPerTree / 4;
+
+            // trunk : surface of a cylinder up to 60 % of the height
+            for(size_t i = 0 ; i < nTrunk ; ++i) {
+                const double a = unit(rng) * TWO_PI;
+                p(0) = tree.x + tree.radius * std::cos(a);
+                p(1) = tree.y + tree.radius * std::sin(a);
+                p(2) = z0 + unit(rng) * tree.height * 0.6;
+                it.next().replaceCurrentPoint(p);
+            }
+
+            // crown : volume of an ellipsoid centered at 75 % of the height
+            const double rh = tree.height * 0.2;
+            const double rv = tree.height * 0.25;
+
+            for(size_t i = nTrunk ; i < pointsPerTree ; ++i) {
+                double dx, dy, dz;
+
+                do {
+                    dx = unit(rng) * 2.0 - 1.0;
+                    dy = unit(rng) * 2.0 - 1.0;
+                    dz = unit(rng) * 2.0 - 1.0;
+                } while((dx*dx + dy*dy + dz*dz) > 1.0);
+
+                p(0) = tree.x + dx * rh;
+                p(1) = tree.y + dy * rh;
+                p(2) = z0 + tree.height * 0.75 + dz * rv;
+                it.next().replaceCurrentPoint(p);
+            }
+        }
+    }
+
+    const CT_AbstractPointCloudIndex* pointCloudIndex() const { return m_pcir->abstractCloudIndexT(); }
+    size_t nPoints() const { return pointCloudIndex()->size(); }
+    double plotSize() const { return m_plotSize; }
+    double maxHeight() const { return m_maxHeight; }
+
+    static double groundZ(double x) { return 0.05 * x; }
+
+private:
+    CT_NMPCIR   m_pcir;
+    double      m_plotSize;
+    double      m_maxHeight;
+};
+
+/**
+ * @brief Geometry of the grids that contain the whole plot
+ */
+struct GridGeometry {
+    GridGeometry(const SyntheticForest& forest, double res) : resolution(res) {
+        const double half = forest.plotSize() / 2.0;
+        minX = -half;
+        minY = -half;
+        minZ = SyntheticForest::groundZ(-half) - 1.0;
+        dimX = (size_t)std::ceil(forest.plotSize() / res);
+        dimY = dimX;
+        dimZ = (size_t)std::ceil((forest.maxHeight() + 1.0 - minZ) / res);
+    }
+
+    lvox::Grid3Di* newIntGrid() const { return new lvox::Grid3Di(NULL, NULL, minX, minY, minZ, dimX, dimY, dimZ, resolution, lvox::Max_Error_Code, 0); }
+    lvox::Grid3Df* newFloatGrid() const { return new lvox::Grid3Df(NULL, NULL, minX, minY, minZ, dimX, dimY, dimZ, resolution, lvox::Max_Error_Code, 0); }
+    size_t nCells() const { return dimX * dimY * dimZ; }
+
+    double resolution;
+    double minX, minY, minZ;
+    size_t dimX, dimY, dimZ;
+};
+
+/**
+ * @brief The three grids computed from a scan and the density computed from them
+ */
+struct ScanGrids {
+    ScanGrids(const GridGeometry& g) : hits(g.newIntGrid()), theoritical(g.newIntGrid()), before(g.newIntGrid()), density(g.newFloatGrid()) {}
+
+    QScopedPointer<lvox::Grid3Di> hits;
+    QScopedPointer<lvox::Grid3Di> theoritical;
+    QScopedPointer<lvox::Grid3Di> before;
+    QScopedPointer<lvox::Grid3Df> density;
+};
+
+class BenchRunner
+{
+public:
+    BenchRunner(const BenchOptions& options) : m_options(options) {}
+
+    /**
+     * @brief Run "body" until the minimum time is reached. "setup" is called before each
+     *        iteration and is not timed.
+     */
+    void run(const QString& name,
+             const QString& unit,
+             double itemsPerIteration,
+             std::function<void()> setup,
+             std::function<void()> body)
+    {
+        if(!m_options.filter.isEmpty() && !name.contains(m_options.filter))
+            return;
+
+        BenchResult r;
+        r.name = name;
+        r.unit = unit;
+        r.itemsPerIteration = itemsPerIteration;
+        r.iterations = 0;
+        r.bestSeconds = std::numeric_limits<double>::max();
+
+        double total = 0;
+        double totalMisses = 0;
+        QElapsedTimer timer;
+
+        while((r.iterations < 3) || ((total < m_options.minTime) && (r.iterations < 1000)))
+        {
+            if(setup)
+                setup();
+
+            m_cacheMisses.start();
+            timer.start();
+            body();
+            const double seconds = timer.nsecsElapsed() / 1e9;
+            totalMisses += m_cacheMisses.stop();
+
+            r.bestSeconds = qMin(r.bestSeconds, seconds);
+            total += seconds;
+            ++r.iterations;
+        }
+
+        r.meanSeconds = total / r.iterations;
+        r.cacheMisses = m_cacheMisses.isValid() ? (totalMisses / r.iterations) : -1;
+        m_results.append(r);
+
+        QString line = QString("%1 %2 ms (mean %3 ms, %4 it)  %5 %6/s")
+                       .arg(name, -48)
+                       .arg(r.bestSeconds * 1e3, 10, 'f', 3)
+                       .arg(r.meanSeconds * 1e3, 0, 'f', 3)
+                       .arg(r.iterations)
+                       .arg(itemsPerIteration / r.bestSeconds, 0, 'g', 4)
+                       .arg(unit);
+
+        if(r.cacheMisses >= 0)
+            line += QString("  %1 cache misses").arg(r.cacheMisses, 0, 'g', 4);
+
+        QTextStream(stdout) << line << endl;
+    }
+
+    bool writeJSON(const QString& fileName, const QJsonObject& context) const
+    {
+        QJsonArray benchmarks;
+
+        foreach (const BenchResult& r, m_results) {
+            QJsonObject o;
+            o.insert("name", r.name);
+            o.insert("run_type", QString("iteration"));
+            o.insert("iterations", r.iterations);
+            o.insert("real_time", r.bestSeconds * 1e3);
+            o.insert("mean_time", r.meanSeconds * 1e3);
+            o.insert("time_unit", QString("ms"));
+            o.insert("items_per_iteration", r.itemsPerIteration);
+            o.insert("items_per_second", r.itemsPerIteration / r.bestSeconds);
+            o.insert("item_unit", r.unit);
+
+            if(r.cacheMisses >= 0)
+                o.insert("cache_misses", r.cacheMisses);
+            benchmarks.append(o);
+        }
+
+        QJsonObject root;
+        QJsonObject ctx = context;
+        ctx.insert("peak_rss_kb", (double)peakRSSkB());
+        root.insert("context", ctx);
+        root.insert("benchmarks", benchmarks);
+
+        QFile f(fileName);
+
+        if(!f.open(QFile::WriteOnly | QFile::Truncate))
+            return false;
+
+        f.write(QJsonDocument(root).toJson());
+        return true;
+    }
+
+private:
+    BenchOptions        m_options;
+    QList<BenchResult>  m_results;
+    CacheMissCounter    m_cacheMisses;  /*!< counts only the thread that runs the benchmarks */
+};
+
+bool parseOptions(const QStringList& args, BenchOptions& options)
+{
+    for(int i = 1 ; i < args.size() ; ++i) {
+        const QString& a = args.at(i);
+        const bool hasValue = (i + 1) < args.size();
+
+        if(a == "--quick") {
+            options.quick = true;
+            options.angularResolution = 0.5;
+            options.resolutions = QList<double>() << 0.5;
+            options.minTime = 0.1;
+        } else if((a == "--seed") && hasValue) {
+            options.seed = args.at(++i).toUInt();
+        } else if((a == "--angular-resolution") && hasValue) {
+            options.angularResolution = args.at(++i).toDouble();
+        } else if((a == "--resolutions") && hasValue) {
+            options.resolutions.clear();
+
+            foreach (const QString& r, args.at(++i).split(',', QString::SkipEmptyParts))
+                options.resolutions.append(r.toDouble());
+        } else if((a == "--min-time") && hasValue) {
+            options.minTime = args.at(++i).toDouble();
+        } else if((a == "--filter") && hasValue) {
+            options.filter = args.at(++i);
+        } else if((a == "--out") && hasValue) {
+            options.output = args.at(++i);
+        } else {
+            QTextStream(stderr) << "unknown or incomplete option : " << a << endl;
+            return false;
+        }
+    }
+
+    return (options.angularResolution > 0) && !options.resolutions.isEmpty();
+}
+
+/**
+ * @brief Fill the grids with the LVOX3 workers (used as input of the density and interpolation benchmarks)
+ */
+void computeScanGrids(const CT_ShootingPattern& pattern, const SyntheticForest& forest, ScanGrids& grids)
+{
+    LVOX3_ComputeHits(&pattern, forest.pointCloudIndex(), grids.hits.data()).compute();
+    LVOX3_ComputeTheoriticals(&pattern, grids.theoritical.data()).compute();
+    LVOX3_ComputeBefore(&pattern, forest.pointCloudIndex(), grids.before.data()).compute();
+    LVOX3_ComputeDensity(grids.density.data(), grids.hits.data(), grids.theoritical.data(), grids.before.data(), 10).compute();
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    BenchOptions options;
+
+    if(!parseOptions(app.arguments(), options))
+        return 1;
+
+    const int nTrees = options.quick ? 15 : 60;
+    const size_t pointsPerTree = options.quick ? 4000 : 20000;
+    const size_t groundPoints = options.quick ? 20000 : 100000;
+
+    SyntheticForest forest(options.seed, 30.0, nTrees, pointsPerTree, groundPoints);
+
+    // scanner in the middle of the plot at 1.5 m above the ground
+    const Eigen::Vector3d scannerPosition(0, 0, SyntheticForest::groundZ(0) + 1.5);
+    CT_ThetaPhiShootingPattern pattern(scannerPosition, 360.0, 150.0, options.angularResolution, options.angularResolution, 0.0, 15.0);
+
+    const double nShots = pattern.getNumberOfShots();
+    const double nPoints = forest.nPoints();
+
+    QTextStream(stdout) << QString("points %1, shots %2, threads %3").arg(nPoints).arg(nShots).arg(QThread::idealThreadCount()) << endl;
+
+    BenchRunner runner(options);
+
+    foreach (double res, options.resolutions) {
+        const GridGeometry geometry(forest, res);
+        const QString suffix = QString("/res:%1").arg(res);
+        const double nCells = geometry.nCells();
+
+        // traversal kernel alone (rays of the shooting pattern)
+        {
+            QScopedPointer<lvox::Grid3Di> grid(geometry.newIntGrid());
+
+            runner.run("woo_traversal" + suffix, "rays", nShots, std::function<void()>(), [&]() {
+                QVector<LVOX3_Grid3DVoxelWooVisitor*> list;
+                LVOX3_CountVisitor<lvox::Grid3DiType> countVisitor(grid.data());
+                list.append(&countVisitor);
+
+                LVOX3_Grid3DWooTraversalAlgorithm<lvox::Grid3DiType> algo(grid.data(), true, list);
+
+                const Eigen::Vector3d& origin = pattern.getOrigin();
+                Eigen::Vector3d direction;
+                const size_t n = pattern.getNumberOfShots();
+
+                for(size_t i = 0 ; i < n ; ++i) {
+                    pattern.getShotDirectionAt(i, direction);
+                    algo.compute(origin, direction);
+                }
+            });
+
+            // same rays counted in 16 bits per voxel (the int grid gives the geometry)
+            QScopedPointer<LVOX3_CompactCountGrid> compact;
+
+            runner.run("woo_traversal_compact" + suffix, "rays", nShots, [&]() { compact.reset(new LVOX3_CompactCountGrid(grid->nCells())); }, [&]() {
+                QVector<LVOX3_Grid3DVoxelWooVisitor*> list;
+                LVOX3_CountVisitor<lvox::Grid3DiType, LVOX3_CompactCountGrid> countVisitor(compact.data());
+                list.append(&countVisitor);
+
+                LVOX3_Grid3DWooTraversalAlgorithm<lvox::Grid3DiType> algo(grid.data(), true, list);
+
+                const Eigen::Vector3d& origin = pattern.getOrigin();
+                Eigen::Vector3d direction;
+                const size_t n = pattern.getNumberOfShots();
+
+                for(size_t i = 0 ; i < n ; ++i) {
+                    pattern.getShotDirectionAt(i, direction);
+                    algo.compute(origin, direction);
+                }
+            });
+        }
+
+        // workers that create grids from the scan
+        {
+            QScopedPointer<ScanGrids> grids;
+
+            runner.run("compute_hits" + suffix, "points", nPoints, [&]() { grids.reset(new ScanGrids(geometry)); }, [&]() {
+                LVOX3_ComputeHits(&pattern, forest.pointCloudIndex(), grids->hits.data()).compute();
+            });
+
+            runner.run("compute_theoriticals" + suffix, "rays", nShots, [&]() { grids.reset(new ScanGrids(geometry)); }, [&]() {
+                LVOX3_ComputeTheoriticals(&pattern, grids->theoritical.data()).compute();
+            });
+
+            runner.run("compute_before" + suffix, "points", nPoints, [&]() { grids.reset(new ScanGrids(geometry)); }, [&]() {
+                LVOX3_ComputeBefore(&pattern, forest.pointCloudIndex(), grids->before.data()).compute();
+            });
+
+            // same workers reading a copy of the points in contiguous arrays
+            runner.run("point_staging" + suffix, "points", nPoints, std::function<void()>(), [&]() {
+                LVOX3_PointStaging staging(forest.pointCloudIndex());
+            });
+
+            LVOX3_PointStaging staging(forest.pointCloudIndex());
+
+            runner.run("compute_hits_staged" + suffix, "points", nPoints, [&]() { grids.reset(new ScanGrids(geometry)); }, [&]() {
+                LVOX3_ComputeHits(&pattern, forest.pointCloudIndex(), grids->hits.data(), NULL, NULL, &staging).compute();
+            });
+
+            runner.run("compute_before_staged" + suffix, "points", nPoints, [&]() { grids.reset(new ScanGrids(geometry)); }, [&]() {
+                LVOX3_ComputeBefore(&pattern, forest.pointCloudIndex(), grids->before.data(), NULL, NULL, false, &staging).compute();
+            });
+
+            // points in the order of a terrestrial scanner (column by column of azimuth, then zenith) and in
+            // Morton order of their voxels
+            std::vector<quint64> scanLineCodes(staging.size());
+
+            for(size_t i = 0 ; i < staging.size() ; ++i) {
+                const Eigen::Vector3d d = staging.pointAt(i) - scannerPosition;
+                const quint64 azimuth = (quint64)((std::atan2(d.y(), d.x()) + TWO_PI/2) / options.angularResolution * (360.0 / TWO_PI));
+                const quint64 zenith = (quint64)(std::acos(qBound(-1.0, d.z() / d.norm(), 1.0)) / options.angularResolution * (360.0 / TWO_PI));
+                scanLineCodes[i] = (azimuth << 32) | zenith;
+            }
+
+            LVOX3_PointStaging scanLine(forest.pointCloudIndex());
+            scanLine.reorder(LVOX3_MortonOrder::sortedOrder(scanLineCodes));
+
+            LVOX3_PointStaging morton(forest.pointCloudIndex());
+            morton.sortByMorton(Eigen::Vector3d(geometry.minX, geometry.minY, geometry.minZ), geometry.resolution);
+
+            runner.run("compute_before_scanline" + suffix, "points", nPoints, [&]() { grids.reset(new ScanGrids(geometry)); }, [&]() {
+                LVOX3_ComputeBefore(&pattern, forest.pointCloudIndex(), grids->before.data(), NULL, NULL, false, &scanLine).compute();
+            });
+
+            runner.run("compute_before_morton" + suffix, "points", nPoints, [&]() { grids.reset(new ScanGrids(geometry)); }, [&]() {
+                LVOX3_ComputeBefore(&pattern, forest.pointCloudIndex(), grids->before.data(), NULL, NULL, false, &morton).compute();
+            });
+
+            runner.run("compute_hits_scanline" + suffix, "points", nPoints, [&]() { grids.reset(new ScanGrids(geometry)); }, [&]() {
+                LVOX3_ComputeHits(&pattern, forest.pointCloudIndex(), grids->hits.data(), NULL, NULL, &scanLine).compute();
+            });
+
+            runner.run("compute_hits_morton" + suffix, "points", nPoints, [&]() { grids.reset(new ScanGrids(geometry)); }, [&]() {
+                LVOX3_ComputeHits(&pattern, forest.pointCloudIndex(), grids->hits.data(), NULL, NULL, &morton).compute();
+            });
+
+            runner.run("compute_theoriticals_morton" + suffix, "rays", nShots, [&]() { grids.reset(new ScanGrids(geometry)); }, [&]() {
+                LVOX3_ComputeTheoriticals(&pattern, grids->theoritical.data(), NULL, NULL, false, true).compute();
+            });
+        }
+
+        // workers that use the grids of a scan
+        ScanGrids input(geometry);
+        computeScanGrids(pattern, forest, input);
+
+        {
+            QScopedPointer<lvox::Grid3Df> density(geometry.newFloatGrid());
+
+            runner.run("compute_density" + suffix, "cells", nCells, std::function<void()>(), [&]() {
+                LVOX3_ComputeDensity(density.data(), input.hits.data(), input.theoritical.data(), input.before.data(), 10).compute();
+            });
+        }
+
+        {
+            // same formula and checks than the default configuration of the generic step
+            QList<LVOX3_GenericCompute::Input> inputs;
+            LVOX3_GenericCompute::Input in;
+            in.gridLetterInFormula = 'a';
+            in.grid = input.hits.data();
+            inputs.append(in);
+            in.gridLetterInFormula = 'b';
+            in.grid = input.theoritical.data();
+            inputs.append(in);
+            in.gridLetterInFormula = 'c';
+            in.grid = input.before.data();
+            inputs.append(in);
+
+            QList<lvox::CheckConfiguration> checks;
+            lvox::CheckConfiguration check;
+            check.setFormula("b == c");
+            check.setErrorFormula(QString().setNum(lvox::B_Equals_C));
+            checks.append(check);
+            check.setFormula("b < c");
+            check.setErrorFormula(QString().setNum(lvox::B_Inferior_C));
+            checks.append(check);
+            check.setFormula("(b - c) < 10");
+            check.setErrorFormula(QString().setNum(lvox::B_Minus_C_Inferior_Threshold));
+            checks.append(check);
+
+            QScopedPointer<lvox::Grid3Df> output(geometry.newFloatGrid());
+
+            runner.run("generic_compute" + suffix, "cells", nCells, std::function<void()>(), [&]() {
+                LVOX3_GenericCompute(inputs, checks, "a / (b - c)", output.data()).compute();
+            });
+        }
+
+        {
+            QScopedPointer<lvox::Grid3Df> output(geometry.newFloatGrid());
+
+            runner.run("interpolate_distance" + suffix, "cells", nCells, std::function<void()>(), [&]() {
+                LVOX3_InterpolateDistance(input.density.data(), output.data(), res * 3.0, 2, 0).compute();
+            });
+
+            runner.run("interpolate_trust" + suffix, "cells", nCells, std::function<void()>(), [&]() {
+                LVOX3_InterpolateTrustFactor(input.density.data(), input.before.data(), input.theoritical.data(), output.data(), res * 3.0, 10, 100).compute();
+            });
+        }
+
+        // end to end : what the LVOX3 step does for one scan
+        {
+            QScopedPointer<ScanGrids> grids;
+
+            runner.run("compute_all" + suffix, "scans", 1, [&]() { grids.reset(new ScanGrids(geometry)); }, [&]() {
+                LVOX3_ComputeAll workersManager;
+                workersManager.addWorker(0, new LVOX3_ComputeHits(&pattern, forest.pointCloudIndex(), grids->hits.data()));
+                workersManager.addWorker(0, new LVOX3_ComputeTheoriticals(&pattern, grids->theoritical.data()));
+                workersManager.addWorker(0, new LVOX3_ComputeBefore(&pattern, forest.pointCloudIndex(), grids->before.data()));
+                workersManager.addWorker(1, new LVOX3_ComputeDensity(grids->density.data(), grids->hits.data(), grids->theoritical.data(), grids->before.data(), 10));
+                workersManager.compute();
+            });
+        }
+    }
+
+    QTextStream(stdout) << QString("peak RSS %1 kB").arg(peakRSSkB()) << endl;
+
+    if(!options.output.isEmpty()) {
+        QJsonObject context;
+        context.insert("date", QDateTime::currentDateTime().toString(Qt::ISODate));
+        context.insert("executable", app.applicationFilePath());
+        context.insert("num_cpus", QThread::idealThreadCount());
+        context.insert("qt_version", QString(qVersion()));
+        context.insert("seed", (double)options.seed);
+        context.insert("quick", options.quick);
+        context.insert("angular_resolution_deg", options.angularResolution);
+        context.insert("n_points", nPoints);
+        context.insert("n_shots", nShots);
+
+        if(!runner.writeJSON(options.output, context)) {
+            QTextStream(stderr) << "unable to write " << options.output << endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}
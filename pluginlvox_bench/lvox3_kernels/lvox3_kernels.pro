@@ -0,0 +1,42 @@
+#-------------------------------------------------
+#
+# Benchmarks of the LVOX3 kernels on synthetic inputs
+#
+#-------------------------------------------------
+COMPUTREE += ctlibio
+
+MUST_USE_OPENCV = 1
+
+CT_PREFIX_INSTALL = ../../..
+CT_PREFIX = ../../../computreev3
+
+include(../../../computreev3/shared.pri)
+include($${PLUGIN_SHARED_DIR}/include.pri)
+include($${CT_PREFIX}/include_ct_library.pri)
+
+# FIXME: use the include_all.pri, should not define manually this variable
+# but required, otherwise the build fails with error: ‘CT_Image2D’ does not name a type
+DEFINES += USE_OPENCV
+
+INCLUDEPATH += ../../pluginlvox/
+INCLUDEPATH += ../../pluginlvox/muParser/include
+
+# rpath works only on Unix
+QMAKE_RPATHDIR += $${PLUGINSHARED_DESTDIR}
+QMAKE_RPATHDIR += $${PLUGINSHARED_DESTDIR}/plugins/
+
+QT       -= gui
+
+# benchmarks are only meaningful with optimizations
+CONFIG   += release
+CONFIG   -= debug
+
+TARGET = bench_lvox3_kernels
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+
+SOURCES += bench_lvox3_kernels.cpp
+
+LIBS += -L$${PLUGINSHARED_DESTDIR}/plugins/ -lplug_lvoxv2
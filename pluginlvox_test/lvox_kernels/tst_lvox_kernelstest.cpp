@@ -0,0 +1,1046 @@
+#include <QString>
+#include <QtTest>
+#include <QScopedPointer>
+#include <QTemporaryDir>
+
+#include <cmath>
+#include <limits>
+
+#include "ct_itemdrawable/ct_grid3d.h"
+#include "mk/tools/lvox3_gridtype.h"
+#include "tools/lvox_binarygrid3d.h"
+#include "tools/lvox_gridkernels.h"
+#include "tools/lvox_gridcombiner.h"
+#include "tools/lvox_gridcombinerstate.h"
+#include "tools/lvox_math.h"
+#include "tools/lvox_threadscheduler.h"
+#include "mk/tools/lvox3_compactcountgrid.h"
+#include "mk/tools/lvox3_gridcache.h"
+#include "mk/tools/lvox3_mortonorder.h"
+#include "mk/tools/lvox3_quantizeddistancegrid.h"
+#include "mk/tools/lvox3_gridtiling.h"
+#include "mk/tools/lvox3_columnfilter.h"
+#include "mk/tools/lvox3_tilerays.h"
+#include "mk/tools/traversal/woo/lvox3_grid3dwootraversalalgorithm.h"
+#include "mk/tools/traversal/woo/visitor/lvox3_countvisitor.h"
+#include "mk/tools/traversal/woo/visitor/lvox3_distancevisitor.h"
+#include "mk/tools/traversal/woo/visitor/lvox3_countwithlengththresholdvisitor.h"
+#include "tools/lvox_countvisitor.h"
+#include "tools/lvox_distancevisitor.h"
+#include "tools/lvox_countwithlengththresholdvisitor.h"
+#include "ct_itemdrawable/ct_beam.h"
+#include "ct_itemdrawable/tools/gridtools/ct_grid3dwootraversalalgorithm.h"
+#include "urfm/step/lvox2_stepfiltergridbyradius.h"
+
+/*
+ * Kernels whose result must not change when their implementation is optimized
+ * are compared with a straightforward implementation on small grids.
+ */
+class Lvox_kernelsTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    Lvox_kernelsTest();
+
+private Q_SLOTS:
+    void testBinaryGridRoundTrip();
+    void testBinaryGridWrongType();
+    void testBinaryGridEmpty();
+    void testGridCacheClear();
+    void testTiledTraversal_data();
+    void testTiledTraversal();
+    void testLegacyTraversal_data();
+    void testLegacyTraversal();
+    void testGridKernels();
+    void testGridCombiner_data();
+    void testGridCombiner();
+    void testGridCombinerResume_data();
+    void testGridCombinerResume();
+    void testLog1p();
+    void testRadiusRowSpan();
+    void testThreadScheduler();
+    void testThreadSchedulerCancel();
+    void testMortonOrder();
+    void testCompactCountGrid();
+    void testQuantizedDistanceGrid();
+};
+
+Lvox_kernelsTest::Lvox_kernelsTest()
+{
+}
+
+static lvox::Grid3Di* makeIntGrid(size_t xdim, size_t ydim, size_t zdim, double res = 1.0)
+{
+    return new lvox::Grid3Di(nullptr, nullptr, 1.0, 2.0, 3.0, xdim, ydim, zdim, res, -9, 0);
+}
+
+/*
+ * Same sequence of numbers in [min;max[ on all platforms
+ */
+class TestRandom
+{
+public:
+    TestRandom(quint32 seed) : m_state(seed) {}
+
+    double next(double min, double max)
+    {
+        m_state = m_state*1664525u + 1013904223u;
+        return min + ((max - min)*(m_state >> 8)) / 16777216.0;
+    }
+
+private:
+    quint32 m_state;
+};
+
+/*
+ * Values and geometry read through the mapping are the written ones.
+ */
+void Lvox_kernelsTest::testBinaryGridRoundTrip()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QScopedPointer<lvox::Grid3Di> grid(makeIntGrid(3, 2, 4, 0.5));
+
+    for(size_t i = 0 ; i < grid->nCells() ; ++i)
+        grid->setValueAtIndex(i, ((int)i)*3 - 5);
+
+    const QString path = dir.filePath("grid.LVG3D");
+    QVERIFY(LVOX_BinaryGrid3DFile::write(grid.data(), path));
+    QVERIFY(LVOX_BinaryGrid3DFile::isBinaryGridFile(path));
+
+    LVOX_MappedGrid3D<int> mapped;
+    QVERIFY(mapped.open(path));
+    QCOMPARE(mapped.xdim(), (size_t)3);
+    QCOMPARE(mapped.ydim(), (size_t)2);
+    QCOMPARE(mapped.zdim(), (size_t)4);
+    QCOMPARE(mapped.header().resolution, 0.5);
+    QCOMPARE(mapped.header().minZ, 3.0);
+    QCOMPARE(mapped.NA(), -9);
+
+    for(size_t i = 0 ; i < grid->nCells() ; ++i)
+        QCOMPARE(mapped.valueAtIndex(i), grid->valueAtIndex(i));
+
+    QScopedPointer< CT_Grid3D<int> > copy(mapped.createGrid(nullptr, nullptr));
+
+    for(size_t i = 0 ; i < grid->nCells() ; ++i)
+        QCOMPARE(copy->valueAtIndex(i), grid->valueAtIndex(i));
+}
+
+void Lvox_kernelsTest::testBinaryGridWrongType()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QScopedPointer<lvox::Grid3Di> grid(makeIntGrid(2, 2, 2));
+    const QString path = dir.filePath("grid.LVG3D");
+    QVERIFY(LVOX_BinaryGrid3DFile::write(grid.data(), path));
+
+    LVOX_MappedGrid3D<float> mapped;
+    QVERIFY(!mapped.open(path));
+    QVERIFY(!mapped.isOpen());
+}
+
+/*
+ * A grid without voxel can be written and opened (nothing is mapped).
+ */
+void Lvox_kernelsTest::testBinaryGridEmpty()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QScopedPointer<lvox::Grid3Di> grid(makeIntGrid(0, 2, 2));
+    const QString path = dir.filePath("empty.LVG3D");
+    QVERIFY(LVOX_BinaryGrid3DFile::write(grid.data(), path));
+
+    LVOX_MappedGrid3D<int> mapped;
+    QVERIFY(mapped.open(path));
+    QVERIFY(mapped.isOpen());
+    QCOMPARE(mapped.nCells(), (size_t)0);
+    QVERIFY(mapped.values() == nullptr);
+}
+
+/*
+ * Clearing the cache removes its entries and nothing else of the directory.
+ */
+void Lvox_kernelsTest::testGridCacheClear()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QDir root(dir.path());
+    QVERIFY(root.mkpath("user/data"));
+    QVERIFY(root.mkpath("0123456789abcdef0123456789abcdef01234567"));
+
+    QFile userFile(root.filePath("user/data/notes.txt"));
+    QVERIFY(userFile.open(QFile::WriteOnly));
+    userFile.write("keep");
+    userFile.close();
+
+    LVOX3_GridCache cache(dir.path(), 0);
+    QVERIFY(cache.isValid());
+
+    QScopedPointer<lvox::Grid3Di> grid(makeIntGrid(2, 2, 2));
+    const QByteArray key("89abcdef0123456789abcdef0123456789abcdef");
+    QVERIFY(cache.save(key, "ni", grid.data()));
+    QVERIFY(cache.contains(key, QStringList() << "ni"));
+
+    cache.clear();
+
+    QVERIFY(!cache.contains(key, QStringList() << "ni"));
+    QVERIFY(!root.exists(QString(key)));
+    QVERIFY(root.exists("user/data/notes.txt"));
+
+    // a folder named like a key but without timestamp is not an entry
+    QVERIFY(root.exists("0123456789abcdef0123456789abcdef01234567"));
+}
+
+void Lvox_kernelsTest::testTiledTraversal_data()
+{
+    QTest::addColumn<bool>("visitFirstVoxelTouched");
+
+    QTest::newRow("theoretical") << true;
+    QTest::newRow("before") << false;
+}
+
+/*
+ * Counts of rays traversed in the tiles of a grid (only the rays of the tile, see LVOX3_TileRays) are the
+ * counts of the rays traversed in the whole grid. Origins are inside the grid : a ray that enters the
+ * whole grid can be rounded outside of it (the first voxel is then missed in the whole grid only).
+ */
+void Lvox_kernelsTest::testTiledTraversal()
+{
+    QFETCH(bool, visitFirstVoxelTouched);
+
+    const Eigen::Vector3d min(0, 0, 0);
+    const Eigen::Vector3d max(5.5, 4.5, 3.5);
+    const LVOX3_GridTiling tiling(min, max, 1.0, 2, 2);
+    const LVOX3_ColumnFilter outsideFilter(tiling, NULL, NULL);
+
+    QCOMPARE(tiling.xdim(), (size_t)6);
+    QCOMPARE(tiling.ydim(), (size_t)5);
+    QCOMPARE(tiling.tiles().size(), 9);
+
+    QVector<Eigen::Vector3d> origins;
+    QVector<Eigen::Vector3d> directions;
+    TestRandom random(42);
+
+    for(int i = 0 ; i < 2000 ; ++i) {
+        origins.append(Eigen::Vector3d(random.next(0, 6), random.next(0, 5), random.next(0, 4)));
+        directions.append(Eigen::Vector3d(random.next(-0.2, 1), random.next(-1, 1), random.next(-1, 1)));
+    }
+
+    lvox::Grid3Di whole(nullptr, nullptr, 0, 0, 0, 6, 5, 4, 1.0, -9, 0);
+
+    {
+        LVOX3_CountVisitor<lvox::Grid3DiType> visitor(&whole);
+        QVector<LVOX3_Grid3DVoxelWooVisitor*> list;
+        list.append(&visitor);
+
+        LVOX3_Grid3DWooTraversalAlgorithm<lvox::Grid3DiType> algo(&whole, visitFirstVoxelTouched, list);
+
+        for(int i = 0 ; i < origins.size() ; ++i)
+            algo.compute(origins[i], directions[i]);
+    }
+
+    const auto rayAt = [&origins, &directions](size_t i, Eigen::Vector3d& origin, Eigen::Vector3d& direction) {
+        origin = origins[(int)i];
+        direction = directions[(int)i];
+    };
+
+    const LVOX3_TileRays tileRays(tiling, origins.size(), rayAt);
+
+    size_t nIndexes = 0;
+
+    for(int t = 0 ; t < tiling.tiles().size() ; ++t)
+        nIndexes += tileRays.raysOfTile(t).size();
+
+    QCOMPARE(LVOX3_TileRays::memoryBytes(tiling, origins.size(), rayAt), (quint64)(nIndexes * sizeof(size_t)));
+
+    lvox::Grid3Di tiled(nullptr, nullptr, 0, 0, 0, 6, 5, 4, 1.0, -9, 0);
+
+    for(int t = 0 ; t < tiling.tiles().size() ; ++t) {
+        const LVOX3_GridTiling::Tile& tile = tiling.tiles().at(t);
+        const Eigen::Vector3d tileMin = tiling.tileMinBBox(tile);
+        lvox::Grid3Di tileGrid(nullptr, nullptr, tileMin.x(), tileMin.y(), tileMin.z(), tile.xdim, tile.ydim, 4, 1.0, -9, 0);
+
+        LVOX3_CountVisitor<lvox::Grid3DiType> visitor(&tileGrid);
+        QVector<LVOX3_Grid3DVoxelWooVisitor*> list;
+        list.append(&visitor);
+
+        LVOX3_Grid3DWooTraversalAlgorithm<lvox::Grid3DiType> algo(&tileGrid, visitFirstVoxelTouched, list, &outsideFilter);
+
+        const std::vector<size_t>& rays = tileRays.raysOfTile(t);
+
+        QVERIFY(rays.size() < (size_t)origins.size());
+
+        for(size_t i = 0 ; i < rays.size() ; ++i)
+            algo.compute(origins[(int)rays[i]], directions[(int)rays[i]]);
+
+        for(size_t level = 0 ; level < 4 ; ++level) {
+            for(size_t lin = 0 ; lin < tile.ydim ; ++lin) {
+                for(size_t col = 0 ; col < tile.xdim ; ++col)
+                    tiled.setValue(tile.col + col, tile.lin + lin, level, tileGrid.value(col, lin, level));
+            }
+        }
+    }
+
+    for(size_t i = 0 ; i < whole.nCells() ; ++i)
+        QCOMPARE(tiled.valueAtIndex(i), whole.valueAtIndex(i));
+}
+
+void Lvox_kernelsTest::testLegacyTraversal_data()
+{
+    QTest::addColumn<bool>("keepFirst");
+    QTest::addColumn<bool>("fromScanner");
+    QTest::addColumn<double>("scannerX");
+    QTest::addColumn<double>("scannerY");
+    QTest::addColumn<double>("scannerZ");
+
+    // grid of makeIntGrid(9, 8, 7, 0.5) : from (1, 2, 3) to (5.5, 6, 6.5)
+    QTest::newRow("theoretical, scanner inside") << true << true << 3.1 << 3.9 << 4.3;
+    QTest::newRow("theoretical, scanner outside") << true << true << -2.3 << 8.1 << 9.7;
+    QTest::newRow("before, scanner inside") << false << false << 3.1 << 3.9 << 4.3;
+    QTest::newRow("before, scanner outside") << false << false << -2.3 << 8.1 << 9.7;
+    QTest::newRow("actual beam, scanner outside") << false << true << 7.4 << 0.2 << 1.1;
+}
+
+/*
+ * The rays of the legacy threads (CT_Beam, CT_Grid3DWooTraversalAlgorithm and the LVOX_*Visitor) and of the
+ * LVOX3 traversal used by these threads give the same count, distance and length threshold grids. Rays go
+ * from the scanner to the points (theoretical and actual beam threads) or from the points away from the
+ * scanner (before threads), points are inside and around the grid.
+ */
+void Lvox_kernelsTest::testLegacyTraversal()
+{
+    QFETCH(bool, keepFirst);
+    QFETCH(bool, fromScanner);
+    QFETCH(double, scannerX);
+    QFETCH(double, scannerY);
+    QFETCH(double, scannerZ);
+
+    const Eigen::Vector3d scanner(scannerX, scannerY, scannerZ);
+    const double threshold = 1.2;
+
+    QScopedPointer<lvox::Grid3Di> oldCount(makeIntGrid(9, 8, 7, 0.5));
+    QScopedPointer<lvox::Grid3Di> oldThreshold(makeIntGrid(9, 8, 7, 0.5));
+    lvox::Grid3Df oldDistance(nullptr, nullptr, 1.0, 2.0, 3.0, 9, 8, 7, 0.5, -9, 0);
+
+    QScopedPointer<lvox::Grid3Di> newCount(makeIntGrid(9, 8, 7, 0.5));
+    QScopedPointer<lvox::Grid3Di> newThreshold(makeIntGrid(9, 8, 7, 0.5));
+    lvox::Grid3Df newDistance(nullptr, nullptr, 1.0, 2.0, 3.0, 9, 8, 7, 0.5, -9, 0);
+
+    LVOX_CountVisitor oldCountVisitor(oldCount.data());
+    LVOX_DistanceVisitor oldDistanceVisitor(&oldDistance);
+    LVOX_CountWithLengthThresholdVisitor oldThresholdVisitor(oldThreshold.data(), threshold);
+    QList<CT_AbstractGrid3DBeamVisitor*> oldList;
+    oldList << &oldCountVisitor << &oldDistanceVisitor << &oldThresholdVisitor;
+
+    CT_Grid3DWooTraversalAlgorithm oldAlgo(oldCount.data(), keepFirst, oldList);
+
+    LVOX3_CountVisitor<lvox::Grid3DiType> newCountVisitor(newCount.data());
+    LVOX3_DistanceVisitor<lvox::Grid3DfType> newDistanceVisitor(&newDistance);
+    LVOX3_CountWithLengthThresholdVisitor<lvox::Grid3DiType> newThresholdVisitor(newThreshold.data(), threshold);
+    QVector<LVOX3_Grid3DVoxelWooVisitor*> newList;
+    newList << &newCountVisitor << &newDistanceVisitor << &newThresholdVisitor;
+
+    LVOX3_Grid3DWooTraversalAlgorithm<lvox::Grid3DiType> newAlgo(newCount.data(), keepFirst, newList);
+
+    Eigen::Vector3d bot, top;
+    oldCount->getMinCoordinates(bot);
+    oldCount->getMaxCoordinates(top);
+
+    CT_Beam beam(NULL, NULL);
+    TestRandom random(42);
+
+    for(int i = 0 ; i < 3000 ; ++i) {
+        const Eigen::Vector3d point(random.next(0, 6.5), random.next(1, 7), random.next(2, 7.5));
+
+        // same rays as the legacy threads, CT_Beam normalizes the direction
+        beam.setOrigin(fromScanner ? scanner : point);
+        beam.setDirection(point - scanner);
+
+        if(beam.intersect(bot, top))
+            oldAlgo.compute(beam);
+
+        newAlgo.compute(beam.getOrigin(), beam.getDirection());
+    }
+
+    QVERIFY(newCountVisitor.nVisits() > 0);
+
+    for(size_t i = 0 ; i < oldCount->nCells() ; ++i) {
+        QCOMPARE(newCount->valueAtIndex(i), oldCount->valueAtIndex(i));
+        QCOMPARE(newDistance.valueAtIndex(i), oldDistance.valueAtIndex(i));
+        QCOMPARE(newThreshold->valueAtIndex(i), oldThreshold->valueAtIndex(i));
+    }
+}
+
+/*
+ * Kernels on grids (several blocks of several chunks) are the straightforward loops of the nb/nt and
+ * compare steps.
+ */
+void Lvox_kernelsTest::testGridKernels()
+{
+    QScopedPointer<lvox::Grid3Di> nb(makeIntGrid(7, 6, 9));
+    QScopedPointer<lvox::Grid3Di> nt(makeIntGrid(7, 6, 9));
+    TestRandom random(7);
+
+    for(size_t i = 0 ; i < nb->nCells() ; ++i) {
+        nb->setValueAtIndex(i, (i % 13 == 0) ? nb->NA() : (int)random.next(-2, 20));
+        nt->setValueAtIndex(i, (i % 17 == 0) ? nt->NA() : (int)random.next(0, 20));
+    }
+
+    QVERIFY(nb->nCells() > 2*LVOX_GridKernels::CHUNK_SIZE);
+
+    lvox::Grid3Df ratio(nullptr, nullptr, 1.0, 2.0, 3.0, 7, 6, 9, 1.0, -9, -9);
+    lvox::Grid3Df difference(nullptr, nullptr, 1.0, 2.0, 3.0, 7, 6, 9, 1.0, -9, -9);
+
+    LVOX_GridKernels::ratio(nb.data(), nt.data(), &ratio);
+    const LVOX_GridKernels::MinMax<float> diffMinMax = LVOX_GridKernels::difference(nb.data(), nt.data(), &difference);
+    const LVOX_GridKernels::CompareStats stats = LVOX_GridKernels::compare(nb.data(), nt.data(), 0);
+
+    float min = std::numeric_limits<float>::max();
+    float max = std::numeric_limits<float>::lowest();
+    size_t nEqual = 0, nGreater = 0, nLess = 0, nMasked = 0;
+
+    for(size_t i = 0 ; i < nb->nCells() ; ++i) {
+        const int b = nb->valueAtIndex(i);
+        const int t = nt->valueAtIndex(i);
+
+        if(t != 0)
+            QCOMPARE(ratio.valueAtIndex(i), static_cast<float>(b)/t);
+        else
+            QCOMPARE(ratio.valueAtIndex(i), -9.0f);
+
+        if((b == nb->NA()) || (t == nt->NA())) {
+            QCOMPARE(difference.valueAtIndex(i), -9.0f);
+            ++nMasked;
+        } else {
+            QCOMPARE(difference.valueAtIndex(i), (float)(b - t));
+            min = qMin(min, (float)(b - t));
+            max = qMax(max, (float)(b - t));
+
+            if(b == t)
+                ++nEqual;
+            else if(b > t)
+                ++nGreater;
+            else
+                ++nLess;
+        }
+    }
+
+    QCOMPARE(stats.nEqual, nEqual);
+    QCOMPARE(stats.nGreater, nGreater);
+    QCOMPARE(stats.nLess, nLess);
+    QCOMPARE(stats.nMasked, nMasked);
+    QCOMPARE(diffMinMax.min, min);
+    QCOMPARE(diffMinMax.max, max);
+}
+
+/*
+ * Grids of several scans with the geometry of makeIntGrid(5, 4, 3)
+ */
+class TestScans
+{
+public:
+    TestScans(int nScans, quint32 seed)
+    {
+        TestRandom random(seed);
+
+        for(int s = 0 ; s < nScans ; ++s) {
+            lvox::Grid3Di* ni = makeIntGrid(5, 4, 3);
+            lvox::Grid3Di* nt = makeIntGrid(5, 4, 3);
+            lvox::Grid3Di* nb = makeIntGrid(5, 4, 3);
+            lvox::Grid3Df* d = makeFloatGrid();
+            lvox::Grid3Df* deltaT = makeFloatGrid();
+
+            for(size_t i = 0 ; i < ni->nCells() ; ++i) {
+                const int t = (int)random.next(1, 12);
+
+                // a few voxels with nb > nt to get the error codes of the sum mode
+                nt->setValueAtIndex(i, t);
+                nb->setValueAtIndex(i, (int)random.next(0, t + 2));
+                ni->setValueAtIndex(i, (int)random.next(0, 6));
+                d->setValueAtIndex(i, random.next(0, 1));
+                deltaT->setValueAtIndex(i, random.next(0, 1));
+            }
+
+            inputs.hits.append(ni);
+            inputs.theoretical.append(nt);
+            inputs.before.append(nb);
+            inputs.density.append(d);
+            inputs.deltaT.append(deltaT);
+        }
+    }
+
+    ~TestScans()
+    {
+        qDeleteAll(inputs.hits);
+        qDeleteAll(inputs.theoretical);
+        qDeleteAll(inputs.before);
+        qDeleteAll(inputs.density);
+        qDeleteAll(inputs.deltaT);
+    }
+
+    static lvox::Grid3Df* makeFloatGrid()
+    {
+        return new lvox::Grid3Df(nullptr, nullptr, 1.0, 2.0, 3.0, 5, 4, 3, 1.0, -9, 0);
+    }
+
+    LVOX_GridCombiner::Inputs inputs;
+};
+
+/*
+ * Output grids of a combination
+ */
+class TestCombined
+{
+public:
+    TestCombined() : ni(makeIntGrid(5, 4, 3)), nt(makeIntGrid(5, 4, 3)), nb(makeIntGrid(5, 4, 3)),
+        d(TestScans::makeFloatGrid()), deltaT(TestScans::makeFloatGrid()), scanId(makeIntGrid(5, 4, 3))
+    {
+        outputs.hits = ni.data();
+        outputs.theoretical = nt.data();
+        outputs.before = nb.data();
+        outputs.density = d.data();
+        outputs.deltaT = deltaT.data();
+        outputs.scanId = scanId.data();
+    }
+
+    QScopedPointer<lvox::Grid3Di> ni, nt, nb;
+    QScopedPointer<lvox::Grid3Df> d, deltaT;
+    QScopedPointer<lvox::Grid3Di> scanId;
+    LVOX_GridCombiner::Outputs outputs;
+};
+
+void Lvox_kernelsTest::testGridCombiner_data()
+{
+    QTest::addColumn<int>("mode");
+
+    QTest::newRow("max density") << (int)LVOX_GridCombiner::MaxDensity;
+    QTest::newRow("max nt - nb") << (int)LVOX_GridCombiner::MaxNt_Nb;
+    QTest::newRow("max (nt - nb)/nt") << (int)LVOX_GridCombiner::MaxNt_Nb_div_Nt;
+    QTest::newRow("max ni") << (int)LVOX_GridCombiner::MaxNi;
+    QTest::newRow("sum") << (int)LVOX_GridCombiner::SumNiSumNtNb;
+}
+
+/*
+ * The one pass combination is the voxel by voxel loop of the combine steps.
+ */
+void Lvox_kernelsTest::testGridCombiner()
+{
+    QFETCH(int, mode);
+
+    const int effectiveRayThresh = 3;
+    TestScans scans(4, 31);
+    TestCombined combined;
+    const LVOX_GridCombiner::Inputs& in = scans.inputs;
+
+    QVERIFY(LVOX_GridCombiner((LVOX_GridCombiner::Mode)mode, effectiveRayThresh, true).combine(in, combined.outputs));
+
+    for(size_t i = 0 ; i < combined.d->nCells() ; ++i) {
+        int kept = 0;
+        int ni = in.hits[0]->valueAtIndex(i);
+        int nt = in.theoretical[0]->valueAtIndex(i);
+        int nb = in.before[0]->valueAtIndex(i);
+        float d = in.density[0]->valueAtIndex(i);
+        float deltaT = in.deltaT[0]->valueAtIndex(i)*(float)nt;
+
+        for(int s = 1 ; s < in.density.size() ; ++s) {
+            const int sNi = in.hits[s]->valueAtIndex(i);
+            const int sNt = in.theoretical[s]->valueAtIndex(i);
+            const int sNb = in.before[s]->valueAtIndex(i);
+            const float sD = in.density[s]->valueAtIndex(i);
+            bool replace = false;
+
+            if(mode == LVOX_GridCombiner::SumNiSumNtNb) {
+                ni += sNi;
+                nt += sNt;
+                nb += sNb;
+                deltaT += in.deltaT[s]->valueAtIndex(i)*(float)sNt;
+            } else if(mode == LVOX_GridCombiner::MaxDensity) {
+                replace = (sD > d);
+            } else if(mode == LVOX_GridCombiner::MaxNt_Nb) {
+                replace = ((sNt - sNb) > (nt - nb));
+            } else if(mode == LVOX_GridCombiner::MaxNt_Nb_div_Nt) {
+                replace = (sD > 0) && (((float)(sNt - sNb)/(float)sNt) > ((float)(nt - nb)/(float)nt));
+            } else {
+                replace = (sNi > ni);
+            }
+
+            if(replace) {
+                kept = s;
+                ni = sNi;
+                nt = sNt;
+                nb = sNb;
+                d = sD;
+                deltaT = in.deltaT[s]->valueAtIndex(i)*(float)sNt;
+            }
+        }
+
+        if(mode == LVOX_GridCombiner::SumNiSumNtNb) {
+            if(nt == nb)
+                d = deltaT = -1;
+            else if(nt < nb)
+                d = deltaT = -2;
+            else if((nt - nb) < effectiveRayThresh)
+                d = deltaT = -3;
+            else
+                d = qMin(1.0f, (float)ni/(float)(nt - nb));
+        }
+
+        QCOMPARE(combined.ni->valueAtIndex(i), ni);
+        QCOMPARE(combined.nt->valueAtIndex(i), nt);
+        QCOMPARE(combined.nb->valueAtIndex(i), nb);
+        QCOMPARE(combined.d->valueAtIndex(i), d);
+        QCOMPARE(combined.deltaT->valueAtIndex(i), deltaT/(float)nt);
+        QCOMPARE(combined.scanId->valueAtIndex(i), kept);
+    }
+}
+
+void Lvox_kernelsTest::testGridCombinerResume_data()
+{
+    testGridCombiner_data();
+}
+
+/*
+ * Scans folded in a saved state give the grids of the combination of all scans at once.
+ */
+void Lvox_kernelsTest::testGridCombinerResume()
+{
+    QFETCH(int, mode);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    TestScans scans(4, 32);
+    const LVOX_GridCombiner::Inputs& all = scans.inputs;
+    const LVOX_GridCombiner combiner((LVOX_GridCombiner::Mode)mode, 3, true);
+
+    TestCombined full;
+    QVERIFY(combiner.combine(all, full.outputs));
+
+    LVOX_GridCombiner::Inputs first;
+    first.hits = all.hits.mid(0, 2);
+    first.theoretical = all.theoretical.mid(0, 2);
+    first.before = all.before.mid(0, 2);
+    first.density = all.density.mid(0, 2);
+    first.deltaT = all.deltaT.mid(0, 2);
+
+    LVOX_GridCombiner::Inputs last;
+    last.hits = all.hits.mid(2);
+    last.theoretical = all.theoretical.mid(2);
+    last.before = all.before.mid(2);
+    last.density = all.density.mid(2);
+    last.deltaT = all.deltaT.mid(2);
+
+    {
+        LVOX_GridCombinerState state;
+        TestCombined partial;
+
+        QVERIFY(combiner.combine(first, partial.outputs, &state));
+        QCOMPARE(state.nScans(), 2);
+        QVERIFY(state.save(dir.path()));
+    }
+
+    LVOX_GridCombinerState state;
+    QVERIFY(state.load(dir.path()));
+    QCOMPARE(state.nScans(), 2);
+
+    // the state of an other mode can not be resumed
+    TestCombined resumed;
+    const int otherMode = (mode + 1) % (LVOX_GridCombiner::SumNiSumNtNb + 1);
+    QVERIFY(!LVOX_GridCombiner((LVOX_GridCombiner::Mode)otherMode, 3, true).isConfigurationValid(last, resumed.outputs, &state));
+
+    QVERIFY(combiner.combine(last, resumed.outputs, &state));
+    QCOMPARE(state.nScans(), 4);
+
+    for(size_t i = 0 ; i < full.d->nCells() ; ++i) {
+        QCOMPARE(resumed.ni->valueAtIndex(i), full.ni->valueAtIndex(i));
+        QCOMPARE(resumed.nt->valueAtIndex(i), full.nt->valueAtIndex(i));
+        QCOMPARE(resumed.nb->valueAtIndex(i), full.nb->valueAtIndex(i));
+        QCOMPARE(resumed.d->valueAtIndex(i), full.d->valueAtIndex(i));
+        QCOMPARE(resumed.deltaT->valueAtIndex(i), full.deltaT->valueAtIndex(i));
+        QCOMPARE(resumed.scanId->valueAtIndex(i), full.scanId->valueAtIndex(i));
+    }
+}
+
+/*
+ * log1p of the PAD step is accurate to a few ulp for all densities (x in ]-1;0]), for tiny values
+ * and for greater values.
+ */
+void Lvox_kernelsTest::testLog1p()
+{
+    QCOMPARE(LVOX_Math::log1p(0.0f), 0.0f);
+
+    TestRandom random(33);
+
+    for(int n = 0 ; n < 100000 ; ++n) {
+        float x;
+
+        if(n % 3 == 0)
+            x = -(float)random.next(0, 0.99999994);
+        else if(n % 3 == 1)
+            x = (float)(std::pow(10.0, random.next(-30, 0)) * ((n % 2 == 0) ? 1.0 : -1.0));
+        else
+            x = (float)random.next(0, 1000);
+
+        const double expected = std::log1p((double)x);
+
+        if(expected == 0)
+            continue;
+
+        const double error = std::fabs((LVOX_Math::log1p(x) - expected) / expected);
+
+        if(error > 4*std::numeric_limits<float>::epsilon())
+            QFAIL(qPrintable(QString("log1p(%1) = %2, expected %3").arg(x, 0, 'g', 9).arg(LVOX_Math::log1p(x), 0, 'g', 9).arg(expected, 0, 'g', 17)));
+    }
+}
+
+/*
+ * The span of each row is exactly the cells of the per-voxel test of the filter step, also when the circle
+ * goes through cell centers or is outside the grid.
+ */
+void Lvox_kernelsTest::testRadiusRowSpan()
+{
+    TestRandom random(36);
+
+    for(int n = 0 ; n < 200 ; ++n) {
+        const double res = random.next(0.1, 2.0);
+        QScopedPointer<lvox::Grid3Di> grid(makeIntGrid((size_t)random.next(1, 40), (size_t)random.next(1, 40), 1, res));
+
+        double centerX = random.next(-10, 50*res);
+        double centerY = random.next(-10, 50*res);
+        double radius = random.next(0, 30*res);
+
+        // circle centered on a cell center that goes through other cell centers
+        if(n % 4 == 0) {
+            centerX = grid->getCellCenterX((size_t)random.next(0, grid->xdim()));
+            centerY = grid->getCellCenterY((size_t)random.next(0, grid->ydim()));
+            radius = res*(int)random.next(0, 20);
+        }
+
+        const double radius2 = radius*radius;
+
+        for(size_t yy = 0 ; yy < grid->ydim() ; ++yy) {
+            const LVOX2_StepFilterGridByRadius::RowSpan span = LVOX2_StepFilterGridByRadius::rowSpan(grid.data(), yy, centerX, centerY, radius2);
+
+            QVERIFY(span.first <= span.end);
+            QVERIFY(span.end <= grid->xdim());
+
+            for(size_t xx = 0 ; xx < grid->xdim() ; ++xx) {
+                const double dist2 = pow(grid->getCellCenterX(xx) - centerX, 2.0) + pow(grid->getCellCenterY(yy) - centerY, 2.0);
+                const bool inSpan = (xx >= span.first) && (xx < span.end);
+
+                QCOMPARE(inSpan, dist2 < pow(radius, 2.0));
+            }
+        }
+    }
+}
+
+/*
+ * Order of the starts and ends of the threads of a scheduler
+ */
+class TestSchedulerLog
+{
+public:
+    TestSchedulerLog() : nEvents(0), nRunning(0), maxRunning(0) {}
+
+    int begin()
+    {
+        QMutexLocker locker(&mutex);
+        maxRunning = qMax(maxRunning, ++nRunning);
+        return nEvents++;
+    }
+
+    int end()
+    {
+        QMutexLocker locker(&mutex);
+        --nRunning;
+        return nEvents++;
+    }
+
+    QMutex  mutex;
+    int     nEvents;
+    int     nRunning;
+    int     maxRunning;
+};
+
+class TestSchedulerThread : public CT_MonitoredQThread
+{
+public:
+    TestSchedulerThread(TestSchedulerLog& log, LVOX_ThreadScheduler* schedulerToCancel = nullptr) :
+        CT_MonitoredQThread(), begin(-1), end(-1), m_log(log), m_schedulerToCancel(schedulerToCancel) {}
+
+    void run()
+    {
+        begin = m_log.begin();
+
+        if(m_schedulerToCancel != nullptr)
+            m_schedulerToCancel->cancel();
+
+        QThread::msleep(5);
+        end = m_log.end();
+    }
+
+    int begin;
+    int end;
+
+private:
+    TestSchedulerLog&       m_log;
+    LVOX_ThreadScheduler*   m_schedulerToCancel;
+};
+
+/*
+ * Scan threads and density threads (each one reads the grids of two scans) like in the compute grids
+ * steps : the number of running threads is bounded and a thread starts after its dependencies.
+ */
+void Lvox_kernelsTest::testThreadScheduler()
+{
+    TestSchedulerLog log;
+    LVOX_ThreadScheduler scheduler(2);
+    QList<TestSchedulerThread*> scans;
+    QList<TestSchedulerThread*> densities;
+
+    for(int i = 0 ; i < 4 ; ++i) {
+        scans.append(new TestSchedulerThread(log));
+        scans.append(new TestSchedulerThread(log));
+        scheduler.addThread(scans.at(2*i));
+        scheduler.addThread(scans.at(2*i + 1));
+
+        densities.append(new TestSchedulerThread(log));
+        scheduler.addThread(densities.last(), QList<CT_MonitoredQThread*>() << scans.at(2*i) << scans.at(2*i + 1));
+    }
+
+    scheduler.run();
+
+    QCOMPARE(scheduler.maxThreads(), 2);
+    QCOMPARE(log.nEvents, 2*(scans.size() + densities.size()));
+    QVERIFY(log.maxRunning <= 2);
+
+    for(int i = 0 ; i < densities.size() ; ++i) {
+        QVERIFY(densities.at(i)->isFinished());
+        QVERIFY(densities.at(i)->begin > scans.at(2*i)->end);
+        QVERIFY(densities.at(i)->begin > scans.at(2*i + 1)->end);
+    }
+
+    qDeleteAll(scans);
+    qDeleteAll(densities);
+}
+
+/*
+ * A canceled scheduler does not start other threads and returns when the running ones are finished.
+ */
+void Lvox_kernelsTest::testThreadSchedulerCancel()
+{
+    TestSchedulerLog log;
+    LVOX_ThreadScheduler scheduler(1);
+    QList<TestSchedulerThread*> threads;
+
+    threads.append(new TestSchedulerThread(log));
+    threads.append(new TestSchedulerThread(log, &scheduler));
+
+    for(int i = 0 ; i < 3 ; ++i)
+        threads.append(new TestSchedulerThread(log));
+
+    foreach (TestSchedulerThread* thread, threads)
+        scheduler.addThread(thread);
+
+    scheduler.run();
+
+    QVERIFY(threads.at(0)->end >= 0);
+    QVERIFY(threads.at(1)->end >= 0);
+
+    for(int i = 2 ; i < threads.size() ; ++i)
+        QCOMPARE(threads.at(i)->begin, -1);
+
+    qDeleteAll(threads);
+}
+
+/*
+ * Interleave the bits one by one : bit b of the value v goes to bit (b * nValues + v) of the code.
+ */
+static quint64 interleaveBits(const quint32* values, int nValues, int nBits)
+{
+    quint64 code = 0;
+
+    for(int b = 0 ; b < nBits ; ++b) {
+        for(int v = 0 ; v < nValues ; ++v) {
+            if((values[v] >> b) & 1u)
+                code |= (quint64(1) << (b * nValues + v));
+        }
+    }
+
+    return code;
+}
+
+/*
+ * Morton codes are the interleaved bits of the coordinates (upper bits ignored), points
+ * outside the grid get the code of the border voxel and the sort keeps the order of equal codes.
+ */
+void Lvox_kernelsTest::testMortonOrder()
+{
+    TestRandom random(7);
+
+    for(int i = 0 ; i < 1000 ; ++i) {
+        const quint32 xyz[3] = { (quint32)random.next(0, 2097152), (quint32)random.next(0, 2097152), (quint32)random.next(0, 2097152) };
+        QCOMPARE(LVOX3_MortonOrder::encode3D(xyz[0], xyz[1], xyz[2]), interleaveBits(xyz, 3, 21));
+
+        const quint32 ab[2] = { (quint32)random.next(0, 65536), (quint32)random.next(0, 65536) };
+        QCOMPARE(LVOX3_MortonOrder::encode2D(ab[0], ab[1]), interleaveBits(ab, 2, 16));
+        QCOMPARE(LVOX3_MortonOrder::encode2D(ab[0] | 0xffff0000u, ab[1] | 0x80000000u), interleaveBits(ab, 2, 16));
+    }
+
+    QCOMPARE(LVOX3_MortonOrder::encode3D(2097151, 2097151, 2097151), quint64(0x7fffffffffffffffULL));
+    QCOMPARE(LVOX3_MortonOrder::encode2D(65535, 65535), quint64(0xffffffffULL));
+
+    const Eigen::Vector3d min(1, 2, 3);
+    QCOMPARE(LVOX3_MortonOrder::voxelCode(Eigen::Vector3d(2.6, 2.1, 4.9), min, 0.5), LVOX3_MortonOrder::encode3D(3, 0, 3));
+    QCOMPARE(LVOX3_MortonOrder::voxelCode(Eigen::Vector3d(-5, 1, 3.2), min, 0.5), LVOX3_MortonOrder::encode3D(0, 0, 0));
+    QCOMPARE(LVOX3_MortonOrder::voxelCode(Eigen::Vector3d(1, 2, 1e9), min, 0.5), LVOX3_MortonOrder::encode3D(0, 0, 2097151));
+
+    std::vector<quint64> codes;
+    codes.push_back(5);
+    codes.push_back(2);
+    codes.push_back(5);
+    codes.push_back(0);
+    codes.push_back(2);
+
+    const std::vector<size_t> order = LVOX3_MortonOrder::sortedOrder(codes);
+    const size_t expected[5] = { 3, 1, 4, 0, 2 };
+
+    QCOMPARE(order.size(), (size_t)5);
+
+    for(int i = 0 ; i < 5 ; ++i)
+        QCOMPARE(order[i], expected[i]);
+}
+
+/*
+ * A compact grid gives back the values of a lvox::Grid3Di : error codes, counts stored in 16 bits
+ * and greater counts (or lower codes) promoted in the overflow map, which a voxel leaves when its
+ * count goes back under the limit.
+ */
+void Lvox_kernelsTest::testCompactCountGrid()
+{
+    const lvox::Grid3DiType maxStored = 65525;
+
+    LVOX3_CompactCountGrid compact(6);
+
+    QCOMPARE(compact.valueAtIndex(5), 0);
+    QCOMPARE(compact.nOverflows(), (size_t)0);
+
+    compact.setValueAtIndex(0, lvox::Max_Error_Code);
+    compact.setValueAtIndex(1, lvox::MNT);
+    compact.setValueAtIndex(2, maxStored);
+    QCOMPARE(compact.valueAtIndex(0), (lvox::Grid3DiType)lvox::Max_Error_Code);
+    QCOMPARE(compact.valueAtIndex(1), (lvox::Grid3DiType)lvox::MNT);
+    QCOMPARE(compact.valueAtIndex(2), maxStored);
+    QCOMPARE(compact.nOverflows(), (size_t)0);
+
+    compact.addValueAtIndex(2, 1);
+    QCOMPARE(compact.valueAtIndex(2), maxStored + 1);
+    QCOMPARE(compact.nOverflows(), (size_t)1);
+
+    compact.addValueAtIndex(2, 1000000);
+    compact.setValueAtIndex(3, std::numeric_limits<lvox::Grid3DiType>::max());
+    compact.setValueAtIndex(4, lvox::Max_Error_Code - 1);
+    QCOMPARE(compact.valueAtIndex(2), maxStored + 1000001);
+    QCOMPARE(compact.valueAtIndex(3), std::numeric_limits<lvox::Grid3DiType>::max());
+    QCOMPARE(compact.valueAtIndex(4), (lvox::Grid3DiType)(lvox::Max_Error_Code - 1));
+    QCOMPARE(compact.nOverflows(), (size_t)3);
+
+    compact.setValueAtIndex(2, 12);
+    compact.setValueAtIndex(4, lvox::Sky);
+    QCOMPARE(compact.valueAtIndex(2), 12);
+    QCOMPARE(compact.valueAtIndex(4), (lvox::Grid3DiType)lvox::Sky);
+    QCOMPARE(compact.nOverflows(), (size_t)1);
+
+    QScopedPointer<lvox::Grid3Di> grid(makeIntGrid(3, 2, 1));
+
+    for(size_t i = 0 ; i < compact.nCells() ; ++i)
+        grid->setValueAtIndex(i, compact.valueAtIndex(i));
+
+    QScopedPointer<LVOX3_CompactCountGrid> copy(LVOX3_CompactCountGrid::fromGrid(grid.data()));
+    QScopedPointer<lvox::Grid3Di> back(makeIntGrid(3, 2, 1));
+    copy->copyTo(back.data());
+
+    for(size_t i = 0 ; i < grid->nCells() ; ++i)
+        QCOMPARE(back->valueAtIndex(i), grid->valueAtIndex(i));
+
+    QCOMPARE(copy->nOverflows(), (size_t)1);
+}
+
+/*
+ * Quantized distances are decoded within half a step, integer codes exactly, other values are
+ * clamped and counted. The file is marked as quantized : it can not be read as plain unsigned short
+ * values and a plain unsigned short file is not read as quantized distances.
+ */
+void Lvox_kernelsTest::testQuantizedDistanceGrid()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    lvox::Grid3Df grid(nullptr, nullptr, 1.0, 2.0, 3.0, 5, 4, 3, 0.5, -9, 0);
+
+    const double diagonal = 0.5 * std::sqrt(3.0);
+    const double step = LVOX3_QuantizedDistanceGrid::step(0.5);
+    TestRandom random(11);
+
+    for(size_t i = 0 ; i < grid.nCells() ; ++i)
+        grid.setValueAtIndex(i, random.next(0, diagonal));
+
+    grid.setValueAtIndex(0, 0);
+    grid.setValueAtIndex(1, diagonal);
+
+    for(int code = 1 ; code <= 16 ; ++code)
+        grid.setValueAtIndex(1 + code, -code);
+
+    // clamped : too long, not an integer code, lower than the last integer code
+    grid.setValueAtIndex(20, diagonal * 2);
+    grid.setValueAtIndex(21, -2.5);
+    grid.setValueAtIndex(22, -20);
+
+    LVOX3_QuantizedDistanceGrid quantized(&grid);
+    QCOMPARE(quantized.nClamped(), (size_t)3);
+
+    for(size_t i = 0 ; i < grid.nCells() ; ++i) {
+        const lvox::Grid3DfType value = grid.valueAtIndex(i);
+        const lvox::Grid3DfType decoded = LVOX3_QuantizedDistanceGrid::decode(quantized.codes()[i], step);
+
+        if((i >= 2) && (i <= 17))
+            QCOMPARE(decoded, value);
+        else if((i < 20) || (i > 22))
+            QVERIFY(std::fabs(decoded - value) <= (step * 0.5 + 1e-6));
+    }
+
+    QVERIFY(std::fabs(LVOX3_QuantizedDistanceGrid::decode(quantized.codes()[20], step) - diagonal) < 1e-6);
+    QCOMPARE(LVOX3_QuantizedDistanceGrid::decode(quantized.codes()[21], step), -3.0f);
+    QCOMPARE(LVOX3_QuantizedDistanceGrid::decode(quantized.codes()[22], step), -16.0f);
+
+    const QString path = dir.filePath("distances.LVG3D");
+    size_t nClamped = 0;
+    QVERIFY(LVOX3_QuantizedDistanceGrid::write(&grid, path, &nClamped));
+    QCOMPARE(nClamped, (size_t)3);
+
+    LVOX_MappedGrid3D<quint16> plain;
+    QVERIFY(!plain.open(path));
+
+    LVOX_MappedGrid3D<quint16> mapped;
+    QVERIFY(LVOX3_QuantizedDistanceGrid::open(mapped, path));
+
+    lvox::Grid3Df back(nullptr, nullptr, 1.0, 2.0, 3.0, 5, 4, 3, 0.5, -9, 0);
+    LVOX3_QuantizedDistanceGrid::copyTo(mapped, &back);
+
+    for(size_t i = 0 ; i < grid.nCells() ; ++i)
+        QCOMPARE(back.valueAtIndex(i), LVOX3_QuantizedDistanceGrid::decode(quantized.codes()[i], step));
+
+    const QString plainPath = dir.filePath("codes.LVG3D");
+    QVERIFY(LVOX_BinaryGrid3DFile::writeValues(&grid, grid.NA(), quantized.codes().data(), plainPath));
+    QVERIFY(plain.open(plainPath));
+    QVERIFY(!LVOX3_QuantizedDistanceGrid::open(mapped, plainPath));
+}
+
+QTEST_APPLESS_MAIN(Lvox_kernelsTest)
+
+#include "tst_lvox_kernelstest.moc"
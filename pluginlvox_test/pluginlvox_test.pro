@@ -1,4 +1,5 @@
 TEMPLATE = subdirs
 
 SUBDIRS += \
-    grid_neighbors
+    grid_neighbors \
+    lvox_kernels